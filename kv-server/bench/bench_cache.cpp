@@ -0,0 +1,304 @@
+#include "cache.h"
+#include "hdr_histogram.h"
+#include "key_dist.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// bench-cache: LRUCache on its own, without HTTP or PostgreSQL. Every
+// combination of the list-valued options is one run of --duration seconds;
+// each run prints one CSV row (ops/s, get hit ratio, per-operation latency
+// percentiles in ns).
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum CacheOp { GET = 0, PUT = 1, ERASE = 2, kCacheOps = 3 };
+const char* const kOpNames[kCacheOps] = {"get", "put", "erase"};
+
+struct Mix {
+    int get_pct   = 0;
+    int put_pct   = 0;
+    int erase_pct = 0;
+};
+
+struct BenchConfig {
+    std::vector<int>         threads     = {1, 2, 4, 8};
+    std::vector<std::string> dists       = {"uniform", "zipf"};
+    std::vector<Mix>         mixes       = {{95, 5, 0}, {50, 50, 0}, {80, 15, 5}};
+    std::vector<std::size_t> capacities  = {10000, 100000};
+    std::vector<std::size_t> value_sizes = {64, 1024};
+    double      key_factor = 2.0;   // keyspace = capacity * key_factor
+    double      duration_s = 1.0;   // per combination
+    std::uint64_t seed     = 42;
+    std::string csv_file;           // empty: stdout
+};
+
+// One combination of the list-valued options
+struct Case {
+    int         threads    = 1;
+    std::string dist;
+    Mix         mix;
+    std::size_t capacity   = 0;
+    std::size_t keys       = 0;
+    std::size_t value_size = 0;
+};
+
+struct Result {
+    double   elapsed_s = 0.0;
+    uint64_t ops[kCacheOps] = {};
+    uint64_t hits = 0;
+    // ns; a cache call is far below kv-loadgen's microsecond resolution
+    std::vector<HdrHistogram> latency;
+
+    Result() : latency(kCacheOps, HdrHistogram(1, 10LL * 1000 * 1000 * 1000, 3)) {}
+};
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, sep)) {
+        if (!part.empty()) out.push_back(part);
+    }
+    if (out.empty()) throw std::runtime_error("Empty list: " + s);
+    return out;
+}
+
+template <typename T, typename Parse>
+std::vector<T> parse_list(const std::string& s, Parse parse) {
+    std::vector<T> out;
+    for (const auto& p : split(s, ',')) out.push_back(parse(p));
+    return out;
+}
+
+// "get:put:erase" percentages, e.g. 90:10:0
+Mix parse_mix(const std::string& s) {
+    auto parts = split(s, ':');
+    if (parts.size() != 3) throw std::runtime_error("--mix entries are get:put:erase, got " + s);
+    Mix m{std::stoi(parts[0]), std::stoi(parts[1]), std::stoi(parts[2])};
+    if (m.get_pct < 0 || m.put_pct < 0 || m.erase_pct < 0 || m.get_pct + m.put_pct + m.erase_pct != 100) {
+        throw std::runtime_error("--mix " + s + ": percentages must be >= 0 and add up to 100");
+    }
+    return m;
+}
+
+BenchConfig parse_args(int argc, char** argv) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](int& i) -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+            return argv[++i];
+        };
+        auto to_size = [](const std::string& v) { return static_cast<std::size_t>(std::stoull(v)); };
+
+        if (arg == "--threads")          cfg.threads     = parse_list<int>(next(i), [](const std::string& v) { return std::stoi(v); });
+        else if (arg == "--dist")        cfg.dists       = split(next(i), ',');
+        else if (arg == "--mix")         cfg.mixes       = parse_list<Mix>(next(i), parse_mix);
+        else if (arg == "--capacity")    cfg.capacities  = parse_list<std::size_t>(next(i), to_size);
+        else if (arg == "--value-size")  cfg.value_sizes = parse_list<std::size_t>(next(i), to_size);
+        else if (arg == "--key-factor")  cfg.key_factor  = std::stod(next(i));
+        else if (arg == "--duration")    cfg.duration_s  = std::stod(next(i));
+        else if (arg == "--seed")        cfg.seed        = std::stoull(next(i));
+        else if (arg == "--csv")         cfg.csv_file    = next(i);
+        else if (arg == "--help" || arg == "-h") {
+            std::cout
+                << "bench-cache options (lists are comma-separated; every combination is run):\n"
+                << "  --threads <list>      Threads sharing the cache (default 1,2,4,8)\n"
+                << "  --dist <list>         Key distributions as in kv-loadgen --dist (default uniform,zipf)\n"
+                << "  --mix <list>          get:put:erase percentages (default 95:5:0,50:50:0,80:15:5)\n"
+                << "  --capacity <list>     Cache capacities in entries (default 10000,100000)\n"
+                << "  --value-size <list>   Value sizes in bytes (default 64,1024)\n"
+                << "  --key-factor <f>      Keyspace as a multiple of the capacity (default 2)\n"
+                << "  --duration <s>        Seconds per combination (default 1)\n"
+                << "  --seed <n>            RNG seed\n"
+                << "  --csv <file>          Write CSV rows here instead of stdout\n";
+            std::exit(0);
+        }
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    for (int t : cfg.threads) {
+        if (t < 1) throw std::runtime_error("--threads must be >= 1");
+    }
+    for (std::size_t c : cfg.capacities) {
+        if (c < 1) throw std::runtime_error("--capacity must be >= 1");
+    }
+    if (cfg.key_factor <= 0.0 || cfg.duration_s <= 0.0) {
+        throw std::runtime_error("--key-factor and --duration must be > 0");
+    }
+    return cfg;
+}
+
+void worker(LRUCache& cache, const Case& c, const KeyDistribution& dist,
+            const std::vector<std::string>& keys, std::uint64_t seed,
+            std::atomic<int>& ready, const std::atomic<bool>& go, const std::atomic<bool>& stop,
+            Result& out) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> pick(0, 99);
+    const std::string value(c.value_size, 'v');
+    std::string got;
+    // Counted here and handed over at the end: the Results sit next to
+    // each other in run_case's vector, and bumping them per call would put
+    // every thread on the same cache lines as its neighbours
+    Result mine;
+
+    ready.fetch_add(1);
+    while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        const std::string& key = keys[dist.next(rng)];
+        int r = pick(rng);
+        CacheOp op = r < c.mix.get_pct ? GET : (r < c.mix.get_pct + c.mix.put_pct ? PUT : ERASE);
+
+        auto t0 = Clock::now();
+        if (op == GET) {
+            if (cache.get(key, got)) ++mine.hits;
+        } else if (op == PUT) {
+            cache.put(key, value);
+        } else {
+            cache.erase(key);
+        }
+        auto t1 = Clock::now();
+
+        ++mine.ops[op];
+        mine.latency[op].record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    out = std::move(mine);
+}
+
+Result run_case(const Case& c, const BenchConfig& cfg) {
+    KeyDistConfig kc;
+    kc.name = c.dist;
+    auto dist = make_key_distribution(kc, c.keys);
+
+    std::vector<std::string> keys;
+    keys.reserve(c.keys);
+    for (std::size_t i = 0; i < c.keys; ++i) keys.push_back("key" + std::to_string(i));
+
+    // Fill the cache from the same distribution, so the resident set is
+    // what the measured mix would leave behind rather than an empty cache
+    LRUCache cache(c.capacity);
+    {
+        std::mt19937_64 rng(cfg.seed);
+        const std::string value(c.value_size, 'v');
+        for (std::size_t i = 0; i < 2 * c.capacity; ++i) cache.put(keys[dist->next(rng)], value);
+    }
+
+    std::vector<Result> per_thread(static_cast<std::size_t>(c.threads));
+    std::atomic<int>  ready{0};
+    std::atomic<bool> go{false}, stop{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < c.threads; ++t) {
+        threads.emplace_back(worker, std::ref(cache), std::cref(c), std::cref(*dist), std::cref(keys),
+                             cfg.seed + 1 + static_cast<std::uint64_t>(t), std::ref(ready), std::cref(go),
+                             std::cref(stop), std::ref(per_thread[static_cast<std::size_t>(t)]));
+    }
+    while (ready.load() < c.threads) std::this_thread::yield();
+
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(cfg.duration_s));
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& t : threads) t.join();
+
+    Result res;
+    res.elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const auto& r : per_thread) {
+        for (int op = 0; op < kCacheOps; ++op) {
+            res.ops[op] += r.ops[op];
+            res.latency[static_cast<std::size_t>(op)].merge(r.latency[static_cast<std::size_t>(op)]);
+        }
+        res.hits += r.hits;
+    }
+    return res;
+}
+
+void write_header(std::ostream& out) {
+    out << "threads,dist,get_pct,put_pct,erase_pct,capacity,keys,value_size,duration_s,ops,ops_per_s,get_hit_ratio";
+    for (const char* name : kOpNames) {
+        out << "," << name << "_ops," << name << "_p50_ns," << name << "_p99_ns,"
+            << name << "_p999_ns," << name << "_max_ns";
+    }
+    out << "\n";
+}
+
+void write_row(std::ostream& out, const Case& c, const Result& r) {
+    uint64_t total = r.ops[GET] + r.ops[PUT] + r.ops[ERASE];
+    out << c.threads << "," << c.dist << ","
+        << c.mix.get_pct << "," << c.mix.put_pct << "," << c.mix.erase_pct << ","
+        << c.capacity << "," << c.keys << "," << c.value_size << ","
+        << r.elapsed_s << "," << total << ","
+        << (r.elapsed_s > 0.0 ? static_cast<double>(total) / r.elapsed_s : 0.0) << ","
+        << (r.ops[GET] ? static_cast<double>(r.hits) / static_cast<double>(r.ops[GET]) : 0.0);
+    for (int op = 0; op < kCacheOps; ++op) {
+        const HdrHistogram& h = r.latency[static_cast<std::size_t>(op)];
+        out << "," << r.ops[op];
+        // Left empty for operations the mix doesn't contain
+        if (h.count()) {
+            out << "," << h.value_at_percentile(50.0) << "," << h.value_at_percentile(99.0)
+                << "," << h.value_at_percentile(99.9) << "," << h.max();
+        } else {
+            out << ",,,,";
+        }
+    }
+    out << "\n";
+    out.flush();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        BenchConfig cfg = parse_args(argc, argv);
+        log_set_level("INFO");
+
+        std::ofstream file;
+        if (!cfg.csv_file.empty()) {
+            file.open(cfg.csv_file);
+            if (!file) throw std::runtime_error("Cannot open --csv " + cfg.csv_file);
+        }
+        std::ostream& out = cfg.csv_file.empty() ? std::cout : file;
+        write_header(out);
+
+        for (std::size_t capacity : cfg.capacities) {
+            for (std::size_t value_size : cfg.value_sizes) {
+                for (const auto& dist : cfg.dists) {
+                    for (const Mix& mix : cfg.mixes) {
+                        for (int threads : cfg.threads) {
+                            Case c;
+                            c.threads    = threads;
+                            c.dist       = dist;
+                            c.mix        = mix;
+                            c.capacity   = capacity;
+                            c.keys       = std::max<std::size_t>(1, static_cast<std::size_t>(
+                                               static_cast<double>(capacity) * cfg.key_factor));
+                            c.value_size = value_size;
+                            write_row(out, c, run_case(c, cfg));
+                        }
+                    }
+                }
+            }
+        }
+        if (!cfg.csv_file.empty()) log_info("Results written to " + cfg.csv_file);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bench-cache fatal error: " << e.what() << "\n";
+        return 1;
+    }
+}
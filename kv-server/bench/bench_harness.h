@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal microbenchmark harness for the bench-* targets: calibrate an
+// iteration count, warm up, then time a number of repetitions and report
+// ns/op as mean, stddev, min and median over the repetitions.
+
+namespace bench {
+
+/** Keep the compiler from dropping a computation whose result is unused. */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+/** Keep the compiler from caching memory across this point. */
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+struct Options {
+    int         reps        = 10;     // timed repetitions
+    double      warmup_ms   = 100.0;  // untimed run before the repetitions
+    double      min_rep_ms  = 20.0;   // iterations are scaled until one repetition takes this long
+    std::string filter;               // run only benchmarks whose name contains this
+};
+
+struct Stats {
+    std::string   name;
+    std::uint64_t iters     = 0;    // per repetition
+    int           reps      = 0;
+    double        mean_ns   = 0.0;  // per op, over the repetitions
+    double        stddev_ns = 0.0;
+    double        min_ns    = 0.0;
+    double        median_ns = 0.0;
+
+    double cv() const { return mean_ns > 0.0 ? stddev_ns / mean_ns : 0.0; }
+};
+
+class Runner {
+public:
+    explicit Runner(Options opts) : opts_(std::move(opts)) {}
+
+    /** Time fn(), one call per operation. Skipped if it doesn't match the filter. */
+    template <typename F>
+    void run(const std::string& name, F&& fn) {
+        if (!opts_.filter.empty() && name.find(opts_.filter) == std::string::npos) return;
+
+        // Iterations per repetition: double until a batch takes min_rep_ms
+        std::uint64_t iters = 1;
+        for (;;) {
+            double ms = time_batch(fn, iters) / 1e6;
+            if (ms >= opts_.min_rep_ms || iters >= (1ULL << 40)) break;
+            iters *= ms > 0.0 ? std::max<std::uint64_t>(2, static_cast<std::uint64_t>(opts_.min_rep_ms / ms)) : 2;
+        }
+
+        auto warm_until = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double, std::milli>(opts_.warmup_ms));
+        while (Clock::now() < warm_until) time_batch(fn, iters);
+
+        std::vector<double> per_op;
+        for (int r = 0; r < opts_.reps; ++r) {
+            per_op.push_back(time_batch(fn, iters) / static_cast<double>(iters));
+        }
+
+        Stats s;
+        s.name  = name;
+        s.iters = iters;
+        s.reps  = opts_.reps;
+        for (double v : per_op) s.mean_ns += v;
+        s.mean_ns /= static_cast<double>(per_op.size());
+        for (double v : per_op) s.stddev_ns += (v - s.mean_ns) * (v - s.mean_ns);
+        s.stddev_ns = per_op.size() > 1 ? std::sqrt(s.stddev_ns / static_cast<double>(per_op.size() - 1)) : 0.0;
+        std::sort(per_op.begin(), per_op.end());
+        s.min_ns    = per_op.front();
+        s.median_ns = per_op.size() % 2 ? per_op[per_op.size() / 2]
+                                        : (per_op[per_op.size() / 2 - 1] + per_op[per_op.size() / 2]) / 2.0;
+
+        std::cout << std::left << std::setw(36) << name << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(10) << s.mean_ns << " ns/op +- "
+                  << std::setw(4) << 100.0 * s.cv() << "%  min " << s.min_ns
+                  << "  (" << s.reps << " x " << s.iters << ")\n"
+                  << std::defaultfloat;
+        results_.push_back(std::move(s));
+    }
+
+    const std::vector<Stats>& results() const { return results_; }
+
+    /** One CSV row per benchmark. */
+    void write_csv(std::ostream& out) const {
+        out << "name,iters,reps,mean_ns,stddev_ns,cv,min_ns,median_ns\n";
+        for (const auto& s : results_) {
+            out << s.name << "," << s.iters << "," << s.reps << "," << s.mean_ns << ","
+                << s.stddev_ns << "," << s.cv() << "," << s.min_ns << "," << s.median_ns << "\n";
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Nanoseconds for iters calls
+    template <typename F>
+    static double time_batch(F& fn, std::uint64_t iters) {
+        auto t0 = Clock::now();
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            fn();
+            clobber_memory();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    }
+
+    Options            opts_;
+    std::vector<Stats> results_;
+};
+
+} // namespace bench
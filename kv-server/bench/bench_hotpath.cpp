@@ -0,0 +1,132 @@
+#include "bench_harness.h"
+#include "request_util.h"
+#include "utils.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+
+// bench-hotpath: ns/op of the helpers every kv-server request goes through
+// (URL coding, key/value extraction, /metrics rendering), so their parsing
+// and allocation costs can be followed from commit to commit.
+
+namespace {
+
+struct HotpathConfig {
+    bench::Options opts;
+    std::string    csv_file;   // empty: no CSV
+};
+
+HotpathConfig parse_args(int argc, char** argv) {
+    HotpathConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](int& i) -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--reps")            cfg.opts.reps       = std::stoi(next(i));
+        else if (arg == "--warmup-ms")  cfg.opts.warmup_ms  = std::stod(next(i));
+        else if (arg == "--min-rep-ms") cfg.opts.min_rep_ms = std::stod(next(i));
+        else if (arg == "--filter")     cfg.opts.filter     = next(i);
+        else if (arg == "--csv")        cfg.csv_file        = next(i);
+        else if (arg == "--help" || arg == "-h") {
+            std::cout
+                << "bench-hotpath options:\n"
+                << "  --reps <n>            Timed repetitions per benchmark (default 10)\n"
+                << "  --warmup-ms <ms>      Untimed warmup per benchmark (default 100)\n"
+                << "  --min-rep-ms <ms>     Minimum length of one repetition (default 20)\n"
+                << "  --filter <text>       Only benchmarks whose name contains text\n"
+                << "  --csv <file>          Write one CSV row per benchmark\n";
+            std::exit(0);
+        }
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    if (cfg.opts.reps < 2 || cfg.opts.min_rep_ms <= 0.0 || cfg.opts.warmup_ms < 0.0) {
+        throw std::runtime_error("--reps must be >= 2, --min-rep-ms > 0 and --warmup-ms >= 0");
+    }
+    return cfg;
+}
+
+// A value with some of everything url_encode escapes
+std::string mixed_value(std::size_t n) {
+    static const char kChars[] = "abcXYZ019 -_.~/?&=%+:\"<>{}\xc3\xa9";
+    std::string v;
+    v.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) v += kChars[(i * 7) % (sizeof(kChars) - 1)];
+    return v;
+}
+
+// Fill req as httplib does before calling a "/<op>/(.+)" handler. In
+// place, since req.matches points into req.path.
+void route(httplib::Request& req, const std::string& method, const std::string& path) {
+    static const std::regex kRoute(R"(/[a-z]+/(.+))");
+    req.method = method;
+    req.path   = path;
+    std::regex_match(req.path, req.matches, kRoute);
+}
+
+void register_benchmarks(bench::Runner& run) {
+    const std::string key      = "key123456";
+    const std::string ycsb_key = "user6284781860667377211";
+    const std::string value_64 = mixed_value(64);
+    const std::string value_1k = mixed_value(1024);
+    const std::string enc_64   = url_encode(value_64);
+    const std::string enc_1k   = url_encode(value_1k);
+
+    run.run("url_encode/key", [&] { bench::do_not_optimize(url_encode(key)); });
+    run.run("url_encode/value_64", [&] { bench::do_not_optimize(url_encode(value_64)); });
+    run.run("url_encode/value_1k", [&] { bench::do_not_optimize(url_encode(value_1k)); });
+    run.run("url_decode/key", [&] { bench::do_not_optimize(url_decode(key)); });
+    run.run("url_decode/value_64", [&] { bench::do_not_optimize(url_decode(enc_64)); });
+    run.run("url_decode/value_1k", [&] { bench::do_not_optimize(url_decode(enc_1k)); });
+
+    // extract_* read from the request; the requests are built once, as
+    // httplib does before calling the handler
+    httplib::Request get_key, get_ycsb, put_param, put_body;
+    route(get_key, "GET", "/get/" + key);
+    route(get_ycsb, "GET", "/get/" + ycsb_key);
+    run.run("extract_key/key", [&] { bench::do_not_optimize(extract_key(get_key)); });
+    run.run("extract_key/ycsb_key", [&] { bench::do_not_optimize(extract_key(get_ycsb)); });
+
+    route(put_param, "PUT", "/put/" + key);
+    put_param.params.emplace("value", enc_64);
+    route(put_body, "PUT", "/put/" + key);
+    put_body.body = value_1k;
+    run.run("extract_value/param_64", [&] { bench::do_not_optimize(extract_value(put_param)); });
+    run.run("extract_value/body_1k", [&] { bench::do_not_optimize(extract_value(put_body)); });
+
+    MetricsSnapshot m;
+    m.requests_total = 123456789;
+    m.errors_total   = 42;
+    m.cache_hits     = 98765432;
+    m.cache_misses   = 1234567;
+    m.cache_capacity = 20000;
+    run.run("render_metrics", [&] { bench::do_not_optimize(render_metrics(m)); });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        HotpathConfig cfg = parse_args(argc, argv);
+        log_set_level("ERROR");
+
+        bench::Runner run(cfg.opts);
+        register_benchmarks(run);
+
+        if (!cfg.csv_file.empty()) {
+            std::ofstream out(cfg.csv_file);
+            if (!out) throw std::runtime_error("Cannot open --csv " + cfg.csv_file);
+            run.write_csv(out);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bench-hotpath fatal error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,297 @@
+#include "config.h"
+#include "hdr_histogram.h"
+#include "key_dist.h"
+#include "mem_db.h"
+#include "server.h"
+#include "utils.h"
+
+#include <httplib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// bench-server: kv-server's HTTP and cache tiers end to end, in one
+// process and without PostgreSQL. run_server() listens on an ephemeral
+// loopback port with the in-memory db_* of mem_db.cpp behind it; client
+// threads drive it closed-loop over keep-alive connections.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    int           clients       = 16;
+    int           threads       = 8;       // server thread pool
+    std::size_t   cache_size    = 20000;
+    std::size_t   keys          = 50000;   // all loaded into the DB up front
+    std::string   dist          = "zipf";
+    double        read_ratio    = 0.9;     // GETs; the rest are PUTs
+    std::size_t   value_size    = 100;
+    double        warmup_s      = 2.0;
+    double        measure_s     = 5.0;
+    int           db_pool       = 4;
+    int           db_latency_us = 0;
+    int           db_jitter_us  = 0;
+    std::uint64_t seed          = 42;
+    std::string   csv_file;                // appended to, header if new
+};
+
+BenchConfig parse_args(int argc, char** argv) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](int& i) -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--clients")              cfg.clients       = std::stoi(next(i));
+        else if (arg == "--threads")         cfg.threads       = std::stoi(next(i));
+        else if (arg == "--cache-size")      cfg.cache_size    = static_cast<std::size_t>(std::stoull(next(i)));
+        else if (arg == "--keys")            cfg.keys          = static_cast<std::size_t>(std::stoull(next(i)));
+        else if (arg == "--dist")            cfg.dist          = next(i);
+        else if (arg == "--read-ratio")      cfg.read_ratio    = std::stod(next(i));
+        else if (arg == "--value-size")      cfg.value_size    = static_cast<std::size_t>(std::stoull(next(i)));
+        else if (arg == "--warmup")          cfg.warmup_s      = std::stod(next(i));
+        else if (arg == "--measure")         cfg.measure_s     = std::stod(next(i));
+        else if (arg == "--db-pool")         cfg.db_pool       = std::stoi(next(i));
+        else if (arg == "--db-latency-us")   cfg.db_latency_us = std::stoi(next(i));
+        else if (arg == "--db-jitter-us")    cfg.db_jitter_us  = std::stoi(next(i));
+        else if (arg == "--seed")            cfg.seed          = std::stoull(next(i));
+        else if (arg == "--csv")             cfg.csv_file      = next(i);
+        else if (arg == "--help" || arg == "-h") {
+            std::cout
+                << "bench-server options:\n"
+                << "  --clients <n>         Client threads, one keep-alive connection each (default 16)\n"
+                << "  --threads <n>         Server thread pool size (default 8)\n"
+                << "  --cache-size <n>      Server LRU capacity (default 20000)\n"
+                << "  --keys <n>            Keyspace, loaded into the DB before the run (default 50000)\n"
+                << "  --dist <name>         Key distribution as in kv-loadgen --dist (default zipf)\n"
+                << "  --read-ratio <r>      Share of GETs, the rest are PUTs (default 0.9)\n"
+                << "  --value-size <n>      Value bytes (default 100)\n"
+                << "  --warmup <s>          Warmup seconds (default 2)\n"
+                << "  --measure <s>         Measurement seconds (default 5)\n"
+                << "  --db-pool <n>         DB pool slots, like kv-server --pg-pool (default 4)\n"
+                << "  --db-latency-us <n>   Latency added to every DB call (default 0)\n"
+                << "  --db-jitter-us <n>    Plus uniform jitter up to this (default 0)\n"
+                << "  --seed <n>            RNG seed\n"
+                << "  --csv <file>          Append a summary CSV row\n";
+            std::exit(0);
+        }
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    if (cfg.clients < 1 || cfg.threads < 1 || cfg.db_pool < 1 || cfg.keys < 1) {
+        throw std::runtime_error("--clients, --threads, --db-pool and --keys must be >= 1");
+    }
+    if (cfg.read_ratio < 0.0 || cfg.read_ratio > 1.0) {
+        throw std::runtime_error("--read-ratio must be in [0, 1]");
+    }
+    if (cfg.warmup_s < 0.0 || cfg.measure_s <= 0.0 || cfg.db_latency_us < 0 || cfg.db_jitter_us < 0) {
+        throw std::runtime_error("--measure must be > 0; --warmup and --db-* must be >= 0");
+    }
+    return cfg;
+}
+
+struct ClientStats {
+    uint64_t     ok     = 0;
+    uint64_t     fail   = 0;
+    uint64_t     hits   = 0;   // GETs answered from the cache (X-Cache: HIT)
+    uint64_t     gets   = 0;
+    HdrHistogram latency;      // us, all operations
+    HdrHistogram get_latency;
+    HdrHistogram put_latency;
+};
+
+struct Window {
+    Clock::time_point warmup_end;
+    Clock::time_point measure_end;
+};
+
+void client_loop(const BenchConfig& cfg, int port, int id, const KeyDistribution& dist,
+                 const Window& w, ClientStats& out) {
+    httplib::Client cli("127.0.0.1", port);
+    cli.set_keep_alive(true);
+
+    std::mt19937_64 rng(cfg.seed + 1 + static_cast<std::uint64_t>(id));
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    const std::string value(cfg.value_size, 'v');
+
+    for (;;) {
+        auto t0 = Clock::now();
+        if (t0 >= w.measure_end) break;
+
+        const std::string path = "/key" + std::to_string(dist.next(rng));
+        const bool get = coin(rng) < cfg.read_ratio;
+        bool ok  = false;
+        bool hit = false;
+        if (get) {
+            auto res = cli.Get("/get" + path);
+            ok  = res && res->status == 200;
+            hit = ok && res->get_header_value("X-Cache") == "HIT";
+        } else {
+            auto res = cli.Put("/put" + path, value, "text/plain");
+            ok = res && res->status == 200;
+        }
+        auto t1 = Clock::now();
+
+        if (t1 <= w.warmup_end || t1 > w.measure_end) continue;
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        if (ok) ++out.ok;
+        else    ++out.fail;
+        out.latency.record(us);
+        if (get) {
+            ++out.gets;
+            if (hit) ++out.hits;
+            out.get_latency.record(us);
+        } else {
+            out.put_latency.record(us);
+        }
+    }
+}
+
+double ms(const HdrHistogram& h, double pct) {
+    return static_cast<double>(h.value_at_percentile(pct)) / 1000.0;
+}
+
+void report(const BenchConfig& cfg, const ClientStats& s) {
+    double thr = static_cast<double>(s.ok) / cfg.measure_s;
+    double hit_ratio = s.gets ? static_cast<double>(s.hits) / static_cast<double>(s.gets) : 0.0;
+
+    std::cout << "bench-server summary:\n"
+              << "  ok=" << s.ok << " fail=" << s.fail << "\n"
+              << "  throughput=" << thr << " req/s\n"
+              << "  avg=" << s.latency.mean() / 1000.0 << "ms p50=" << ms(s.latency, 50.0)
+              << "ms p99=" << ms(s.latency, 99.0) << "ms p99.9=" << ms(s.latency, 99.9)
+              << "ms max=" << static_cast<double>(s.latency.max()) / 1000.0 << "ms\n"
+              << "  get: n=" << s.get_latency.count() << " p50=" << ms(s.get_latency, 50.0)
+              << "ms p99=" << ms(s.get_latency, 99.0) << "ms hit_ratio=" << hit_ratio << "\n"
+              << "  put: n=" << s.put_latency.count() << " p50=" << ms(s.put_latency, 50.0)
+              << "ms p99=" << ms(s.put_latency, 99.0) << "ms\n";
+
+    if (cfg.csv_file.empty()) return;
+    bool exists = std::ifstream(cfg.csv_file).good();
+    std::ofstream out(cfg.csv_file, std::ios::app);
+    if (!out) {
+        log_error("Failed to open CSV file: " + cfg.csv_file);
+        return;
+    }
+    if (!exists) {
+        out << "timestamp,clients,threads,cache_size,keys,dist,read_ratio,value_size,measure_s,"
+               "db_pool,db_latency_us,db_jitter_us,ok,fail,thr_rps,avg_ms,p50_ms,p99_ms,p999_ms,max_ms,"
+               "get_p50_ms,get_p99_ms,put_p50_ms,put_p99_ms,hit_ratio\n";
+    }
+    out << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) << ","
+        << cfg.clients << "," << cfg.threads << "," << cfg.cache_size << "," << cfg.keys << ","
+        << cfg.dist << "," << cfg.read_ratio << "," << cfg.value_size << "," << cfg.measure_s << ","
+        << cfg.db_pool << "," << cfg.db_latency_us << "," << cfg.db_jitter_us << ","
+        << s.ok << "," << s.fail << "," << thr << "," << s.latency.mean() / 1000.0 << ","
+        << ms(s.latency, 50.0) << "," << ms(s.latency, 99.0) << "," << ms(s.latency, 99.9) << ","
+        << static_cast<double>(s.latency.max()) / 1000.0 << ","
+        << ms(s.get_latency, 50.0) << "," << ms(s.get_latency, 99.0) << ","
+        << ms(s.put_latency, 50.0) << "," << ms(s.put_latency, 99.0) << ","
+        << hit_ratio << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        BenchConfig cfg = parse_args(argc, argv);
+        log_set_level("WARN");
+
+        KeyDistConfig kc;
+        kc.name = cfg.dist;
+        auto dist = make_key_distribution(kc, cfg.keys);
+
+        // Every key exists, so a cache miss costs one DB read
+        const std::string value(cfg.value_size, 'v');
+        for (std::size_t i = 0; i < cfg.keys; ++i) mem_db_load("key" + std::to_string(i), value);
+
+        MemDbOptions db;
+        db.latency_us = cfg.db_latency_us;
+        db.jitter_us  = cfg.db_jitter_us;
+        mem_db_configure(db);
+
+        Config scfg;
+        scfg.server_host      = "127.0.0.1";
+        scfg.server_port      = 0;
+        scfg.thread_pool_size = cfg.threads;
+        scfg.cache_size       = cfg.cache_size;
+        scfg.pg_pool_size     = cfg.db_pool;
+        scfg.log_level        = "WARN";
+
+        std::mutex mu;
+        std::condition_variable cv;
+        int port = 0;
+        std::function<void()> stop_server;
+        std::thread server([&] {
+            run_server(scfg, [&](int p, std::function<void()> stop) {
+                std::lock_guard<std::mutex> lk(mu);
+                port        = p;
+                stop_server = std::move(stop);
+                cv.notify_all();
+            });
+            // Returned without ever listening: unblock main
+            std::lock_guard<std::mutex> lk(mu);
+            if (port == 0) port = -1;
+            cv.notify_all();
+        });
+        {
+            std::unique_lock<std::mutex> lk(mu);
+            cv.wait(lk, [&] { return port != 0; });
+        }
+        if (port < 0) {
+            server.join();
+            log_error("bench-server: kv-server failed to start");
+            return 1;
+        }
+
+        Window w;
+        w.warmup_end  = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                           std::chrono::duration<double>(cfg.warmup_s));
+        w.measure_end = w.warmup_end + std::chrono::duration_cast<Clock::duration>(
+                                           std::chrono::duration<double>(cfg.measure_s));
+
+        std::vector<ClientStats> per_client(static_cast<std::size_t>(cfg.clients));
+        std::vector<std::thread> clients;
+        for (int i = 0; i < cfg.clients; ++i) {
+            clients.emplace_back(client_loop, std::cref(cfg), port, i, std::cref(*dist), std::cref(w),
+                                 std::ref(per_client[static_cast<std::size_t>(i)]));
+        }
+        for (auto& t : clients) t.join();
+
+        stop_server();
+        server.join();
+
+        ClientStats total;
+        for (const auto& c : per_client) {
+            total.ok   += c.ok;
+            total.fail += c.fail;
+            total.hits += c.hits;
+            total.gets += c.gets;
+            total.latency.merge(c.latency);
+            total.get_latency.merge(c.get_latency);
+            total.put_latency.merge(c.put_latency);
+        }
+        report(cfg, total);
+        if (total.ok == 0) {
+            log_error("bench-server: no request succeeded");
+            return 1;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bench-server fatal error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,107 @@
+#include "mem_db.h"
+#include "database.h"
+#include "utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+MemDbOptions g_opts;
+
+std::mutex                                   g_rows_mu;
+std::unordered_map<std::string, std::string> g_rows;
+
+std::vector<std::unique_ptr<std::mutex>> g_pool;
+std::atomic<uint64_t> g_rr{0};
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t us_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(b - a).count();
+}
+
+// Holds a pool slot for one call and sleeps the injected latency in it,
+// timing both like database.cpp's TimedLock
+class Call {
+public:
+    explicit Call(DbTiming* timing) : timing_(timing), t0_(Clock::now()) {
+        const uint64_t i = g_rr.fetch_add(1, std::memory_order_relaxed);
+        lk_ = std::unique_lock<std::mutex>(*g_pool[static_cast<std::size_t>(i % g_pool.size())]);
+        auto t1 = Clock::now();
+        if (timing_) timing_->wait_us += us_between(t0_, t1);
+        t0_ = t1;
+
+        int us = g_opts.latency_us;
+        if (g_opts.jitter_us > 0) {
+            thread_local std::mt19937 rng(std::random_device{}());
+            us += std::uniform_int_distribution<int>(0, g_opts.jitter_us)(rng);
+        }
+        if (us > 0) std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+    ~Call() {
+        if (timing_) timing_->exec_us += us_between(t0_, Clock::now());
+    }
+
+    Call(const Call&) = delete;
+    Call& operator=(const Call&) = delete;
+
+private:
+    DbTiming*                    timing_;
+    Clock::time_point            t0_;
+    std::unique_lock<std::mutex> lk_;
+};
+
+} // namespace
+
+void mem_db_configure(const MemDbOptions& opts) {
+    g_opts = opts;
+}
+
+void mem_db_load(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lk(g_rows_mu);
+    g_rows[key] = value;
+}
+
+bool db_init(const Config& cfg) {
+    g_pool.clear();
+    int n = cfg.pg_pool_size > 0 ? cfg.pg_pool_size : 1;
+    for (int i = 0; i < n; ++i) g_pool.push_back(std::make_unique<std::mutex>());
+    log_info("In-memory DB: pool=" + std::to_string(n) +
+             " latency=" + std::to_string(g_opts.latency_us) + "us" +
+             " jitter=" + std::to_string(g_opts.jitter_us) + "us");
+    return true;
+}
+
+bool db_put(const std::string& key, const std::string& value, DbTiming* timing) {
+    Call call(timing);
+    std::lock_guard<std::mutex> lk(g_rows_mu);
+    g_rows[key] = value;
+    return true;
+}
+
+bool db_get(const std::string& key, std::string& value_out, DbTiming* timing) {
+    Call call(timing);
+    std::lock_guard<std::mutex> lk(g_rows_mu);
+    auto it = g_rows.find(key);
+    if (it == g_rows.end()) return false;
+    value_out = it->second;
+    return true;
+}
+
+bool db_delete(const std::string& key, DbTiming* timing) {
+    Call call(timing);
+    std::lock_guard<std::mutex> lk(g_rows_mu);
+    return g_rows.erase(key) > 0;
+}
+
+void db_close() {
+    g_pool.clear();
+}
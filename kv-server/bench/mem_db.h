@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+// In-memory stand-in for database.cpp (the db_* functions of database.h),
+// linked into bench-server instead of the PostgreSQL one. It keeps
+// database.cpp's pool model: pg_pool_size slots picked round-robin, each
+// held for the whole call, so injected latency turns into pool queueing
+// the same way a slow PostgreSQL would.
+
+/** Latency added to every db_* call while its pool slot is held. */
+struct MemDbOptions {
+    int latency_us = 0;   // fixed part
+    int jitter_us  = 0;   // plus uniform [0, jitter_us]
+};
+
+/** Set before db_init(). */
+void mem_db_configure(const MemDbOptions& opts);
+
+/** Store a row directly: no pool, no latency (for filling the keyspace). */
+void mem_db_load(const std::string& key, const std::string& value);
@@ -4,6 +4,7 @@
 
 struct Config {
     // Server
+    std::string server_host      = "0.0.0.0";   // address to bind
     int         server_port      = 8080;
     int         thread_pool_size = 8;
     std::size_t cache_size       = 20000;
@@ -18,6 +19,9 @@ struct Config {
 
     // Optional: CPU affinity (comma-separated CPU ids, e.g., "0-1" or "2,3")
     std::string cpu_affinity     = "";
+
+    // Send a Server-Timing header (pool_wait / cache / db / total) on KV responses
+    bool        server_timing    = false;
 };
 
 /** Parse server config from command-line args (argv of kv-server). */
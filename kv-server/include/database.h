@@ -1,13 +1,21 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include "config.h"
 
+/** Where a db_* call spent its time, in microseconds. */
+struct DbTiming {
+    std::int64_t wait_us = 0;   // waiting for a pool connection
+    std::int64_t exec_us = 0;   // round trip to PostgreSQL
+};
+
 /**
  * PostgreSQL-backed KV store.
  * Functions are thread-safe via internal pooling & mutexes.
+ * If timing is non-null, the call's durations are added to it.
  */
 bool db_init(const Config& cfg);
-bool db_put(const std::string& key, const std::string& value);
-bool db_get(const std::string& key, std::string& value_out);
-bool db_delete(const std::string& key);
+bool db_put(const std::string& key, const std::string& value, DbTiming* timing = nullptr);
+bool db_get(const std::string& key, std::string& value_out, DbTiming* timing = nullptr);
+bool db_delete(const std::string& key, DbTiming* timing = nullptr);
 void db_close();
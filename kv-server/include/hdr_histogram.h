@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+/**
+ * Fixed-memory High Dynamic Range histogram (log-linear buckets).
+ *
+ * Values are integers in caller-chosen units (kv-loadgen records microseconds).
+ * Any value in [lowest, highest] is stored with a relative error of at most
+ * 10^-sig_figs. Not thread-safe: keep one per thread and merge() at the end.
+ */
+class HdrHistogram {
+public:
+    HdrHistogram(std::int64_t lowest = 1,
+                 std::int64_t highest = 3600LL * 1000 * 1000, // 1 hour in us
+                 int sig_figs = 3);
+
+    /** Record a value; values outside [0, highest] are clamped. */
+    void record(std::int64_t value, std::int64_t count = 1);
+
+    /** Add all counts of another histogram with the same layout. */
+    bool merge(const HdrHistogram& other);
+
+    void reset();
+
+    std::int64_t count() const { return total_; }
+    std::int64_t min() const;
+    std::int64_t max() const;
+    double       mean() const;
+    double       stddev() const;
+
+    /** Value at percentile p (0..100), reported as the bucket's highest equivalent value. */
+    std::int64_t value_at_percentile(double p) const;
+
+    /**
+     * Write the percentile distribution in HdrHistogram's text format
+     * (Value, Percentile, TotalCount, 1/(1-Percentile)). Values are divided
+     * by unit_scale, e.g. 1000.0 to print microseconds as milliseconds.
+     */
+    void write_percentiles(std::ostream& out, double unit_scale = 1.0,
+                           int ticks_per_half = 5) const;
+
+    // Layout / raw access (used to ship histograms between processes)
+    std::int64_t lowest() const  { return lowest_; }
+    std::int64_t highest() const { return highest_; }
+    int          sig_figs() const { return sig_figs_; }
+    const std::vector<std::int64_t>& counts() const { return counts_; }
+    bool         set_counts(const std::vector<std::int64_t>& counts);
+
+private:
+    std::int64_t lowest_;
+    std::int64_t highest_;
+    int          sig_figs_;
+
+    int          unit_magnitude_;
+    int          sub_bucket_half_count_magnitude_;
+    std::int64_t sub_bucket_count_;
+    std::int64_t sub_bucket_half_count_;
+    std::int64_t sub_bucket_mask_;
+    int          bucket_count_;
+
+    std::vector<std::int64_t> counts_;
+    std::int64_t total_     = 0;
+    std::int64_t min_value_ = INT64_MAX;
+    std::int64_t max_value_ = 0;
+
+    int          bucket_index(std::int64_t v) const;
+    std::size_t  counts_index(std::int64_t v) const;
+    std::int64_t value_at_index(std::size_t idx) const;
+    std::int64_t lowest_equivalent(std::int64_t v) const;
+    std::int64_t highest_equivalent(std::int64_t v) const;
+    std::int64_t median_equivalent(std::int64_t v) const;
+    void         recompute_totals();
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+/** Parameters for a key-index distribution over [0, keys). */
+struct KeyDistConfig {
+    std::string name           = "uniform"; // uniform|zipf|hotspot|latest|exponential
+
+    double      zipf_theta     = 0.99;      // zipf/latest skew, 0 < theta < 1
+
+    std::size_t hot_keys       = 5;         // hotspot: size of the hot set
+    double      hot_prob       = 0.9;       // hotspot: fraction of requests to the hot set
+
+    double      exp_percentile = 95.0;      // exponential: this % of requests fall...
+    double      exp_fraction   = 0.1;       // ...within this fraction of the keyspace
+
+    // Hash ranks onto the keyspace so popular keys aren't numerically adjacent.
+    // "auto" scrambles zipf and exponential only.
+    std::string scramble       = "auto";    // auto|on|off
+};
+
+/**
+ * Key-index generator. Instances are immutable after construction, so one
+ * instance can be shared by all client threads; each thread passes its own RNG.
+ */
+class KeyDistribution {
+public:
+    virtual ~KeyDistribution() = default;
+    virtual std::uint64_t next(std::mt19937_64& rng) const = 0;
+};
+
+/** Build a distribution over [0, keys). Throws std::invalid_argument on bad params. */
+std::unique_ptr<KeyDistribution> make_key_distribution(const KeyDistConfig& cfg,
+                                                       std::uint64_t keys);
+
+/** FNV-1a hash of a 64-bit value (YCSB-style key scrambling). */
+std::uint64_t fnv1a64(std::uint64_t v);
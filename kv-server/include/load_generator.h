@@ -1,25 +1,138 @@
 #pragma once
 #include <string>
 #include <cstdint>
+#include <vector>
+#include "key_dist.h"
 
 struct LoadGenConfig {
     std::string host        = "127.0.0.1";
     int         port        = 8080;
 
     int         clients     = 16;
+
+    // Request engine: "threads" = one blocking client thread per client,
+    // "epoll" = io_threads event loops multiplexing all clients as non-blocking
+    // connections, each with up to `pipeline` requests in flight.
+    std::string engine      = "threads";
+    int         io_threads  = 0;    // epoll: 0 = one per core
+    int         pipeline    = 1;    // epoll: max in-flight requests per connection
+    // Connection reuse: "keepalive", "per-request" or "per-<n>" (epoll only
+    // unless keepalive); conn_reuse is the parsed request count, 0 = unlimited
+    std::string conn_mode   = "keepalive";
+    int         conn_reuse  = 0;
     int         warmup_s    = 60;
     int         measure_s   = 300;
+    // --warmup auto: measure from the first --interval at which throughput
+    // and p99 have settled (SteadyStateDetector), warmup_max_s at the latest
+    bool        warmup_auto  = false;
+    int         warmup_max_s = 300;
 
-    std::string workload    = "get-popular"; // get-popular, get-all, put-all, mixed
+    std::string workload    = "get-popular"; // get-popular, get-all, put-all, mixed, ycsb-a..ycsb-f
     std::size_t keys        = 500;
 
     double      put_ratio   = 0.1;  // for mixed
     double      delete_ratio= 0.0;  // for mixed
 
+    // YCSB core workloads: key names are "user" + key index, FNV-hashed
+    // ("hashed", YCSB's default) or as is ("ordered"). Inserts append after
+    // the loaded --keys; scans read 1..scan_max consecutive keys.
+    std::string insert_order  = "hashed";   // hashed|ordered
+    int         scan_max      = 100;
+    std::uint64_t insert_offset = 0;        // --insert-part i/n: this process's share
+    std::uint64_t insert_stride = 1;        // of the insert keyspace (set by the coordinator)
+
+    // PUT payload sizes (see value_gen.h); empty = legacy "v<client>" values
+    std::string value_size  = "";
+
+    // Key popularity; empty name = workload default (hotspot for get-popular,
+    // uniform otherwise)
+    KeyDistConfig keydist   = KeyDistConfig{""};
+
+    // > 0: the hot region moves to another part of the keyspace every
+    // hotset_shift_s seconds of the measurement window, abruptly or (ramp > 0)
+    // with traffic migrating to it linearly over hotset_ramp_s seconds
+    double        hotset_shift_s = 0.0;
+    double        hotset_ramp_s  = 0.0;
+
+    // --profile: JSON load shape (see load_profile.h) driving --rate or the
+    // active client count; the measurement window becomes its length
+    std::string   profile_file   = "";
+
     std::uint64_t seed      = 12345;
 
+    // --preload: write every key index in [0, keys) once before the run, as
+    // pipelined PUTs over preload_conns epoll connections, or with COPY
+    // straight into PostgreSQL when pg_conninfo is set. The run only starts
+    // if every key is confirmed.
+    bool        preload          = false;
+    bool        preload_only     = false;  // exit after the preload
+    std::string pg_conninfo      = "";     // empty = preload through the server
+    int         preload_conns    = 16;
+    int         preload_pipeline = 32;     // HTTP: PUTs in flight per connection
+
+    // --direct-db: the client threads call kv-server's db_get / db_put /
+    // db_delete themselves instead of going through HTTP, against
+    // pg_conninfo (empty = kv-server's default) with db_pool connections
+    // (0 = one per client)
+    bool        direct_db        = false;
+    int         db_pool          = 0;
+
+    // --calibrate: measure kv-loadgen's own ceiling per connection model
+    // against an in-process null server, saved to calibration_file if set.
+    // Ordinary runs given a calibration_file warn when they get close to it.
+    bool        calibrate        = false;
+    std::string calibration_file = "";
+
+    // Open-loop mode: if rate_rps > 0, requests are issued on a fixed schedule
+    // (split evenly across clients) instead of back-to-back, and latency is
+    // measured from each request's intended send time.
+    double      rate_rps    = 0.0;
+    std::string arrival     = "poisson"; // poisson|uniform
+
     std::string csv_file    = "";   // if empty, no csv written
+    std::string hist_log    = "";   // if set, full latency distribution is written here
+
+    // Per-interval time series (throughput, latency, /metrics deltas, CPU, disk)
+    std::string timeseries_file = "";
+    double      interval_s      = 1.0;
+
+    // System sampling over the measurement window
+    std::string      cores             = "";   // e.g. "0-1"; empty = all cores
+    std::vector<int> server_pids;              // processes (plus children) to sample
+    double           sample_interval_s = 1.0;
+
+    // --find-knee: search the load axis for the highest throughput whose p99
+    // stays within slo_p99_ms, in steady-state-detected steps of --interval
+    // samples (each step capped at knee_step_s)
+    bool        find_knee      = false;
+    std::string knee_axis      = "";     // clients|rate; empty = rate with --rate, else clients
+    double      slo_p99_ms     = 10.0;
+    double      knee_max       = 0.0;    // 0 = 32768 clients / 1e6 req/s
+    double      knee_step_s    = 20.0;
+    double      knee_tolerance = 0.1;    // stop bisecting once hi/lo < 1 + tolerance
+    int         knee_max_steps = 16;
+    std::string knee_out       = "";     // throughput/latency curve CSV
+
+    // Distributed runs: a coordinator splits clients and rate across worker
+    // processes, starts them together and merges their histograms
+    bool        coordinator    = false;
+    int         workers        = 0;      // spawn this many local workers
+    std::string worker_sockets = "";     // and/or connect to these --worker-listen paths
+    std::string worker_listen  = "";     // run as a long-lived worker on this Unix socket
+    int         worker_fd      = -1;     // internal: spawned worker's end of a socketpair
+
+    std::vector<std::string> args;       // command line as given, forwarded to workers
 };
 
 int run_loadgen(const LoadGenConfig& cfg);
+int run_knee_search(const LoadGenConfig& cfg);
+int run_coordinator(const LoadGenConfig& cfg);
+int run_worker(const LoadGenConfig& cfg);
+int run_calibration(const LoadGenConfig& cfg);
+
+/** Fill the keyspace (--preload). Returns false if not every key was confirmed. */
+bool run_preload(const LoadGenConfig& cfg);
+
+/** Open the PostgreSQL pool for --direct-db. Returns false (logged) on failure. */
+bool direct_db_open(const LoadGenConfig& cfg);
 LoadGenConfig parse_loadgen_args(int argc, char** argv);
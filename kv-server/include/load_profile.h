@@ -0,0 +1,75 @@
+#pragma once
+#include "load_generator.h"
+#include "loadgen_engine.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * --profile: the load over the measurement window as a sequence of phases,
+ * read from JSON. A profile drives either the open-loop offered rate
+ * ("by": "rate", the default) or the number of active closed-loop clients
+ * ("by": "clients"); each phase sets that target with one of four shapes:
+ *
+ *   {"name": "base",  "duration": 30, "target": 2000}
+ *   {"name": "ramp",  "duration": 60, "shape": "ramp",   "from": 2000, "to": 8000}
+ *   {"name": "burst", "duration": 60, "shape": "square", "low": 2000, "high": 8000,
+ *                                      "period": 10, "duty": 0.2}
+ *   {"name": "day",   "duration": 300, "shape": "sine",  "mean": 5000, "amplitude": 3000,
+ *                                      "period": 120}
+ *
+ * Step changes are consecutive constant phases. A phase may also set
+ * "workload" (and "put_ratio" / "delete_ratio" for mixed) to change the
+ * operation mix; keys and the key distribution stay the run's.
+ */
+
+struct ProfilePhase {
+    std::string name;
+    std::string shape      = "constant";  // constant|ramp|square|sine
+    double      start_s    = 0.0;         // offset into the profile
+    double      duration_s = 0.0;
+
+    double      target    = 0.0;          // constant
+    double      from      = 0.0;          // ramp: linear from -> to
+    double      to        = 0.0;
+    double      low       = 0.0;          // square: high for duty of each period, then low
+    double      high      = 0.0;
+    double      duty      = 0.5;
+    double      mean      = 0.0;          // sine: mean + amplitude * sin(2 pi t / period)
+    double      amplitude = 0.0;
+    double      period_s  = 0.0;          // square, sine
+
+    std::string workload;                 // as --workload; empty = the run's
+    OpMix       mix;
+
+    /** Target t seconds into this phase. */
+    double target_at(double t) const;
+    /** Average target over the phase. */
+    double mean_target() const;
+    /** "ramp 2000->8000" etc., for the summary. */
+    std::string describe() const;
+};
+
+class LoadProfile {
+public:
+    /** Read and validate a profile. Throws std::runtime_error. */
+    static LoadProfile load(const std::string& path, const LoadGenConfig& cfg);
+
+    bool        by_rate() const { return by_rate_; }
+    double      duration_s() const { return duration_s_; }
+    /** Highest target anywhere in the profile (> 0). */
+    double      peak() const { return peak_; }
+
+    const std::vector<ProfilePhase>& phases() const { return phases_; }
+
+    /** Phase at t seconds into the profile; before 0 the first, past the end the last. */
+    std::size_t phase_at(double t) const;
+    double      target_at(double t) const;
+
+private:
+    bool                      by_rate_    = true;
+    double                    duration_s_ = 0.0;
+    double                    peak_       = 0.0;
+    std::vector<ProfilePhase> phases_;
+};
@@ -0,0 +1,487 @@
+#pragma once
+#include "hdr_histogram.h"
+#include "key_dist.h"
+#include "load_generator.h"
+#include "server_metrics.h"
+#include "sys_stats.h"
+#include "value_gen.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Internals shared by kv-loadgen's request engines. run_measurement() builds a
+ * RunContext, hands it to one engine (thread-per-client or epoll), and
+ * collects ctx.stats into a RunResult once the engine returns; report_run()
+ * prints and writes it.
+ */
+
+using LgClock = std::chrono::steady_clock;
+
+class LoadProfile;
+
+enum class Op { GET, PUT, DEL };
+
+/**
+ * Logical operation, the unit latency is reported per. Most are a single
+ * request; a YCSB scan is a run of GETs and a read-modify-write a GET then a
+ * PUT of the same key (kv-server has no range or conditional operations).
+ */
+enum class OpKind { READ, UPDATE, INSERT, DELETE, SCAN, RMW };
+constexpr std::size_t kOpKinds = 6;
+
+const char* op_kind_name(OpKind kind);
+
+/** How an operation ended: status class of its last (or first failing) response. */
+enum class StatusClass { OK, NOT_FOUND, OTHER, SERVER_ERROR, TRANSPORT };
+constexpr std::size_t kStatusClasses = 5;
+
+/** 2xx, 404, other, 5xx, error; status <= 0 means no response (transport error). */
+StatusClass status_class(int status);
+const char* status_class_name(StatusClass sc);
+
+/** Where kv-server served a successful GET from, per its X-Cache header. */
+enum class ReadSource { UNKNOWN, CACHE, DB };
+constexpr std::size_t kReadSources = 2;   // CACHE, DB
+
+const char* read_source_name(ReadSource src);
+
+/**
+ * kv-server's Server-Timing header (kv-server --server-timing), in us:
+ * "pool_wait;dur=0.004, cache;dur=0.002;desc=hit, db;dur=0.811, total;dur=0.840".
+ */
+struct ServerTiming {
+    int64_t pool_wait_us = 0;   // waiting for a PostgreSQL pool connection
+    int64_t cache_us     = 0;
+    int64_t db_us        = 0;
+    int64_t total_us     = 0;   // handler start to response ready
+
+    void add(const ServerTiming& o) {
+        pool_wait_us += o.pool_wait_us;
+        cache_us     += o.cache_us;
+        db_us        += o.db_us;
+        total_us     += o.total_us;
+    }
+};
+
+/** Parse a Server-Timing value; false if it has no total. */
+bool parse_server_timing(std::string_view v, ServerTiming& out);
+
+/**
+ * Client-observed latency of an operation split with its Server-Timing:
+ * the server's wait for a pool connection, service (the rest of the
+ * server's total) and what's left for network and client, which includes
+ * waiting behind pipelined requests and for an HTTP worker thread.
+ */
+enum class LatencyPart { NETWORK, POOL_WAIT, SERVICE };
+constexpr std::size_t kLatencyParts = 3;
+
+const char* latency_part_name(LatencyPart part);
+
+/** One finished operation, as handed to RunStats::record(). */
+struct Outcome {
+    OpKind       kind    = OpKind::READ;
+    bool         success = false;
+    int          status  = 0;                   // HTTP status; <= 0 = transport error
+    ReadSource   source  = ReadSource::UNKNOWN; // single-GET reads only
+    bool         timed   = false;               // every response had Server-Timing
+    ServerTiming timing;                        // summed over the operation's requests
+    int          phase   = -1;                  // --profile phase it completed in
+};
+
+/** Operation mix of a workload; the fractions sum to 1. */
+struct OpMix {
+    double read   = 1.0;
+    double update = 0.0;
+    double insert = 0.0;
+    double del    = 0.0;
+    double scan   = 0.0;
+    double rmw    = 0.0;
+};
+
+/** Mix of cfg.workload (with --put-ratio / --delete-ratio for mixed). Throws on bad input. */
+OpMix workload_mix(const LoadGenConfig& cfg);
+
+// Open-loop sends that start more than this after their intended time count as late
+constexpr int64_t kLateSlackUs = 1000;
+
+/**
+ * Latency recorder: one HDR histogram (microseconds) per client thread, capped
+ * at a few per core so memory stays fixed with thousands of clients; beyond
+ * that, clients share recorders round-robin. The mutex is effectively
+ * uncontended and only exists so recorders can be shared and drained.
+ */
+struct Recorder {
+    std::mutex   mu;
+    HdrHistogram hist;           // measurement window only
+
+    // Latency in the measurement window per operation, status class and
+    // read source; created on first use
+    std::unique_ptr<HdrHistogram> by_kind[kOpKinds];
+    std::unique_ptr<HdrHistogram> by_status[kStatusClasses];
+    std::unique_ptr<HdrHistogram> by_source[kReadSources];
+    std::unique_ptr<HdrHistogram> by_part[kLatencyParts];
+
+    // --profile: measurement-window outcomes per phase, grown on first use
+    struct PhaseStats {
+        HdrHistogram hist;
+        uint64_t     ok   = 0;
+        uint64_t     fail = 0;
+    };
+    std::vector<std::unique_ptr<PhaseStats>> by_phase;
+
+    // Time from connect() to an established connection, measurement window only
+    std::unique_ptr<HdrHistogram> connect;
+
+    // Rolling per-interval state for --timeseries, drained by the sampler
+    HdrHistogram interval;
+    uint64_t     interval_ok   = 0;
+    uint64_t     interval_fail = 0;
+};
+
+/** Counters and latency recorders for one run. */
+struct RunStats {
+    std::atomic<uint64_t> ok{0};
+    std::atomic<uint64_t> fail{0};
+    std::atomic<uint64_t> kind_ok[kOpKinds]   = {};
+    std::atomic<uint64_t> kind_fail[kOpKinds] = {};
+
+    // Open-loop schedule accounting
+    std::atomic<uint64_t> late{0};      // sent more than kLateSlackUs after intended time
+    std::atomic<uint64_t> missed{0};    // intended inside the window but never sent
+    std::atomic<int64_t>  max_lag_us{0};
+
+    // Payload bytes inside the measurement window (PUT values out, response bodies in)
+    std::atomic<uint64_t> tx_bytes{0};
+    std::atomic<uint64_t> rx_bytes{0};
+
+    // Connections opened / failed to open inside the measurement window
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint64_t> connect_fail{0};
+
+    bool track_intervals = false;
+    std::vector<std::unique_ptr<Recorder>> recorders;
+
+    /** Create the recorders for `clients` clients (a few per core at most). */
+    void init_recorders(int clients);
+
+    Recorder& recorder_for(std::size_t slot) { return *recorders[slot % recorders.size()]; }
+
+    /** Merge and reset every recorder's interval state (requires track_intervals). */
+    void drain_interval(HdrHistogram& into, uint64_t& iv_ok, uint64_t& iv_fail);
+
+    /** Record one completed operation (latency in us). */
+    void record(Recorder& rec, const Outcome& o, int64_t us, bool in_window);
+
+    void count_bytes(uint64_t tx, uint64_t rx, bool in_window) {
+        if (!in_window) return;
+        if (tx) tx_bytes.fetch_add(tx, std::memory_order_relaxed);
+        if (rx) rx_bytes.fetch_add(rx, std::memory_order_relaxed);
+    }
+
+    /** Account an open-loop send that started lag_us after its intended time. */
+    void note_lag(int64_t lag_us);
+
+    /** Account a connection attempt that took us (ok) or failed. */
+    void record_connect(Recorder& rec, bool ok, int64_t us, bool in_window);
+};
+
+/**
+ * Completed-insert high-water mark, as YCSB's AcknowledgedCounterGenerator:
+ * inserts are issued in sequence but finish out of order, and only the
+ * prefix whose inserts have all finished is known to exist.
+ */
+class AckedCounter {
+public:
+    /** Insert n (0-based, in issue order) finished. */
+    void acknowledge(uint64_t n);
+
+    /** Inserts [0, limit()) have all finished. */
+    uint64_t limit() const { return limit_.load(std::memory_order_acquire); }
+
+private:
+    std::mutex                   mu_;
+    std::unordered_set<uint64_t> done_;   // finished above limit_, waiting for the gap to close
+    std::atomic<uint64_t>        limit_{0};
+};
+
+struct RunContext {
+    const LoadGenConfig& cfg;
+
+    LgClock::time_point start;
+
+    // Measurement window (warmup_end, measure_end]. Atomic because
+    // --warmup auto moves it while the engines run; see set_window().
+    std::atomic<LgClock::rep> warmup_end_rep{0};
+    std::atomic<LgClock::rep> measure_end_rep{0};
+
+    LgClock::time_point warmup_end() const {
+        return LgClock::time_point(LgClock::duration(warmup_end_rep.load(std::memory_order_relaxed)));
+    }
+    LgClock::time_point measure_end() const {
+        return LgClock::time_point(LgClock::duration(measure_end_rep.load(std::memory_order_relaxed)));
+    }
+    void set_window(LgClock::time_point warmup_end, LgClock::time_point measure_end) {
+        warmup_end_rep.store(warmup_end.time_since_epoch().count(), std::memory_order_relaxed);
+        measure_end_rep.store(measure_end.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    bool open_loop = false;
+    OpMix mix;
+    const KeyDistribution* keydist = nullptr;
+    bool  follow_inserts = false;              // keydist is "latest": shift by the inserts so far
+    const ValueGenerator*  values  = nullptr;  // null: legacy "v<client>" values
+
+    // YCSB inserts: this process's n-th insert gets key index
+    // keys + n * insert_stride + insert_offset (see --insert-part).
+    // inserts counts issued ones, acked_inserts the ones known to be done,
+    // which is what reads and scans may target.
+    std::atomic<uint64_t> inserts{0};
+    AckedCounter          acked_inserts;
+
+    // > 0: write key indexes [0, fill_keys) once each instead of the workload
+    // (--preload); failed writes are queued again, and RequestSource::next()
+    // runs dry once every key has been handed out
+    uint64_t fill_keys = 0;
+    std::mutex            fill_mu;
+    std::vector<uint64_t> fill_retry;
+    std::atomic<bool>     fill_retry_pending{false};
+
+    /** Queue a failed fill_keys write for another attempt (no-op otherwise). */
+    void retry_fill(uint64_t index) {
+        if (fill_keys == 0) return;
+        std::lock_guard<std::mutex> lk(fill_mu);
+        fill_retry.push_back(index);
+        fill_retry_pending.store(true, std::memory_order_release);
+    }
+
+    // --hotset-shift: drawn key indexes are rotated by region * hotset_stride,
+    // moving whatever the distribution makes hot to another part of the keyspace
+    uint64_t hotset_stride = 0;     // 0: no shifting
+
+    /** Hot-set region at t: 0 until warmup ends, then one more every --hotset-shift seconds. */
+    uint64_t hotset_region(LgClock::time_point t) const;
+    /** Rotate a drawn key index into the current region; during a --hotset-ramp, the old or new one. */
+    uint64_t shift_hotset(uint64_t index, std::mt19937_64& rng) const;
+
+    // --profile: the load shape over the measurement window (warmup runs
+    // at its starting level). Rate profiles thin each client's arrivals
+    // from the peak rate; client profiles idle clients above the target.
+    const LoadProfile* profile = nullptr;
+
+    /** Seconds into the profile at t (0 during warmup). */
+    double profile_time(LgClock::time_point t) const;
+    /** Profile phase at t, -1 without a profile. */
+    int    phase_at(LgClock::time_point t) const;
+    /** Operation mix at t: the phase's with a profile, else mix. */
+    const OpMix& mix_at(LgClock::time_point t) const;
+    /** Whether a closed-loop client should send at t (always, without a clients profile). */
+    bool   client_active(int client_id, LgClock::time_point t) const;
+
+    RunStats stats;
+
+    // Set to end the run before measure_end() (e.g. once a step is steady);
+    // engines notice within ~100 ms.
+    std::atomic<bool> stop{false};
+
+    /** An operation finished: queue a failed fill write again, acknowledge an insert. */
+    void complete(OpKind kind, uint64_t index, bool success) {
+        if (!success) retry_fill(index);
+        if (kind == OpKind::INSERT) {
+            acked_inserts.acknowledge((index - cfg.keys - cfg.insert_offset) / cfg.insert_stride);
+        }
+    }
+
+    explicit RunContext(const LoadGenConfig& c) : cfg(c) {}
+
+    bool in_window(LgClock::time_point t) const { return t > warmup_end() && t <= measure_end(); }
+    bool finished(LgClock::time_point now) const {
+        return now >= measure_end() || stop.load(std::memory_order_relaxed);
+    }
+};
+
+/** Operation mix, key distribution and value pool, shared (read-only) by all clients of a run. */
+struct WorkloadGenerators {
+    OpMix                            mix;
+    std::unique_ptr<KeyDistribution> keydist;
+    bool                             follow_inserts = false;
+    uint64_t                         hotset_stride  = 0;   // see RunContext
+    std::unique_ptr<ValueGenerator>  values;   // null: legacy "v<client>" values
+};
+
+/** Throws on bad workload parameters (see make_key_distribution, ValueGenerator). */
+WorkloadGenerators make_workload_generators(const LoadGenConfig& cfg);
+
+/** Key name of key index idx: "key<idx>", or YCSB's "user<...>" for the ycsb-* workloads. */
+std::string make_key(const LoadGenConfig& cfg, uint64_t idx);
+
+/** One generated request. */
+struct RequestSpec {
+    Op          op        = Op::GET;
+    OpKind      kind      = OpKind::READ;
+    uint64_t    index     = 0;   // key index
+    int         remaining = 0;   // requests of the operation still to send after this one
+    std::string key;
+    std::string_view value;  // PUT only; points into the value pool, stays valid for the run
+};
+
+/**
+ * Picks operation, key and value for the configured workload. One per client
+ * (or per connection); the RNG is owned by the caller and may be shared by
+ * all clients of one engine thread.
+ */
+class RequestSource {
+public:
+    RequestSource(RunContext& ctx, std::mt19937_64& rng, int client_id);
+
+    /** First request of a new operation; false once a fill_keys run is out of keys. */
+    bool next(RequestSpec& out);
+
+    /**
+     * Turn a completed request with remaining > 0 into the next request of
+     * the same operation (the following scan key, or the write of a RMW).
+     */
+    void follow(RequestSpec& req);
+
+private:
+    // Existing keys in insert order: the loaded ones, then this process's
+    // acknowledged inserts. key_count() of them; rank <-> key index.
+    uint64_t key_count() const;
+    uint64_t existing_key(uint64_t rank) const;
+    uint64_t existing_rank(uint64_t index) const;
+
+    RunContext&       ctx_;
+    std::mt19937_64&  rng_;
+    std::string       legacy_value_;
+};
+
+/** Open-loop send schedule of one client: its share of --rate (or a rate --profile), Poisson or uniform. */
+class ArrivalSchedule {
+public:
+    ArrivalSchedule(const RunContext& ctx, std::mt19937_64& rng, int client_id);
+
+    LgClock::time_point intended() const { return intended_; }
+    void advance();
+
+    /** Count (and consume) the sends still scheduled inside the measurement window. */
+    uint64_t drain_missed();
+
+private:
+    LgClock::duration gap();
+    void thin();
+
+    const RunContext& ctx_;
+    std::mt19937_64&  rng_;
+    double            client_rate_;     // with a profile, its peak share
+    double            kept_ = 0.0;      // uniform arrivals under a profile: share carried over
+    std::exponential_distribution<double> gapdist_;
+    LgClock::time_point intended_;
+};
+
+/**
+ * Send one request of an operation and wait for it: payload bytes go into
+ * tx / rx, status, Server-Timing and read source into out. True on success.
+ */
+using SendRequestFn = std::function<bool(const RequestSpec& req, uint64_t& tx, uint64_t& rx, Outcome& out)>;
+
+/**
+ * Client id of a thread-per-client engine (threads, --direct-db) until
+ * ctx.finished(): open-loop pacing and lag / missed accounting, idling
+ * under a clients profile, follow-up requests and recording, with every
+ * request going through send.
+ */
+void run_blocking_client(RunContext& ctx, int id, const SendRequestFn& send);
+
+/** Engines: block until ctx.finished(), recording into ctx.stats. */
+void run_threads_engine(RunContext& ctx);
+void run_epoll_engine(RunContext& ctx);
+/** --direct-db: needs direct_db_open() first. */
+void run_direct_db_engine(RunContext& ctx);
+
+/** Run the engine selected by cfg.engine. */
+void run_engine(RunContext& ctx);
+
+/** Outcome of one measurement window, possibly merged from several processes. */
+struct RunResult {
+    bool         open_loop  = false;
+    uint64_t     ok         = 0;
+    uint64_t     fail       = 0;
+    uint64_t     late       = 0;
+    uint64_t     missed     = 0;
+    int64_t      max_lag_us = 0;
+    uint64_t     tx_bytes   = 0;
+    uint64_t     rx_bytes   = 0;
+    uint64_t     connects     = 0;
+    uint64_t     connect_fail = 0;
+    HdrHistogram latency;           // us, measurement window only
+    HdrHistogram connect_latency;   // us, successful connects in the window
+
+    // Warmup actually run: --warmup, or where --warmup auto found steady state
+    double       warmup_s      = 0.0;
+    bool         warmup_steady = false;   // --warmup auto: settled before --warmup-max
+
+    struct PerOp {
+        uint64_t     ok   = 0;
+        uint64_t     fail = 0;
+        HdrHistogram latency;
+    };
+    PerOp        ops[kOpKinds];     // by OpKind
+    HdrHistogram by_status[kStatusClasses];
+    HdrHistogram by_source[kReadSources];   // successful single-GET reads
+    HdrHistogram by_part[kLatencyParts];    // operations with Server-Timing
+
+    // --profile phases, named and sized by run_measurement
+    bool phases_by_rate = true;   // phase targets are req/s, else clients
+    struct Phase {
+        std::string  name;
+        std::string  shape;         // ProfilePhase::describe()
+        double       target     = 0.0;  // mean offered rate or clients
+        double       duration_s = 0.0;
+        uint64_t     ok         = 0;
+        uint64_t     fail       = 0;
+        HdrHistogram latency;
+    };
+    std::vector<Phase> phases;
+
+    // System sampling (not merged: the coordinator samples the server host itself)
+    bool         have_sys      = false;
+    SysRates     sys;
+    double       cpu_peak      = 0.0;
+    double       proc_cpu_peak = 0.0;
+
+    // Server /metrics deltas over the window (not merged either)
+    bool               have_srv = false;
+    ServerMetricsDelta srv;
+
+    /** Add another process's counters and latencies. */
+    void merge(const RunResult& other);
+};
+
+/**
+ * Run one warmup + measurement window starting at `start` (which may be in
+ * the future). sample_system = false skips /proc and /metrics sampling
+ * (worker processes).
+ */
+RunResult run_measurement(const LoadGenConfig& cfg, LgClock::time_point start, bool sample_system,
+                          const LoadProfile* profile = nullptr);
+
+/** "threads", "epoll/p<pipeline>[/<conn-mode>]" or "direct-db": what --calibrate results are keyed by. */
+std::string connection_model(const LoadGenConfig& cfg);
+
+/**
+ * Maximum rate of cfg's connection model in cfg.calibration_file, and the
+ * client count it was measured with; 0 (with a warning) if there is none.
+ */
+double calibrated_max_rps(const LoadGenConfig& cfg, int& clients);
+
+/** Print the summary and write --csv / --hist-log. */
+void report_run(const LoadGenConfig& cfg, const RunResult& res);
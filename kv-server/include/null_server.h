@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * Trivial in-process HTTP/1.1 responder for kv-loadgen --calibrate: answers
+ * every request with 200 and a tiny body, straight from the read buffer.
+ * Keep-alive, pipelining and Connection: close are honoured; nothing else
+ * about the request is looked at. Listens on 127.0.0.1, ephemeral port.
+ */
+class NullServer {
+public:
+    explicit NullServer(int threads) : threads_(threads < 1 ? 1 : threads) {}
+    ~NullServer() { stop(); }
+
+    NullServer(const NullServer&) = delete;
+    NullServer& operator=(const NullServer&) = delete;
+
+    /** Bind, listen and start the event-loop threads. False (logged) on failure. */
+    bool start();
+    void stop();
+
+    int port() const { return port_; }
+
+private:
+    void loop();
+
+    int                      threads_;
+    int                      listen_fd_ = -1;
+    int                      port_      = 0;
+    std::atomic<bool>        stop_{false};
+    std::vector<std::thread> loops_;
+};
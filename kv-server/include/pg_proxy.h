@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * kv-pgproxy: a TCP proxy to put between kv-server (or kv-loadgen
+ * --direct-db) and PostgreSQL, adding the network a loopback database
+ * doesn't have. Bytes are forwarded unchanged; what the proxy controls is
+ * when each chunk it reads is delivered:
+ *
+ *   - every chunk waits --latency-ms, plus a uniform 0..--jitter-ms,
+ *     in each direction (so the round trip grows by twice the latency);
+ *   - each direction is a link of --bandwidth Mbit/s shared by all
+ *     connections, a chunk occupying it for size / bandwidth;
+ *   - with probability --stall-prob per chunk, that direction's link
+ *     stops for --stall-ms, holding back every connection behind it.
+ *
+ * Delivery order within a connection is kept, whatever the jitter, and
+ * a connection holds back at most a fixed window per direction, so a
+ * sender faster than the link is slowed by TCP flow control.
+ */
+
+struct ProxyConfig {
+    std::string listen_host    = "127.0.0.1";
+    int         listen_port    = 6432;
+    std::string upstream_host  = "127.0.0.1";
+    int         upstream_port  = 5432;
+    double      latency_ms     = 0.0;   // one-way, added in each direction
+    double      jitter_ms      = 0.0;   // extra uniform 0..jitter_ms per chunk
+    double      bandwidth_mbps = 0.0;   // per direction, shared by all connections; 0 = unlimited
+    double      stall_prob     = 0.0;   // chance a chunk stalls its direction's link
+    double      stall_ms       = 0.0;   // length of a stall
+    uint64_t    seed           = 0;     // 0: random
+    int         stats_s        = 0;     // log traffic counters every stats_s seconds; 0 = off
+    std::string log_level      = "INFO";
+    std::string cpu_affinity;           // optional, as kv-server --cpu
+};
+
+/** Parse kv-pgproxy's command line; throws std::runtime_error on bad arguments. */
+ProxyConfig parse_proxy_args(int argc, char** argv);
+
+/** Accept and proxy connections until the process is killed. Non-zero if the listener can't be set up. */
+int run_proxy(const ProxyConfig& cfg);
@@ -0,0 +1,26 @@
+#pragma once
+#include <httplib.h>
+
+#include <cstddef>
+#include <string>
+
+// Per-request helpers of the HTTP handlers, kept out of server.cpp so that
+// bench-hotpath can time them on their own.
+
+/** Key of a "/op/(.+)" route (URL-decoded), empty if the route has no capture. */
+std::string extract_key(const httplib::Request& req);
+
+/** Value from ?value=... (URL-decoded), else the request body. */
+std::string extract_value(const httplib::Request& req);
+
+/** Counters served by /metrics. */
+struct MetricsSnapshot {
+    std::size_t requests_total = 0;
+    std::size_t errors_total   = 0;
+    std::size_t cache_hits     = 0;
+    std::size_t cache_misses   = 0;
+    std::size_t cache_capacity = 0;
+};
+
+/** /metrics response body (JSON object, one field per counter). */
+std::string render_metrics(const MetricsSnapshot& m);
@@ -1,5 +1,14 @@
 #pragma once
 #include "config.h"
 
-/** Blocking call: initialize DB, cache, HTTP server and run forever. */
-void run_server(const Config& cfg);
+#include <functional>
+
+/**
+ * For running the server inside another program (bench-server): called
+ * once the socket is listening, with the bound port (cfg.server_port 0
+ * picks an ephemeral one) and a function that makes run_server return.
+ */
+using ServerReadyFn = std::function<void(int port, std::function<void()> stop)>;
+
+/** Blocking call: initialize DB, cache, HTTP server and run until stopped. */
+void run_server(const Config& cfg, const ServerReadyFn& on_ready = nullptr);
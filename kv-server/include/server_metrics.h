@@ -0,0 +1,71 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace httplib { class Client; }
+
+/**
+ * kv-server's /metrics counters, scraped by kv-loadgen so server-side facts
+ * (request count, errors, cache hit ratio) land next to the client-side
+ * results. Scrape twice and diff with metrics_delta().
+ */
+
+struct ServerMetrics {
+    uint64_t requests_total = 0;
+    uint64_t errors_total   = 0;
+    uint64_t cache_hits     = 0;
+    uint64_t cache_misses   = 0;
+};
+
+struct ServerMetricsDelta {
+    uint64_t requests     = 0;
+    uint64_t errors       = 0;
+    uint64_t cache_hits   = 0;
+    uint64_t cache_misses = 0;
+
+    /** hits / (hits + misses), 0 without lookups. */
+    double hit_ratio() const;
+};
+
+/** Counter deltas from a to b; a counter that went backwards (server restart) counts from 0. */
+ServerMetricsDelta metrics_delta(const ServerMetrics& a, const ServerMetrics& b);
+
+/** Keep-alive /metrics client with short timeouts, so a dead server can't stall the caller. */
+class MetricsScraper {
+public:
+    MetricsScraper(const std::string& host, int port, int timeout_s = 1);
+    ~MetricsScraper();
+
+    /** Returns false if the server is unreachable or the body isn't the expected JSON. */
+    bool scrape(ServerMetrics& m);
+
+private:
+    std::unique_ptr<httplib::Client> cli_;
+};
+
+/**
+ * Scrapes /metrics at the start and end of [from, to] in a background
+ * thread. delta() is valid after join() if ok().
+ */
+class MetricsWindow {
+public:
+    MetricsWindow(const std::string& host, int port) : host_(host), port_(port) {}
+    ~MetricsWindow() { join(); }
+
+    void start(std::chrono::steady_clock::time_point from,
+               std::chrono::steady_clock::time_point to);
+    void join();
+
+    bool               ok() const { return ok_; }
+    ServerMetricsDelta delta() const { return delta_; }
+
+private:
+    std::string        host_;
+    int                port_;
+    std::thread        thread_;
+    bool               ok_ = false;
+    ServerMetricsDelta delta_;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/** Tolerances for SteadyStateDetector. */
+struct SteadyStateConfig {
+    std::size_t window        = 5;     // intervals that must look steady together
+    std::size_t skip          = 1;     // leading intervals always ignored (connection ramp-up)
+    double      max_cv        = 0.05;  // throughput stddev / mean within the window
+    double      max_drift     = 0.05;  // |throughput trend| across the window, relative to mean
+    double      max_p99_drift = 0.25;  // |p99 trend| across the window, relative to mean
+};
+
+/**
+ * Decides when a per-interval series (throughput, p99) has settled: the last
+ * `window` intervals must have a small coefficient of variation and no
+ * significant linear trend in either throughput or p99. A trend check is
+ * needed as well as the CV because a slow ramp (cache warming, growing
+ * backlog) can have a small CV over a short window.
+ */
+class SteadyStateDetector {
+public:
+    explicit SteadyStateDetector(SteadyStateConfig cfg = SteadyStateConfig{});
+
+    /** Feed one interval; returns steady(). */
+    bool add(double throughput, double p99);
+
+    bool steady() const { return steady_; }
+
+    /** Intervals fed so far. */
+    std::size_t size() const { return thr_.size(); }
+
+    /** Index of the first interval of the steady window (valid once steady()). */
+    std::size_t window_start() const { return thr_.size() - cfg_.window; }
+
+    const SteadyStateConfig& config() const { return cfg_; }
+
+    void reset();
+
+private:
+    SteadyStateConfig   cfg_;
+    std::vector<double> thr_;
+    std::vector<double> p99_;
+    bool                steady_ = false;
+};
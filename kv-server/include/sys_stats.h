@@ -0,0 +1,147 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Linux /proc sampling for kv-loadgen: CPU time on selected cores, system-wide
+ * context switches, per-device disk traffic, and CPU / context switches / I/O of
+ * the server under test. Take two samples with SysSampler::sample() and diff
+ * them with SysSampler::rates().
+ */
+
+struct CpuTimes {
+    unsigned long long user    = 0;
+    unsigned long long nice    = 0;
+    unsigned long long system  = 0;
+    unsigned long long idle    = 0;
+    unsigned long long iowait  = 0;
+    unsigned long long irq     = 0;
+    unsigned long long softirq = 0;
+    unsigned long long steal   = 0;
+
+    unsigned long long total() const {
+        return user + nice + system + idle + iowait + irq + softirq + steal;
+    }
+    unsigned long long idle_all() const { return idle + iowait; }
+};
+
+struct DiskCounters {
+    std::string        name;
+    unsigned long long read_sectors  = 0;
+    unsigned long long write_sectors = 0;
+    bool               stacked       = false; // dm-*/md*: traffic also counted on its members
+};
+
+struct ProcCounters {
+    int                pid   = 0;
+    int                root  = 0;   // the --server-pid this process was found under
+    unsigned long long utime = 0;   // clock ticks, all threads
+    unsigned long long stime = 0;
+    unsigned long long vctx  = 0;   // voluntary context switches, all threads
+    unsigned long long nvctx = 0;   // involuntary context switches, all threads
+    unsigned long long read_bytes  = 0;  // storage I/O from /proc/<pid>/io
+    unsigned long long write_bytes = 0;
+    bool               have_io     = false;
+};
+
+struct SysSample {
+    double             t_s = 0.0;       // steady clock, seconds
+    bool               have_cpu  = false;
+    CpuTimes           cpu;             // summed over the selected cores
+    unsigned long long ctxt      = 0;   // system-wide context switches
+    bool               have_disk = false;
+    std::vector<DiskCounters> disks;    // whole devices only
+    std::vector<ProcCounters> procs;
+};
+
+struct DiskRate {
+    std::string name;
+    double      read_MBps  = 0.0;
+    double      write_MBps = 0.0;
+};
+
+struct ProcRate {
+    int         pid         = 0;
+    std::string comm;
+    int         nprocs      = 0;    // the process plus its live children
+    double      cpu_pct     = 0.0;  // % of one core, like top
+    double      vctx_per_s  = 0.0;
+    double      nvctx_per_s = 0.0;
+    double      read_MBps   = 0.0;
+    double      write_MBps  = 0.0;
+    bool        have_io     = false;
+};
+
+struct SysRates {
+    double cpu_util        = 0.0;   // % of the selected cores
+    double ctxt_per_s      = 0.0;
+    double disk_read_MBps  = 0.0;   // summed over physical (non-stacked) devices
+    double disk_write_MBps = 0.0;
+    std::vector<DiskRate> disks;
+    std::vector<ProcRate> procs;    // one per --server-pid, children folded in
+
+    /** All server process trees summed. */
+    ProcRate total_proc() const;
+};
+
+class SysSampler {
+public:
+    /**
+     * cores: CPU ids to sample (empty = all cores).
+     * pids:  server processes; each is sampled together with its direct
+     *        children, so the postmaster pid covers all PostgreSQL backends.
+     */
+    SysSampler(std::vector<int> cores, std::vector<int> pids);
+
+    /** Returns false if nothing could be read (not Linux, /proc missing). */
+    bool sample(SysSample& s) const;
+
+    SysRates rates(const SysSample& a, const SysSample& b) const;
+
+    const std::vector<int>& cores() const { return cores_; }
+    const std::vector<int>& pids() const { return pids_; }
+
+private:
+    std::vector<int>         cores_;
+    std::vector<int>         pids_;
+    std::vector<std::string> comms_;    // comm of each pid, captured at construction
+    std::vector<std::string> whole_;    // whole-device names from /sys/block
+    std::vector<std::string> stacked_;  // subset of whole_ with members (dm, md)
+    double                   ticks_per_s_ = 100.0;
+};
+
+/**
+ * Samples a SysSampler over [from, to] every interval_s in a background
+ * thread. rates() covers the whole window; the peaks are the busiest single
+ * interval. Results are valid after join().
+ */
+class SysWindow {
+public:
+    SysWindow(const SysSampler& sampler, double interval_s);
+    ~SysWindow() { join(); }
+
+    void start(std::chrono::steady_clock::time_point from,
+               std::chrono::steady_clock::time_point to);
+    void join();
+
+    bool     ok() const { return ok_; }
+    SysRates rates() const { return ok_ ? sampler_.rates(first_, last_) : SysRates{}; }
+    double   cpu_peak() const { return cpu_peak_; }
+    double   proc_cpu_peak() const { return proc_cpu_peak_; }
+
+private:
+    const SysSampler& sampler_;
+    double            interval_s_;
+    std::thread       thread_;
+    SysSample         first_;
+    SysSample         last_;
+    bool              ok_            = false;
+    double            cpu_peak_      = 0.0;
+    double            proc_cpu_peak_ = 0.0;
+};
+
+/** Parse "0-1,4" (or "1234,5678") into ids. Throws std::invalid_argument. */
+std::vector<int> parse_id_list(const std::string& s);
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * PUT payload generator. Sizes follow a configured distribution; bytes are
+ * slices of one pool generated up front, so next() never allocates.
+ *
+ * Spec syntax (sizes accept k/m suffixes):
+ *   "<n>" or "fixed:<n>"         every value is n bytes
+ *   "uniform:<min>-<max>"        uniform in [min, max]
+ *   "pareto:<min>:<alpha>[:<max>]"  heavy tail starting at min, capped at max (default 1m)
+ *   "trace:<file>"               sizes sampled from a file, one size per line
+ *
+ * Immutable after construction: one instance can be shared by all threads.
+ */
+class ValueGenerator {
+public:
+    /** Throws std::invalid_argument on a bad spec or unreadable trace. */
+    explicit ValueGenerator(const std::string& spec, std::uint64_t seed = 1);
+
+    std::string_view next(std::mt19937_64& rng) const;
+
+    std::size_t max_size() const { return max_size_; }
+    double      mean_size() const { return mean_size_; }
+    const std::string& spec() const { return spec_; }
+
+private:
+    enum class Kind { FIXED, UNIFORM, PARETO, TRACE };
+
+    std::size_t next_size(std::mt19937_64& rng) const;
+
+    std::string spec_;
+    Kind        kind_       = Kind::FIXED;
+    std::size_t min_size_   = 0;
+    std::size_t max_size_   = 0;
+    double      alpha_      = 1.0;
+    double      mean_size_  = 0.0;
+    std::vector<std::uint32_t> trace_;
+    std::string pool_;
+};
+
+/** Parse "4096", "4k", "1m" into bytes. Throws std::invalid_argument. */
+std::size_t parse_byte_size(const std::string& s);
@@ -0,0 +1,135 @@
+#include "load_generator.h"
+#include "loadgen_engine.h"
+#include "null_server.h"
+#include "utils.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int kCalibrateWarmupS  = 1;
+constexpr int kCalibrateMeasureS = 5;
+
+// The null server shares the machine with kv-loadgen; a quarter of the
+// cores keeps it from being the bottleneck without starving the engines
+int null_server_threads() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return static_cast<int>(std::max(1u, hw / 4));
+}
+
+// Connection models to calibrate: both engines, plus the run's own
+// pipeline depth and connection churn where they differ
+std::vector<LoadGenConfig> calibration_models(const LoadGenConfig& base) {
+    std::vector<LoadGenConfig> models;
+    auto add = [&](const std::string& engine, int pipeline, const std::string& conn_mode, int conn_reuse) {
+        LoadGenConfig m = base;
+        m.engine     = engine;
+        m.pipeline   = pipeline;
+        m.conn_mode  = conn_mode;
+        m.conn_reuse = conn_reuse;
+        models.push_back(std::move(m));
+    };
+    add("threads", 1, "keepalive", 0);
+    add("epoll", 1, "keepalive", 0);
+    if (base.pipeline > 1) add("epoll", base.pipeline, "keepalive", 0);
+    add("epoll", 1, "per-request", 1);
+    if (base.conn_reuse > 1) add("epoll", 1, base.conn_mode, base.conn_reuse);
+    return models;
+}
+
+double ms(const HdrHistogram& h, double pct) {
+    return static_cast<double>(h.value_at_percentile(pct)) / 1000.0;
+}
+
+} // namespace
+
+std::string connection_model(const LoadGenConfig& cfg) {
+    if (cfg.direct_db) return "direct-db";
+    if (cfg.engine != "epoll") return "threads";
+    std::string m = "epoll/p" + std::to_string(cfg.pipeline);
+    if (cfg.conn_reuse > 0) m += "/" + cfg.conn_mode;
+    return m;
+}
+
+int run_calibration(const LoadGenConfig& base) {
+    NullServer null(null_server_threads());
+    if (!null.start()) return 1;
+
+    // Closed loop, as fast as the engine goes; workload and key generation
+    // stay the run's, since they are part of kv-loadgen's cost
+    LoadGenConfig cfg = base;
+    cfg.host      = "127.0.0.1";
+    cfg.port      = null.port();
+    cfg.rate_rps  = 0.0;
+    cfg.warmup_s  = kCalibrateWarmupS;
+    cfg.measure_s = kCalibrateMeasureS;
+    cfg.profile_file.clear();
+    cfg.hotset_shift_s = 0.0;
+    cfg.warmup_auto    = false;
+
+    log_info("Calibrating kv-loadgen against a null server on 127.0.0.1:" + std::to_string(null.port()) +
+             " (" + std::to_string(cfg.clients) + " clients, " +
+             std::to_string(kCalibrateWarmupS + kCalibrateMeasureS) + "s per model)");
+
+    json points = json::array();
+    std::cout << "Loadgen calibration (null server, " << cfg.clients << " clients, workload "
+              << cfg.workload << "):\n";
+    for (const LoadGenConfig& m : calibration_models(cfg)) {
+        RunResult res = run_measurement(m, LgClock::now(), false);
+        double max_rps = static_cast<double>(res.ok) / static_cast<double>(m.measure_s);
+        const std::string model = connection_model(m);
+        std::cout << "  " << std::left << std::setw(20) << model << std::right
+                  << " max=" << max_rps << " req/s"
+                  << " p50=" << ms(res.latency, 50.0)
+                  << "ms p99=" << ms(res.latency, 99.0)
+                  << "ms p99.9=" << ms(res.latency, 99.9) << "ms";
+        if (res.fail) std::cout << " fail=" << res.fail;
+        if (res.connects) std::cout << " connect_p50=" << ms(res.connect_latency, 50.0) << "ms";
+        std::cout << "\n";
+        points.push_back({{"model", model}, {"clients", m.clients}, {"max_rps", max_rps},
+                          {"p50_ms", ms(res.latency, 50.0)}, {"p99_ms", ms(res.latency, 99.0)},
+                          {"p999_ms", ms(res.latency, 99.9)}});
+    }
+    null.stop();
+
+    if (!base.calibration_file.empty()) {
+        std::ofstream out(base.calibration_file);
+        if (!out) {
+            log_error("Failed to write calibration file: " + base.calibration_file);
+            return 1;
+        }
+        out << json{{"workload", cfg.workload}, {"models", points}}.dump(2) << "\n";
+        log_info("Calibration written to " + base.calibration_file);
+    }
+    return 0;
+}
+
+double calibrated_max_rps(const LoadGenConfig& cfg, int& clients) {
+    std::ifstream in(cfg.calibration_file);
+    json j;
+    try {
+        if (!in) throw std::runtime_error("cannot open");
+        in >> j;
+        const std::string model = connection_model(cfg);
+        for (const auto& p : j.at("models")) {
+            if (p.at("model").get<std::string>() != model) continue;
+            clients = p.at("clients").get<int>();
+            return p.at("max_rps").get<double>();
+        }
+        log_warn("--calibration " + cfg.calibration_file + " has no entry for " + model +
+                 "; run --calibrate with the same --engine / --pipeline / --conn-mode");
+    } catch (const std::exception& e) {
+        log_warn("--calibration " + cfg.calibration_file + ": " + e.what());
+    }
+    return 0.0;
+}
@@ -0,0 +1,505 @@
+#include "load_generator.h"
+#include "loadgen_engine.h"
+#include "sys_stats.h"
+#include "utils.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Distributed load generation. A coordinator drives N worker processes over
+// Unix stream sockets (spawned over a socketpair, or connected to workers
+// started with --worker-listen). Messages are one JSON object per line:
+//
+//   coordinator -> worker   {"type":"config","args":[...]}   worker's command line
+//   worker -> coordinator   {"type":"ready"} | {"type":"error","message":...}
+//   coordinator -> worker   {"type":"start","at_ns":N}       system_clock start time
+//   worker -> coordinator   {"type":"result",...}            counters + histogram
+//
+// Each worker runs the usual warmup + measurement with its share of --clients
+// and --rate; the coordinator samples the server host itself and reports the
+// merged histogram and counters exactly like a single-process run.
+
+using json = nlohmann::json;
+
+namespace {
+
+// Lead time between READY from every worker and the common start
+constexpr auto kStartLead = std::chrono::milliseconds(500);
+// Allowance on top of warmup + measure before a worker counts as lost
+constexpr auto kResultGrace = std::chrono::seconds(30);
+constexpr int  kReadyTimeoutMs = 30 * 1000;
+
+// Coordinator/reporting options that must not be forwarded to workers
+// (second: takes a value)
+const std::vector<std::pair<std::string, bool>> kLocalOnlyArgs = {
+    {"--coordinator", false}, {"--workers", true}, {"--worker-sockets", true},
+    {"--worker-fd", true},    {"--worker-listen", true},
+    {"--csv", true},          {"--hist-log", true}, {"--timeseries", true},
+    {"--cores", true},        {"--server-pid", true}, {"--sample-interval", true},
+    {"--insert-part", true},
+    {"--preload", false},     {"--preload-only", false}, {"--pg", true},
+    {"--preload-conns", true}, {"--preload-pipeline", true},
+};
+
+// ---------- line-oriented socket I/O ----------
+
+bool send_line(int fd, const std::string& line) {
+    std::string buf = line + "\n";
+    std::size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t n = send(fd, buf.data() + off, buf.size() - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+/** Read one line; timeout_ms < 0 waits forever. False on EOF, error or timeout. */
+bool recv_line(int fd, std::string& buf, std::string& line, int timeout_ms) {
+    auto deadline = LgClock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+    for (;;) {
+        std::size_t nl = buf.find('\n');
+        if (nl != std::string::npos) {
+            line = buf.substr(0, nl);
+            buf.erase(0, nl + 1);
+            return true;
+        }
+
+        int wait = -1;
+        if (timeout_ms >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - LgClock::now());
+            if (left.count() <= 0) return false;
+            wait = static_cast<int>(left.count());
+        }
+        pollfd p{fd, POLLIN, 0};
+        int r = poll(&p, 1, wait);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+
+        char chunk[64 * 1024];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf.append(chunk, static_cast<std::size_t>(n));
+    }
+}
+
+bool recv_json(int fd, std::string& buf, json& out, int timeout_ms) {
+    std::string line;
+    if (!recv_line(fd, buf, line, timeout_ms)) return false;
+    try {
+        out = json::parse(line);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return out.is_object();
+}
+
+// ---------- RunResult <-> JSON ----------
+
+json hist_to_json(const HdrHistogram& h) {
+    json counts = json::array();
+    const auto& c = h.counts();
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        if (c[i] != 0) counts.push_back({i, c[i]});   // sparse: [index, count]
+    }
+    return json{{"lowest", h.lowest()},
+                {"highest", h.highest()},
+                {"sig_figs", h.sig_figs()},
+                {"counts", counts}};
+}
+
+bool hist_from_json(const json& h, HdrHistogram& out) {
+    HdrHistogram hist(h.at("lowest").get<int64_t>(), h.at("highest").get<int64_t>(),
+                      h.at("sig_figs").get<int>());
+    std::vector<int64_t> dense(hist.counts().size(), 0);
+    for (const auto& pair : h.at("counts")) {
+        std::size_t idx = pair.at(0).get<std::size_t>();
+        if (idx >= dense.size()) return false;
+        dense[idx] = pair.at(1).get<int64_t>();
+    }
+    if (!hist.set_counts(dense)) return false;
+    out = HdrHistogram{};
+    return out.merge(hist);  // layouts must match the local default
+}
+
+json result_to_json(const RunResult& r) {
+    json ops = json::array();
+    for (std::size_t k = 0; k < kOpKinds; ++k) {
+        const auto& o = r.ops[k];
+        if (o.ok + o.fail == 0) continue;
+        ops.push_back({{"kind", k}, {"ok", o.ok}, {"fail", o.fail}, {"hist", hist_to_json(o.latency)}});
+    }
+    json status = json::array();
+    for (const auto& h : r.by_status) status.push_back(hist_to_json(h));
+    json sources = json::array();
+    for (const auto& h : r.by_source) sources.push_back(hist_to_json(h));
+    json parts = json::array();
+    for (const auto& h : r.by_part) parts.push_back(hist_to_json(h));
+    return json{
+        {"type", "result"},
+        {"open_loop", r.open_loop},
+        {"ok", r.ok}, {"fail", r.fail},
+        {"late", r.late}, {"missed", r.missed}, {"max_lag_us", r.max_lag_us},
+        {"tx_bytes", r.tx_bytes}, {"rx_bytes", r.rx_bytes},
+        {"connects", r.connects}, {"connect_fail", r.connect_fail},
+        {"hist", hist_to_json(r.latency)},
+        {"connect_hist", hist_to_json(r.connect_latency)},
+        {"ops", ops},
+        {"status", status},
+        {"sources", sources},
+        {"parts", parts},
+    };
+}
+
+bool result_from_json(const json& j, RunResult& r) {
+    try {
+        r.open_loop  = j.at("open_loop").get<bool>();
+        r.ok         = j.at("ok").get<uint64_t>();
+        r.fail       = j.at("fail").get<uint64_t>();
+        r.late       = j.at("late").get<uint64_t>();
+        r.missed     = j.at("missed").get<uint64_t>();
+        r.max_lag_us = j.at("max_lag_us").get<int64_t>();
+        r.tx_bytes   = j.at("tx_bytes").get<uint64_t>();
+        r.rx_bytes   = j.at("rx_bytes").get<uint64_t>();
+        r.connects     = j.at("connects").get<uint64_t>();
+        r.connect_fail = j.at("connect_fail").get<uint64_t>();
+
+        if (!hist_from_json(j.at("hist"), r.latency)) return false;
+        if (!hist_from_json(j.at("connect_hist"), r.connect_latency)) return false;
+        for (const auto& o : j.at("ops")) {
+            std::size_t k = o.at("kind").get<std::size_t>();
+            if (k >= kOpKinds) return false;
+            r.ops[k].ok   = o.at("ok").get<uint64_t>();
+            r.ops[k].fail = o.at("fail").get<uint64_t>();
+            if (!hist_from_json(o.at("hist"), r.ops[k].latency)) return false;
+        }
+        const json& status = j.at("status");
+        const json& sources = j.at("sources");
+        const json& parts = j.at("parts");
+        if (status.size() != kStatusClasses || sources.size() != kReadSources ||
+            parts.size() != kLatencyParts) {
+            return false;
+        }
+        for (std::size_t s = 0; s < kStatusClasses; ++s) {
+            if (!hist_from_json(status[s], r.by_status[s])) return false;
+        }
+        for (std::size_t s = 0; s < kReadSources; ++s) {
+            if (!hist_from_json(sources[s], r.by_source[s])) return false;
+        }
+        for (std::size_t p = 0; p < kLatencyParts; ++p) {
+            if (!hist_from_json(parts[p], r.by_part[p])) return false;
+        }
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// ---------- worker side ----------
+
+// Serve one coordinator session on fd. Returns false if the session failed.
+bool serve_session(int fd) {
+    std::string buf;
+    json msg;
+    if (!recv_json(fd, buf, msg, -1) || msg.value("type", "") != "config") return false;
+
+    LoadGenConfig cfg;
+    try {
+        std::vector<std::string> args = msg.at("args").get<std::vector<std::string>>();
+        std::vector<char*> argv;
+        static char prog[] = "kv-loadgen";
+        argv.push_back(prog);
+        for (auto& a : args) argv.push_back(&a[0]);
+        cfg = parse_loadgen_args(static_cast<int>(argv.size()), argv.data());
+        // Fail before READY rather than after START
+        make_workload_generators(cfg);
+    } catch (const std::exception& e) {
+        send_line(fd, json{{"type", "error"}, {"message", e.what()}}.dump());
+        return false;
+    }
+    if (!send_line(fd, json{{"type", "ready"}}.dump())) return false;
+
+    if (!recv_json(fd, buf, msg, -1) || msg.value("type", "") != "start") return false;
+    auto at = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(msg.value("at_ns", int64_t{0}))));
+    LgClock::time_point start = LgClock::now() +
+        std::chrono::duration_cast<LgClock::duration>(at - std::chrono::system_clock::now());
+
+    log_info("Worker: clients=" + std::to_string(cfg.clients) +
+             " rate=" + std::to_string(cfg.rate_rps) + " engine=" + cfg.engine);
+    RunResult res = run_measurement(cfg, start, false);
+    return send_line(fd, result_to_json(res).dump());
+}
+
+int listen_unix(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        close(fd);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());  // stale socket from an earlier worker
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connect_unix(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ---------- coordinator side ----------
+
+struct Worker {
+    int         fd  = -1;
+    pid_t       pid = -1;     // spawned workers only
+    std::string name;
+    std::string buf;
+    RunResult   result;
+    bool        ok  = false;
+};
+
+// fork + exec ourselves as a worker on one end of a socketpair
+bool spawn_worker(Worker& w, int index) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // child: only the worker end survives exec
+        fcntl(sv[1], F_SETFD, 0);
+        std::string fd_arg = std::to_string(sv[1]);
+        execl("/proc/self/exe", "kv-loadgen", "--worker-fd", fd_arg.c_str(),
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(sv[1]);
+    w.fd   = sv[0];
+    w.pid  = pid;
+    w.name = "worker " + std::to_string(index) + " (pid " + std::to_string(pid) + ")";
+    return true;
+}
+
+std::vector<std::string> forwarded_args(const std::vector<std::string>& args) {
+    std::vector<std::string> out;
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        auto it = std::find_if(kLocalOnlyArgs.begin(), kLocalOnlyArgs.end(),
+                               [&](const auto& p) { return p.first == args[i]; });
+        if (it == kLocalOnlyArgs.end()) {
+            out.push_back(args[i]);
+        } else if (it->second) {
+            ++i;  // skip its value too
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+int run_worker(const LoadGenConfig& cfg) {
+    if (cfg.worker_fd >= 0) {
+        bool ok = serve_session(cfg.worker_fd);
+        close(cfg.worker_fd);
+        return ok ? 0 : 1;
+    }
+
+    int lfd = listen_unix(cfg.worker_listen);
+    if (lfd < 0) {
+        log_error("Worker: cannot listen on " + cfg.worker_listen + ": " + std::strerror(errno));
+        return 1;
+    }
+    log_info("Worker listening on " + cfg.worker_listen);
+    for (;;) {
+        int fd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            log_error(std::string("Worker: accept failed: ") + std::strerror(errno));
+            break;
+        }
+        if (!serve_session(fd)) log_warn("Worker: session ended without a result");
+        close(fd);
+    }
+    close(lfd);
+    return 1;
+}
+
+int run_coordinator(const LoadGenConfig& cfg) {
+    std::vector<Worker> workers;
+    bool setup_ok = true;
+
+    for (int i = 0; i < cfg.workers && setup_ok; ++i) {
+        Worker w;
+        if (!spawn_worker(w, static_cast<int>(workers.size()))) {
+            log_error(std::string("Failed to spawn worker: ") + std::strerror(errno));
+            setup_ok = false;
+            break;
+        }
+        workers.push_back(std::move(w));
+    }
+    if (setup_ok && !cfg.worker_sockets.empty()) {
+        std::stringstream ss(cfg.worker_sockets);
+        std::string path;
+        while (std::getline(ss, path, ',')) {
+            if (path.empty()) continue;
+            Worker w;
+            w.fd   = connect_unix(path);
+            w.name = "worker " + std::to_string(workers.size()) + " (" + path + ")";
+            if (w.fd < 0) {
+                log_error("Failed to connect to worker at " + path + ": " + std::strerror(errno));
+                setup_ok = false;
+                break;
+            }
+            workers.push_back(std::move(w));
+        }
+    }
+
+    const std::size_t n = workers.size();
+    if (setup_ok && static_cast<std::size_t>(cfg.clients) < n) {
+        log_error("--clients (" + std::to_string(cfg.clients) + ") must be >= number of workers (" +
+                  std::to_string(n) + ")");
+        setup_ok = false;
+    }
+
+    // Configure: split clients (remainder to the first workers) and rate evenly
+    std::vector<std::string> base = forwarded_args(cfg.args);
+    for (std::size_t i = 0; i < n && setup_ok; ++i) {
+        int clients = cfg.clients / static_cast<int>(n) +
+                      (static_cast<int>(i) < cfg.clients % static_cast<int>(n) ? 1 : 0);
+        double rate = cfg.rate_rps * static_cast<double>(clients) / static_cast<double>(cfg.clients);
+        std::vector<std::string> args = base;
+        args.insert(args.end(), {"--clients", std::to_string(clients),
+                                 "--rate",    std::to_string(rate),
+                                 "--seed",    std::to_string(cfg.seed + 1000003ULL * i),
+                                 "--insert-part", std::to_string(i) + "/" + std::to_string(n)});
+        if (!send_line(workers[i].fd, json{{"type", "config"}, {"args", args}}.dump())) {
+            log_error(workers[i].name + ": failed to send config");
+            setup_ok = false;
+        }
+    }
+    for (std::size_t i = 0; i < n && setup_ok; ++i) {
+        json msg;
+        if (!recv_json(workers[i].fd, workers[i].buf, msg, kReadyTimeoutMs) ||
+            msg.value("type", "") != "ready") {
+            log_error(workers[i].name + " not ready: " +
+                      (msg.is_object() ? msg.value("message", std::string("no response"))
+                                       : std::string("no response")));
+            setup_ok = false;
+        }
+    }
+
+    int rc = 1;
+    if (setup_ok) {
+        // Common start on the system clock (comparable across processes and,
+        // with synchronized clocks, hosts)
+        auto at = std::chrono::system_clock::now() + kStartLead;
+        int64_t at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            at.time_since_epoch()).count();
+        LgClock::time_point start = LgClock::now() + kStartLead;
+        for (auto& w : workers) send_line(w.fd, json{{"type", "start"}, {"at_ns", at_ns}}.dump());
+
+        log_info("Coordinator: " + std::to_string(n) + " workers, clients=" +
+                 std::to_string(cfg.clients) + " workload=" + cfg.workload +
+                 " engine=" + cfg.engine);
+
+        auto warmup_end  = start + std::chrono::seconds(cfg.warmup_s);
+        auto measure_end = warmup_end + std::chrono::seconds(cfg.measure_s);
+
+        // The coordinator runs on the server host: it does the system sampling
+        SysSampler sys(cfg.cores.empty() ? std::vector<int>{} : parse_id_list(cfg.cores),
+                       cfg.server_pids);
+        SysWindow sys_window(sys, cfg.sample_interval_s);
+        sys_window.start(warmup_end, measure_end);
+        MetricsWindow metrics_window(cfg.host, cfg.port);
+        metrics_window.start(warmup_end, measure_end);
+
+        RunResult merged;
+        bool all_ok = true;
+        for (auto& w : workers) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                measure_end + kResultGrace - LgClock::now());
+            json msg;
+            w.ok = recv_json(w.fd, w.buf, msg, static_cast<int>(std::max<int64_t>(left.count(), 0))) &&
+                   msg.value("type", "") == "result" && result_from_json(msg, w.result);
+            if (!w.ok) {
+                log_error(w.name + ": no result");
+                all_ok = false;
+                continue;
+            }
+            merged.merge(w.result);
+        }
+        sys_window.join();
+        merged.have_sys      = sys_window.ok();
+        merged.sys           = sys_window.rates();
+        merged.cpu_peak      = sys_window.cpu_peak();
+        merged.proc_cpu_peak = sys_window.proc_cpu_peak();
+        metrics_window.join();
+        merged.have_srv      = metrics_window.ok();
+        merged.srv           = metrics_window.delta();
+
+        double secs = static_cast<double>(cfg.measure_s);
+        for (const auto& w : workers) {
+            if (!w.ok) continue;
+            std::cout << "  " << w.name << ": ok=" << w.result.ok << " fail=" << w.result.fail
+                      << " thr=" << (secs > 0.0 ? static_cast<double>(w.result.ok) / secs : 0.0)
+                      << " req/s p99="
+                      << static_cast<double>(w.result.latency.value_at_percentile(99.0)) / 1000.0
+                      << "ms\n";
+        }
+        report_run(cfg, merged);
+        rc = all_ok ? 0 : 1;
+    }
+
+    for (auto& w : workers) {
+        if (w.fd >= 0) close(w.fd);
+        if (w.pid > 0) {
+            // One that never sent its result may be hung (or stopped, which
+            // only SIGKILL gets through); waitpid would block on it forever
+            if (!setup_ok)  kill(w.pid, SIGTERM);
+            else if (!w.ok) kill(w.pid, SIGKILL);
+            int status = 0;
+            waitpid(w.pid, &status, 0);
+        }
+    }
+    return rc;
+}
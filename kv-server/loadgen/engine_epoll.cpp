@@ -0,0 +1,644 @@
+#include "loadgen_engine.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// Event-driven engine: a few I/O threads, each multiplexing many non-blocking
+// keep-alive connections with epoll. Every connection is one "client" and may
+// keep up to --pipeline requests in flight (HTTP/1.1 pipelining, responses
+// arrive in order). Open-loop schedules are driven by a per-thread timer heap
+// and a timerfd, so sub-millisecond send times are honoured.
+
+namespace {
+
+constexpr uint64_t kTimerTag         = ~uint64_t{0};
+constexpr auto     kReconnectBackoff = std::chrono::milliseconds(100);
+constexpr auto     kMaxWait          = std::chrono::milliseconds(100);
+constexpr auto     kIdlePoll         = std::chrono::milliseconds(10);   // clients profile: recheck an idle client
+constexpr std::size_t kReadChunk     = 16 * 1024;
+
+struct InFlight {
+    Op                  op;
+    OpKind              kind;
+    uint64_t            index;      // key index
+    int                 remaining;  // requests of the operation still to send after this one
+    LgClock::time_point t0;         // start of the operation
+    std::size_t         tx;     // payload bytes sent
+    std::string         wire;   // kept so it can be resent after Connection: close
+    bool                timed = true;   // earlier responses of the operation had Server-Timing
+    ServerTiming        timing;         // ... summed
+};
+
+struct Conn {
+    int  id        = 0;         // global client id
+    int  fd        = -1;
+    bool connected = false;
+    bool want_out  = false;     // EPOLLOUT currently registered
+    bool timer_armed = false;
+
+    LgClock::time_point connect_t0;   // start of the current connect()
+    int  sent      = 0;         // requests written on this connection (--conn-mode budget)
+
+    std::string wbuf;
+    std::size_t woff = 0;
+    std::string rbuf;
+    std::deque<InFlight> inflight;
+
+    std::unique_ptr<RequestSource>   source;
+    std::unique_ptr<ArrivalSchedule> sched;
+};
+
+// ---------- HTTP/1.1 wire helpers ----------
+
+void append_request(std::string& out, const RequestSpec& req, const std::string& host_hdr, bool close) {
+    const std::string key = url_encode(req.key);
+    switch (req.op) {
+        case Op::GET:
+            out += "GET /get/"; out += key; out += " HTTP/1.1\r\n";
+            break;
+        case Op::PUT:
+            out += "PUT /put/"; out += key;
+            out += " HTTP/1.1\r\nContent-Type: text/plain\r\nContent-Length: ";
+            out += std::to_string(req.value.size());
+            out += "\r\n";
+            break;
+        case Op::DEL:
+            out += "DELETE /delete/"; out += key; out += " HTTP/1.1\r\n";
+            break;
+    }
+    out += host_hdr;
+    if (close) out += "Connection: close\r\n";
+    out += "\r\n";
+    if (req.op == Op::PUT) out.append(req.value.data(), req.value.size());
+}
+
+bool iequals_prefix(const char* p, const char* end, const char* name) {
+    std::size_t n = std::strlen(name);
+    if (static_cast<std::size_t>(end - p) < n) return false;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(p[i])) != name[i]) return false;
+    }
+    return true;
+}
+
+struct ParsedResponse {
+    int         status = 0;
+    bool        close  = false;
+    ReadSource  source = ReadSource::UNKNOWN;  // X-Cache: HIT / MISS
+    bool         timed = false;                // Server-Timing present
+    ServerTiming timing;
+    std::size_t body   = 0;     // body bytes
+    std::size_t length = 0;     // head + body bytes consumed
+};
+
+// Parse one response at the start of [p, p+n): 1 = complete, 0 = need more, -1 = malformed
+int parse_response(const char* p, std::size_t n, ParsedResponse& out) {
+    const void* hit = memmem(p, n, "\r\n\r\n", 4);
+    if (!hit) return n > 64 * 1024 ? -1 : 0;
+    std::size_t head_end = static_cast<std::size_t>(static_cast<const char*>(hit) - p);
+
+    const char* end = p + head_end;
+    if (end - p < 12 || std::strncmp(p, "HTTP/1.", 7) != 0) return -1;
+    out.status = std::atoi(p + 9);
+    out.close  = false;
+    out.source = ReadSource::UNKNOWN;
+    out.timed  = false;
+
+    std::size_t content_length = 0;
+    const char* line = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+    while (line && line < end) {
+        ++line;
+        const char* eol = static_cast<const char*>(std::memchr(line, '\r', static_cast<std::size_t>(end - line)));
+        if (!eol) eol = end;
+        if (iequals_prefix(line, eol, "content-length:")) {
+            content_length = static_cast<std::size_t>(std::strtoull(line + 15, nullptr, 10));
+        } else if (iequals_prefix(line, eol, "connection:")) {
+            const char* v = line + 11;
+            while (v < eol && *v == ' ') ++v;
+            out.close = iequals_prefix(v, eol, "close");
+        } else if (iequals_prefix(line, eol, "x-cache:")) {
+            const char* v = line + 8;
+            while (v < eol && *v == ' ') ++v;
+            if (iequals_prefix(v, eol, "hit")) out.source = ReadSource::CACHE;
+            else if (iequals_prefix(v, eol, "miss")) out.source = ReadSource::DB;
+        } else if (iequals_prefix(line, eol, "server-timing:")) {
+            out.timed = parse_server_timing(std::string_view(line + 14, static_cast<std::size_t>(eol - line - 14)),
+                                            out.timing);
+        } else if (iequals_prefix(line, eol, "transfer-encoding:")) {
+            return -1; // chunked bodies are never produced by kv-server
+        }
+        line = static_cast<const char*>(std::memchr(eol, '\n', static_cast<std::size_t>(end - eol) + 1));
+    }
+
+    std::size_t total = head_end + 4 + content_length;
+    if (n < total) return 0;
+    out.body   = content_length;
+    out.length = total;
+    return 1;
+}
+
+bool op_succeeded(Op op, int status) {
+    return op == Op::DEL ? (status == 200 || status == 404) : status == 200;
+}
+
+// ---------- I/O thread ----------
+
+class IoThread {
+public:
+    IoThread(RunContext& ctx, int tid, const sockaddr_storage& addr, socklen_t addr_len)
+        : ctx_(ctx),
+          cfg_(ctx.cfg),
+          tid_(tid),
+          addr_(addr),
+          addr_len_(addr_len),
+          rng_(ctx.cfg.seed + 7919u * static_cast<std::uint64_t>(tid)),
+          rec_(ctx.stats.recorder_for(static_cast<std::size_t>(tid))),
+          depth_(static_cast<std::size_t>(std::max(1, ctx.cfg.pipeline))),
+          host_hdr_("Host: " + ctx.cfg.host + ":" + std::to_string(ctx.cfg.port) + "\r\n")
+    {
+    }
+
+    void add_client(int id) {
+        conns_.emplace_back();
+        Conn& c = conns_.back();
+        c.id = id;
+        c.source = std::make_unique<RequestSource>(ctx_, rng_, id);
+        if (ctx_.open_loop) c.sched = std::make_unique<ArrivalSchedule>(ctx_, rng_, id);
+    }
+
+    void run();
+
+private:
+    using TimerEntry = std::pair<LgClock::time_point, std::size_t>;
+
+    void start_connect(std::size_t idx);
+    void on_event(std::size_t idx, uint32_t events);
+    void on_connected(std::size_t idx);
+    void on_readable(std::size_t idx);
+    void pump(std::size_t idx, LgClock::time_point now);
+    bool issue(Conn& c, LgClock::time_point t0);
+    void send_next(Conn& c, LgClock::time_point t0);
+    bool flush(std::size_t idx);
+    void drop(std::size_t idx, bool graceful);
+    bool can_send(const Conn& c) const;
+    void set_interest(std::size_t idx, bool want_out);
+    void arm(std::size_t idx, LgClock::time_point when);
+    void rearm_timerfd();
+
+    RunContext&          ctx_;
+    const LoadGenConfig& cfg_;
+    int                  tid_;
+    sockaddr_storage     addr_;
+    socklen_t            addr_len_;
+    std::mt19937_64      rng_;
+    Recorder&            rec_;
+    std::size_t          depth_;
+    std::string          host_hdr_;
+
+    int epfd_ = -1;
+    int tfd_  = -1;
+    LgClock::time_point tfd_armed_for_ = LgClock::time_point::max();
+
+    std::deque<Conn> conns_;
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timers_;
+    RequestSpec req_;
+};
+
+void IoThread::set_interest(std::size_t idx, bool want_out) {
+    Conn& c = conns_[idx];
+    epoll_event ev{};
+    ev.events   = EPOLLIN | EPOLLRDHUP | (want_out ? EPOLLOUT : 0u);
+    ev.data.u64 = idx;
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+    c.want_out = want_out;
+}
+
+void IoThread::arm(std::size_t idx, LgClock::time_point when) {
+    Conn& c = conns_[idx];
+    if (c.timer_armed) return;
+    c.timer_armed = true;
+    timers_.emplace(when, idx);
+}
+
+void IoThread::rearm_timerfd() {
+    LgClock::time_point next = timers_.empty() ? LgClock::time_point::max() : timers_.top().first;
+    if (next == tfd_armed_for_) return;
+    tfd_armed_for_ = next;
+
+    itimerspec its{};
+    if (next != LgClock::time_point::max()) {
+        // steady_clock is CLOCK_MONOTONIC on Linux, so absolute times line up
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch()).count();
+        if (ns <= 0) ns = 1;
+        its.it_value.tv_sec  = static_cast<time_t>(ns / 1000000000);
+        its.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+    }
+    timerfd_settime(tfd_, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+void IoThread::start_connect(std::size_t idx) {
+    Conn& c = conns_[idx];
+    c.connected  = false;
+    c.rbuf.clear();
+    c.connect_t0 = LgClock::now();
+    c.sent       = 0;
+
+    c.fd = socket(addr_.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        log_warn(std::string("socket() failed: ") + std::strerror(errno));
+        arm(idx, LgClock::now() + kReconnectBackoff);
+        return;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int rc = connect(c.fd, reinterpret_cast<const sockaddr*>(&addr_), addr_len_);
+    if (rc != 0 && errno != EINPROGRESS) {
+        ctx_.stats.record_connect(rec_, false, 0, ctx_.in_window(c.connect_t0));
+        close(c.fd);
+        c.fd = -1;
+        arm(idx, LgClock::now() + kReconnectBackoff);
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    ev.data.u64 = idx;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    c.want_out = true;
+}
+
+void IoThread::on_connected(std::size_t idx) {
+    Conn& c = conns_[idx];
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    auto now = LgClock::now();
+    ctx_.stats.record_connect(rec_, err == 0,
+                              std::chrono::duration_cast<std::chrono::microseconds>(now - c.connect_t0).count(),
+                              ctx_.in_window(now));
+    if (err != 0) {
+        drop(idx, false);
+        return;
+    }
+    c.connected = true;
+
+    // Requests left over from a connection the server closed are resent first
+    c.wbuf.clear();
+    c.woff = 0;
+    for (const auto& f : c.inflight) c.wbuf += f.wire;
+    c.sent = static_cast<int>(c.inflight.size());
+
+    pump(idx, now);
+}
+
+bool IoThread::issue(Conn& c, LgClock::time_point t0) {
+    if (!c.source->next(req_)) return false;
+    send_next(c, t0);
+    return true;
+}
+
+// Room for another request: pipeline depth, and the --conn-mode budget of
+// the connection
+bool IoThread::can_send(const Conn& c) const {
+    return c.inflight.size() < depth_ && (cfg_.conn_reuse == 0 || c.sent < cfg_.conn_reuse);
+}
+
+// Queue req_ behind whatever is already pipelined on the connection; the
+// last request of a --conn-mode budget asks the server to close
+void IoThread::send_next(Conn& c, LgClock::time_point t0) {
+    InFlight f{req_.op, req_.kind, req_.index, req_.remaining, t0,
+               req_.op == Op::PUT ? req_.value.size() : 0, std::string(), true, ServerTiming{}};
+    ++c.sent;
+    append_request(f.wire, req_, host_hdr_, cfg_.conn_reuse > 0 && c.sent >= cfg_.conn_reuse);
+    c.wbuf += f.wire;
+    c.inflight.push_back(std::move(f));
+}
+
+// Issue as many requests as the pipeline depth and (open-loop) schedule allow.
+void IoThread::pump(std::size_t idx, LgClock::time_point now) {
+    Conn& c = conns_[idx];
+    if (!c.connected) return;
+
+    if (c.sched) {
+        while (can_send(c)) {
+            auto intended = c.sched->intended();
+            if (intended > now || intended >= ctx_.measure_end()) break;
+            if (intended > ctx_.warmup_end()) {
+                ctx_.stats.note_lag(std::chrono::duration_cast<std::chrono::microseconds>(now - intended).count());
+            }
+            if (!issue(c, intended)) break;
+            c.sched->advance();
+        }
+        // Wake up for the next send unless we're blocked on a full pipeline
+        // or a spent connection (a response / reconnect will call pump again).
+        if (can_send(c) && c.sched->intended() < ctx_.measure_end()) {
+            arm(idx, c.sched->intended());
+        }
+    } else if (!ctx_.client_active(c.id, now)) {
+        // Above a clients profile's current target: let the pipeline drain
+        arm(idx, now + kIdlePoll);
+    } else {
+        while (can_send(c) && issue(c, now)) {}
+    }
+
+    flush(idx);
+}
+
+bool IoThread::flush(std::size_t idx) {
+    Conn& c = conns_[idx];
+    while (c.woff < c.wbuf.size()) {
+        ssize_t n = send(c.fd, c.wbuf.data() + c.woff, c.wbuf.size() - c.woff, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.woff += static_cast<std::size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c.want_out) set_interest(idx, true);
+            return true;
+        } else {
+            drop(idx, false);
+            return false;
+        }
+    }
+    c.wbuf.clear();
+    c.woff = 0;
+    if (c.want_out) set_interest(idx, false);
+    return true;
+}
+
+void IoThread::on_readable(std::size_t idx) {
+    Conn& c = conns_[idx];
+    char buf[kReadChunk];
+    bool eof = false;
+
+    for (;;) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            c.rbuf.append(buf, static_cast<std::size_t>(n));
+            if (static_cast<std::size_t>(n) < sizeof(buf)) break;
+        } else if (n == 0) {
+            eof = true;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            eof = true;
+            break;
+        }
+    }
+
+    auto now = LgClock::now();
+    bool in_window = ctx_.in_window(now);
+    std::size_t consumed = 0;
+    ParsedResponse pr;
+
+    for (;;) {
+        int st = parse_response(c.rbuf.data() + consumed, c.rbuf.size() - consumed, pr);
+        if (st == 0) break;
+        if (st < 0 || c.inflight.empty()) {
+            drop(idx, false);
+            return;
+        }
+
+        InFlight f = std::move(c.inflight.front());
+        c.inflight.pop_front();
+        consumed += pr.length;
+
+        Outcome out;
+        out.kind    = f.kind;
+        out.status  = pr.status;
+        out.success = op_succeeded(f.op, pr.status);
+        out.timed   = f.timed && pr.timed;
+        out.timing  = f.timing;
+        if (pr.timed) out.timing.add(pr.timing);
+        ctx_.stats.count_bytes(f.tx, f.op == Op::GET ? pr.body : 0, in_window);
+        if (out.success && f.remaining > 0) {
+            // Next request of a scan / RMW; it keeps the operation's start time
+            req_.op        = f.op;
+            req_.kind      = f.kind;
+            req_.index     = f.index;
+            req_.remaining = f.remaining;
+            c.source->follow(req_);
+            send_next(c, f.t0);
+            c.inflight.back().timed  = out.timed;
+            c.inflight.back().timing = out.timing;
+        } else {
+            // Cache / DB split for plain reads only, not scans or RMW
+            if (f.kind == OpKind::READ) out.source = pr.source;
+            out.phase = ctx_.phase_at(now);
+            int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(now - f.t0).count();
+            ctx_.stats.record(rec_, out, us, in_window);
+            ctx_.complete(f.kind, f.index, out.success);
+        }
+
+        if (pr.close) {
+            // Server ends keep-alive: unanswered pipelined requests are resent
+            drop(idx, true);
+            return;
+        }
+    }
+    if (consumed) c.rbuf.erase(0, consumed);
+
+    if (eof) {
+        drop(idx, c.inflight.empty());
+        return;
+    }
+    // Budget spent and answered, but the server kept the connection open
+    if (cfg_.conn_reuse > 0 && c.sent >= cfg_.conn_reuse && c.inflight.empty()) {
+        drop(idx, true);
+        return;
+    }
+    pump(idx, now);
+}
+
+// Close the connection and reconnect. graceful: the server closed the
+// connection cleanly, so unanswered requests are resent; otherwise they fail.
+void IoThread::drop(std::size_t idx, bool graceful) {
+    Conn& c = conns_[idx];
+    if (c.fd >= 0) {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+    }
+    c.connected = false;
+    c.wbuf.clear();
+    c.woff = 0;
+    c.rbuf.clear();
+
+    auto now = LgClock::now();
+    if (!graceful) {
+        bool in_window = ctx_.in_window(now);
+        for (const auto& f : c.inflight) {
+            Outcome out;
+            out.kind  = f.kind;
+            out.phase = ctx_.phase_at(now);
+            int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(now - f.t0).count();
+            ctx_.stats.record(rec_, out, us, in_window);
+            ctx_.complete(f.kind, f.index, false);
+        }
+        c.inflight.clear();
+        arm(idx, now + kReconnectBackoff);
+        return;
+    }
+    start_connect(idx);
+}
+
+void IoThread::on_event(std::size_t idx, uint32_t events) {
+    Conn& c = conns_[idx];
+    if (c.fd < 0) return;
+
+    if (!c.connected) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) on_connected(idx);
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        on_readable(idx);
+        if (c.fd < 0 || !c.connected) return;
+    }
+    if ((events & EPOLLOUT) && !c.wbuf.empty()) flush(idx);
+}
+
+void IoThread::run() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    tfd_  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epfd_ < 0 || tfd_ < 0) {
+        log_error(std::string("epoll/timerfd setup failed: ") + std::strerror(errno));
+        return;
+    }
+    epoll_event tev{};
+    tev.events   = EPOLLIN;
+    tev.data.u64 = kTimerTag;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, tfd_, &tev);
+
+    for (std::size_t i = 0; i < conns_.size(); ++i) start_connect(i);
+
+    std::vector<epoll_event> events(1024);
+    for (;;) {
+        auto now = LgClock::now();
+        if (ctx_.finished(now)) break;
+
+        // Due timers: reconnect after backoff, or open-loop send time reached
+        while (!timers_.empty() && timers_.top().first <= now) {
+            std::size_t idx = timers_.top().second;
+            timers_.pop();
+            Conn& c = conns_[idx];
+            c.timer_armed = false;
+            if (c.fd < 0) start_connect(idx);
+            else          pump(idx, now);
+        }
+        rearm_timerfd();
+
+        auto wait = std::min<LgClock::duration>(ctx_.measure_end() - now, kMaxWait);
+        int timeout_ms = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()) + 1;
+
+        int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[static_cast<std::size_t>(i)].data.u64 == kTimerTag) {
+                uint64_t expirations = 0;
+                ssize_t r = read(tfd_, &expirations, sizeof(expirations));
+                (void)r;
+                tfd_armed_for_ = LgClock::time_point::max();
+                continue;
+            }
+            on_event(static_cast<std::size_t>(events[static_cast<std::size_t>(i)].data.u64),
+                     events[static_cast<std::size_t>(i)].events);
+        }
+    }
+
+    for (auto& c : conns_) {
+        if (c.sched) ctx_.stats.missed.fetch_add(c.sched->drain_missed(), std::memory_order_relaxed);
+        if (c.fd >= 0) close(c.fd);
+        c.fd = -1;
+    }
+    close(tfd_);
+    close(epfd_);
+}
+
+bool resolve(const std::string& host, int port, sockaddr_storage& out, socklen_t& len) {
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) {
+        return false;
+    }
+    std::memcpy(&out, res->ai_addr, res->ai_addrlen);
+    len = static_cast<socklen_t>(res->ai_addrlen);
+    freeaddrinfo(res);
+    return true;
+}
+
+// Thousands of sockets need more than the usual 1024 descriptors
+void raise_fd_limit(std::size_t needed) {
+    rlimit rl{};
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+    if (rl.rlim_cur >= needed) return;
+    rl.rlim_cur = std::min<rlim_t>(rl.rlim_max, static_cast<rlim_t>(needed));
+    setrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < needed) {
+        log_warn("RLIMIT_NOFILE is " + std::to_string(rl.rlim_cur) + ", need ~" +
+                 std::to_string(needed) + " for " + std::to_string(needed - 64) +
+                 " connections (raise with ulimit -n)");
+    }
+}
+
+} // namespace
+
+void run_epoll_engine(RunContext& ctx) {
+    const LoadGenConfig& cfg = ctx.cfg;
+
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    if (!resolve(cfg.host, cfg.port, addr, addr_len)) {
+        log_error("Failed to resolve " + cfg.host);
+        return;
+    }
+    raise_fd_limit(static_cast<std::size_t>(cfg.clients) + 64);
+
+    int n_threads = cfg.io_threads > 0
+        ? cfg.io_threads
+        : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    n_threads = std::max(1, std::min(n_threads, cfg.clients));
+
+    log_info("epoll engine: " + std::to_string(cfg.clients) + " connections on " +
+             std::to_string(n_threads) + " I/O threads, pipeline depth " +
+             std::to_string(std::max(1, cfg.pipeline)));
+
+    std::vector<std::unique_ptr<IoThread>> io;
+    for (int t = 0; t < n_threads; ++t) {
+        io.emplace_back(std::make_unique<IoThread>(ctx, t, addr, addr_len));
+    }
+    for (int i = 0; i < cfg.clients; ++i) {
+        io[static_cast<std::size_t>(i % n_threads)]->add_client(i);
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& t : io) threads.emplace_back([&t]() { t->run(); });
+    for (auto& t : threads) t.join();
+}
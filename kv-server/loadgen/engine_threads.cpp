@@ -0,0 +1,75 @@
+#include "loadgen_engine.h"
+#include "utils.h"
+
+#include <httplib.h>
+
+#include <thread>
+#include <vector>
+
+// Thread-per-client engine: every client is a std::thread with its own
+// blocking, keep-alive httplib::Client.
+
+namespace {
+
+ReadSource parse_x_cache(const std::string& v) {
+    if (v == "HIT") return ReadSource::CACHE;
+    if (v == "MISS") return ReadSource::DB;
+    return ReadSource::UNKNOWN;
+}
+
+// Status and Server-Timing of one response (or its absence) into out;
+// a response without Server-Timing leaves the whole operation untimed
+void note_response(const httplib::Result& res, Outcome& out) {
+    out.status = res ? res->status : 0;
+    ServerTiming t;
+    if (res && parse_server_timing(res->get_header_value("Server-Timing"), t)) {
+        out.timing.add(t);
+    } else {
+        out.timed = false;
+    }
+}
+
+// Send one request; payload bytes are added to tx / rx. Fills in the
+// status (0 on a transport error), Server-Timing and, for GETs, the
+// X-Cache source.
+bool send_request(httplib::Client& cli, const RequestSpec& req, uint64_t& tx, uint64_t& rx, Outcome& out) {
+    out.source = ReadSource::UNKNOWN;
+    if (req.op == Op::GET) {
+        auto res = cli.Get(("/get/" + url_encode(req.key)).c_str());
+        note_response(res, out);
+        if (!res) return false;
+        rx += res->body.size();
+        out.source = parse_x_cache(res->get_header_value("X-Cache"));
+        return res->status == 200;
+    }
+    if (req.op == Op::PUT) {
+        // Value goes in the body (kv-server falls back to it without ?value=)
+        auto res = cli.Put(("/put/" + url_encode(req.key)).c_str(),
+                           req.value.data(), req.value.size(), "text/plain");
+        tx += req.value.size();
+        note_response(res, out);
+        return res && res->status == 200;
+    }
+    auto res = cli.Delete(("/delete/" + url_encode(req.key)).c_str());
+    note_response(res, out);
+    return res && (res->status == 200 || res->status == 404);
+}
+
+void client_loop(RunContext& ctx, int id) {
+    httplib::Client cli(ctx.cfg.host, ctx.cfg.port);
+    cli.set_keep_alive(true);
+    run_blocking_client(ctx, id, [&cli](const RequestSpec& req, uint64_t& tx, uint64_t& rx, Outcome& out) {
+        return send_request(cli, req, tx, rx, out);
+    });
+}
+
+} // namespace
+
+void run_threads_engine(RunContext& ctx) {
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<std::size_t>(ctx.cfg.clients));
+    for (int i = 0; i < ctx.cfg.clients; ++i) {
+        threads.emplace_back(client_loop, std::ref(ctx), i);
+    }
+    for (auto& t : threads) t.join();
+}
@@ -0,0 +1,306 @@
+#include "load_generator.h"
+#include "loadgen_engine.h"
+#include "server_metrics.h"
+#include "steady_state.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// --find-knee: instead of one fixed run, walk the load axis (client count, or
+// open-loop offered rate) in short steps, each ending as soon as throughput
+// and p99 have settled. The load doubles until the p99 SLO is violated or
+// throughput stops growing, then the SLO boundary is bisected. The knee is
+// the lowest load that delivers (nearly) the best throughput within the SLO.
+
+namespace {
+
+// Throughput gain needed for a doubling to count as progress
+constexpr double kPlateauGain = 1.05;
+// The knee is the lowest passing load within this fraction of the best throughput
+constexpr double kKneeFraction = 0.95;
+// Failed requests allowed within the SLO
+constexpr double kMaxFailRatio = 0.01;
+// Open-loop steps must deliver at least this much of the offered rate
+constexpr double kMinDelivered = 0.9;
+
+double us_to_ms(double us) { return us / 1000.0; }
+
+struct KneePoint {
+    int      step      = 0;
+    double   load      = 0.0;   // clients or offered req/s
+    int      clients   = 0;
+    double   rate_rps  = 0.0;
+    double   thr_rps   = 0.0;
+    double   p50_ms    = 0.0;
+    double   p99_ms    = 0.0;
+    double   p999_ms   = 0.0;
+    uint64_t ok        = 0;
+    uint64_t fail      = 0;
+    double   duration_s = 0.0;
+    bool     steady    = false;
+    bool     slo_ok    = false;
+    bool     have_srv  = false;     // /metrics scraped over the whole window
+    ServerMetricsDelta srv;
+};
+
+struct Interval {
+    HdrHistogram hist;
+    uint64_t     ok   = 0;
+    uint64_t     fail = 0;
+    double       secs = 0.0;
+    bool         have_srv = false;
+    ServerMetricsDelta srv;
+};
+
+KneePoint run_step(const LoadGenConfig& base, const WorkloadGenerators& gens,
+                   bool clients_axis, double load, int step_no) {
+    LoadGenConfig cfg = base;
+    if (clients_axis) cfg.clients  = static_cast<int>(load);
+    else              cfg.rate_rps = load;
+
+    RunContext ctx(cfg);
+    ctx.mix       = gens.mix;
+    ctx.keydist   = gens.keydist.get();
+    ctx.follow_inserts = gens.follow_inserts;
+    ctx.values    = gens.values.get();
+    ctx.open_loop = cfg.rate_rps > 0.0 && cfg.clients > 0;
+    ctx.stats.track_intervals = true;
+    ctx.stats.init_recorders(cfg.clients);
+
+    ctx.start = LgClock::now();
+    const auto step_end = ctx.start + std::chrono::duration_cast<LgClock::duration>(
+                                          std::chrono::duration<double>(cfg.knee_step_s));
+    ctx.set_window(ctx.start, step_end);
+
+    SteadyStateConfig sc;
+    SteadyStateDetector detector(sc);
+    std::deque<Interval> window;   // the last sc.window intervals
+
+    std::thread controller([&]() {
+        const auto step = std::chrono::duration_cast<LgClock::duration>(
+            std::chrono::duration<double>(cfg.interval_s));
+        auto prev = ctx.start;
+
+        // Server counters per interval, so a throughput cliff can be put
+        // next to the cache hit ratio it came with
+        MetricsScraper scraper(cfg.host, cfg.port);
+        ServerMetrics m_prev, m_now;
+        bool have_m = scraper.scrape(m_prev);
+        while (prev < step_end) {
+            auto tick = std::min(prev + step, step_end);
+            std::this_thread::sleep_until(tick);
+
+            Interval iv;
+            ctx.stats.drain_interval(iv.hist, iv.ok, iv.fail);
+            iv.secs = std::chrono::duration<double>(tick - prev).count();
+            prev = tick;
+            if (have_m && scraper.scrape(m_now)) {
+                iv.srv      = metrics_delta(m_prev, m_now);
+                iv.have_srv = true;
+                m_prev      = m_now;
+            } else {
+                have_m = scraper.scrape(m_prev);
+            }
+
+            double thr = iv.secs > 0.0 ? static_cast<double>(iv.ok) / iv.secs : 0.0;
+            double p99 = static_cast<double>(iv.hist.value_at_percentile(99.0));
+            window.push_back(std::move(iv));
+            if (window.size() > sc.window) window.pop_front();
+
+            if (detector.add(thr, p99)) {
+                ctx.stop.store(true, std::memory_order_relaxed);
+                break;
+            }
+        }
+    });
+
+    run_engine(ctx);
+    controller.join();
+
+    // Report over the steady window (or the last window, if it never settled)
+    KneePoint p;
+    p.step       = step_no;
+    p.load       = load;
+    p.clients    = cfg.clients;
+    p.rate_rps   = cfg.rate_rps;
+    p.steady     = detector.steady();
+    p.duration_s = std::chrono::duration<double>(LgClock::now() - ctx.start).count();
+
+    HdrHistogram lat;
+    double secs = 0.0;
+    p.have_srv = !window.empty();
+    for (const auto& iv : window) {
+        lat.merge(iv.hist);
+        p.ok   += iv.ok;
+        p.fail += iv.fail;
+        secs   += iv.secs;
+        p.have_srv = p.have_srv && iv.have_srv;
+        p.srv.requests     += iv.srv.requests;
+        p.srv.errors       += iv.srv.errors;
+        p.srv.cache_hits   += iv.srv.cache_hits;
+        p.srv.cache_misses += iv.srv.cache_misses;
+    }
+    p.thr_rps = secs > 0.0 ? static_cast<double>(p.ok) / secs : 0.0;
+    p.p50_ms  = us_to_ms(static_cast<double>(lat.value_at_percentile(50.0)));
+    p.p99_ms  = us_to_ms(static_cast<double>(lat.value_at_percentile(99.0)));
+    p.p999_ms = us_to_ms(static_cast<double>(lat.value_at_percentile(99.9)));
+
+    uint64_t total = p.ok + p.fail;
+    bool fail_ok   = total > 0 && static_cast<double>(p.fail) <= kMaxFailRatio * static_cast<double>(total);
+    bool delivered = clients_axis || p.thr_rps >= kMinDelivered * load;
+    p.slo_ok = p.ok > 0 && fail_ok && delivered && p.p99_ms <= cfg.slo_p99_ms;
+    return p;
+}
+
+// Next load strictly between lo and hi (geometric midpoint; clients are integers)
+double midpoint(double lo, double hi, bool clients_axis) {
+    double mid = std::sqrt(lo * hi);
+    if (clients_axis) {
+        mid = std::round(mid);
+        if (mid <= lo) mid = lo + 1;
+        if (mid >= hi) return -1.0;
+    }
+    return mid;
+}
+
+} // namespace
+
+int run_knee_search(const LoadGenConfig& cfg) {
+    const bool clients_axis = cfg.knee_axis == "clients";
+    const double lowest = clients_axis ? 1.0 : 10.0;
+    const double max_load = cfg.knee_max > 0.0 ? cfg.knee_max : (clients_axis ? 32768.0 : 1e6);
+    double load = clients_axis ? static_cast<double>(cfg.clients)
+                               : (cfg.rate_rps > 0.0 ? cfg.rate_rps : 1000.0);
+    load = std::min(std::max(load, lowest), max_load);
+
+    log_info("Knee search on " + cfg.knee_axis + " axis: start=" + std::to_string(load) +
+             " max=" + std::to_string(max_load) +
+             " slo_p99=" + std::to_string(cfg.slo_p99_ms) + "ms" +
+             " engine=" + cfg.engine);
+
+    WorkloadGenerators gens = make_workload_generators(cfg);
+
+    std::vector<KneePoint> points;
+    auto step = [&](double l) -> const KneePoint& {
+        points.push_back(run_step(cfg, gens, clients_axis, l, static_cast<int>(points.size()) + 1));
+        const KneePoint& p = points.back();
+        log_info("Knee step " + std::to_string(p.step) + ": " + cfg.knee_axis + "=" +
+                 std::to_string(p.load) + " thr=" + std::to_string(p.thr_rps) +
+                 " p99=" + std::to_string(p.p99_ms) + "ms" +
+                 (p.have_srv ? " hit_ratio=" + std::to_string(p.srv.hit_ratio()) : "") +
+                 (p.steady ? "" : " (not steady)") +
+                 (p.slo_ok ? "" : " SLO violated"));
+        return p;
+    };
+    auto steps_left = [&]() { return static_cast<int>(points.size()) < cfg.knee_max_steps; };
+
+    double lo = -1.0, hi = -1.0;   // highest passing / lowest failing load
+    double best_thr = 0.0;
+
+    // Ramp: double while within the SLO and throughput still grows
+    while (steps_left()) {
+        const KneePoint& p = step(load);
+        if (!p.slo_ok) { hi = load; break; }
+        bool gained = lo < 0.0 || p.thr_rps >= best_thr * kPlateauGain;
+        lo = load;
+        best_thr = std::max(best_thr, p.thr_rps);
+        if (!gained || load >= max_load) break;
+        load = std::min(max_load, clients_axis ? std::round(load * 2.0) : load * 2.0);
+    }
+
+    // Already over the SLO at the start: halve until a load passes
+    while (lo < 0.0 && hi > lowest && steps_left()) {
+        load = std::max(lowest, clients_axis ? std::floor(hi / 2.0) : hi / 2.0);
+        const KneePoint& p = step(load);
+        if (p.slo_ok) lo = load;
+        else          hi = load;
+    }
+
+    // Refine the SLO boundary
+    while (lo > 0.0 && hi > 0.0 && hi / lo > 1.0 + cfg.knee_tolerance && steps_left()) {
+        double mid = midpoint(lo, hi, clients_axis);
+        if (mid < 0.0) break;
+        const KneePoint& p = step(mid);
+        if (p.slo_ok) lo = mid;
+        else          hi = mid;
+    }
+
+    // Knee: lowest passing load within kKneeFraction of the best passing throughput
+    std::sort(points.begin(), points.end(),
+              [](const KneePoint& a, const KneePoint& b) { return a.load < b.load; });
+    double best = 0.0;
+    for (const auto& p : points) if (p.slo_ok) best = std::max(best, p.thr_rps);
+    const KneePoint* knee = nullptr;
+    for (const auto& p : points) {
+        if (p.slo_ok && p.thr_rps >= kKneeFraction * best) { knee = &p; break; }
+    }
+
+    std::cout << "Knee search (" << cfg.workload << ", " << cfg.knee_axis
+              << ", p99 SLO " << cfg.slo_p99_ms << " ms):\n"
+              << "  " << std::setw(10) << cfg.knee_axis << std::setw(12) << "thr_rps"
+              << std::setw(10) << "p50_ms" << std::setw(10) << "p99_ms"
+              << std::setw(10) << "p999_ms" << std::setw(8) << "fail"
+              << std::setw(10) << "hit_ratio" << "\n";
+    for (const auto& p : points) {
+        std::cout << (&p == knee ? "* " : "  ")
+                  << std::setw(10) << p.load << std::setw(12) << p.thr_rps
+                  << std::setw(10) << p.p50_ms << std::setw(10) << p.p99_ms
+                  << std::setw(10) << p.p999_ms << std::setw(8) << p.fail;
+        if (p.have_srv) std::cout << std::setw(10) << p.srv.hit_ratio();
+        else            std::cout << std::setw(10) << "n/a";
+        std::cout << (p.slo_ok ? "" : "  SLO violated")
+                  << (p.steady ? "" : "  (not steady)") << "\n";
+    }
+    if (knee) {
+        std::cout << "Knee: " << cfg.knee_axis << "=" << knee->load
+                  << " thr=" << knee->thr_rps << " req/s p99=" << knee->p99_ms << " ms\n";
+    } else {
+        std::cout << "Knee: none (no step met the SLO)\n";
+    }
+
+    if (!cfg.knee_out.empty()) {
+        std::ofstream out(cfg.knee_out);
+        if (!out) {
+            std::cerr << "Failed to open knee output: " << cfg.knee_out << "\n";
+        } else {
+            out << "step,workload,axis,clients,rate_rps,thr_rps,p50_ms,p99_ms,p999_ms,"
+                   "ok,fail,duration_s,steady,slo_ok,knee,"
+                   "srv_requests,srv_errors,srv_cache_hits,srv_cache_misses,srv_hit_ratio\n";
+            for (const auto& p : points) {
+                out << p.step << ","
+                    << cfg.workload << ","
+                    << cfg.knee_axis << ","
+                    << p.clients << ","
+                    << p.rate_rps << ","
+                    << p.thr_rps << ","
+                    << p.p50_ms << ","
+                    << p.p99_ms << ","
+                    << p.p999_ms << ","
+                    << p.ok << ","
+                    << p.fail << ","
+                    << p.duration_s << ","
+                    << (p.steady ? 1 : 0) << ","
+                    << (p.slo_ok ? 1 : 0) << ","
+                    << (&p == knee ? 1 : 0) << ",";
+                if (p.have_srv) {
+                    out << p.srv.requests << ","
+                        << p.srv.errors << ","
+                        << p.srv.cache_hits << ","
+                        << p.srv.cache_misses << ","
+                        << p.srv.hit_ratio() << "\n";
+                } else {
+                    out << ",,,,\n";
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -1,12 +1,17 @@
 #include "load_generator.h"
+#include "loadgen_engine.h"
+#include "load_profile.h"
+#include "server_metrics.h"
+#include "steady_state.h"
+#include "sys_stats.h"
 #include "utils.h"
 
-#include <httplib.h>
-
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <random>
@@ -14,134 +19,223 @@
 #include <thread>
 #include <vector>
 #include <algorithm>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 
 namespace {
 
-double pctl(std::vector<double>& v, double p) {
-    if (v.empty()) return 0.0;
-    std::sort(v.begin(), v.end());
-    double idx = (p / 100.0) * static_cast<double>(v.size() - 1);
-    std::size_t lo = static_cast<std::size_t>(idx);
-    std::size_t hi = std::min(lo + 1, v.size() - 1);
-    double w = idx - static_cast<double>(lo);
-    return v[lo] * (1.0 - w) + v[hi] * w;
-}
-
-enum class Op { GET, PUT, DEL };
-
-// ---------- CPU & Disk sampling helpers (Linux /proc-based) ----------
-
-struct CpuSample {
-    unsigned long long user   = 0;
-    unsigned long long nice   = 0;
-    unsigned long long system = 0;
-    unsigned long long idle   = 0;
-    unsigned long long iowait = 0;
-    unsigned long long irq    = 0;
-    unsigned long long softirq= 0;
-    unsigned long long steal  = 0;
-};
+double us_to_ms(double us) { return us / 1000.0; }
 
-// Read stats for *core 0 only* (line "cpu0" in /proc/stat)
-bool read_cpu_sample(CpuSample& s) {
-    std::ifstream f("/proc/stat");
-    if (!f) return false;
+// ---------- System sampling summaries ----------
 
-    std::string line;
-    while (std::getline(f, line)) {
-        std::istringstream iss(line);
-        std::string label;
-        iss >> label;
+// "sda:0.1:20.5;nvme0n1:0:0" (MB/s read:write per whole device)
+std::string format_disks(const SysRates& r) {
+    std::ostringstream os;
+    for (std::size_t i = 0; i < r.disks.size(); ++i) {
+        if (i) os << ";";
+        os << r.disks[i].name << ":" << r.disks[i].read_MBps << ":" << r.disks[i].write_MBps;
+    }
+    return os.str();
+}
 
-        if (label == "cpu0") {
-            iss >> s.user >> s.nice >> s.system >> s.idle >> s.iowait
-                >> s.irq >> s.softirq >> s.steal;
-            return true;
-        }
+// "kind:ok:fail:p50_ms:p99_ms:p999_ms;..." for the operations that ran
+std::string format_ops(const RunResult& res) {
+    std::ostringstream os;
+    bool first = true;
+    for (std::size_t k = 0; k < kOpKinds; ++k) {
+        const auto& o = res.ops[k];
+        if (o.ok + o.fail == 0) continue;
+        if (!first) os << ";";
+        first = false;
+        os << op_kind_name(static_cast<OpKind>(k)) << ":" << o.ok << ":" << o.fail << ":"
+           << us_to_ms(static_cast<double>(o.latency.value_at_percentile(50.0))) << ":"
+           << us_to_ms(static_cast<double>(o.latency.value_at_percentile(99.0))) << ":"
+           << us_to_ms(static_cast<double>(o.latency.value_at_percentile(99.9)));
     }
-    return false;
+    return os.str();
 }
 
-double cpu_utilization(const CpuSample& a, const CpuSample& b) {
-    auto idle_a  = a.idle + a.iowait;
-    auto idle_b  = b.idle + b.iowait;
-    auto total_a = a.user + a.nice + a.system + a.idle + a.iowait +
-                   a.irq + a.softirq + a.steal;
-    auto total_b = b.user + b.nice + b.system + b.idle + b.iowait +
-                   b.irq + b.softirq + b.steal;
-
-    double totald = static_cast<double>(total_b - total_a);
-    double idled  = static_cast<double>(idle_b - idle_a);
-    if (totald <= 0.0) return 0.0;
-    return 100.0 * (1.0 - idled / totald);
+// "name:count:p50_ms:p99_ms:p999_ms;..." over the non-empty histograms
+template <std::size_t N, typename NameFn>
+std::string format_breakdown(const HdrHistogram (&hists)[N], NameFn name) {
+    std::ostringstream os;
+    bool first = true;
+    for (std::size_t i = 0; i < N; ++i) {
+        const auto& h = hists[i];
+        if (h.count() == 0) continue;
+        if (!first) os << ";";
+        first = false;
+        os << name(i) << ":" << h.count() << ":"
+           << us_to_ms(static_cast<double>(h.value_at_percentile(50.0))) << ":"
+           << us_to_ms(static_cast<double>(h.value_at_percentile(99.0))) << ":"
+           << us_to_ms(static_cast<double>(h.value_at_percentile(99.9)));
+    }
+    return os.str();
 }
 
-struct DiskSample {
-    unsigned long long read_sectors  = 0;
-    unsigned long long write_sectors = 0;
-};
+// "name:target:ok:fail:thr_rps:p50_ms:p99_ms:p999_ms;..." per --profile phase
+std::string format_phases(const RunResult& res) {
+    std::ostringstream os;
+    for (std::size_t i = 0; i < res.phases.size(); ++i) {
+        const auto& ph = res.phases[i];
+        if (i) os << ";";
+        os << ph.name << ":" << ph.target << ":" << ph.ok << ":" << ph.fail << ":"
+           << (ph.duration_s > 0.0 ? static_cast<double>(ph.ok) / ph.duration_s : 0.0) << ":"
+           << us_to_ms(static_cast<double>(ph.latency.value_at_percentile(50.0))) << ":"
+           << us_to_ms(static_cast<double>(ph.latency.value_at_percentile(99.0))) << ":"
+           << us_to_ms(static_cast<double>(ph.latency.value_at_percentile(99.9)));
+    }
+    return os.str();
+}
 
-// Aggregate sectors read/written across all non-loop, non-ram devices
-bool read_disk_sample(DiskSample& s) {
-    std::ifstream f("/proc/diskstats");
-    if (!f) return false;
+const char* status_label(std::size_t i) { return status_class_name(static_cast<StatusClass>(i)); }
+const char* source_label(std::size_t i) { return read_source_name(static_cast<ReadSource>(i + 1)); }
+const char* part_label(std::size_t i) { return latency_part_name(static_cast<LatencyPart>(i)); }
 
-    std::string line;
-    unsigned long long total_read = 0;
-    unsigned long long total_write = 0;
+void print_breakdown_line(const char* label, const HdrHistogram& h, uint64_t total) {
+    std::cout << "    " << std::left << std::setw(6) << label << std::right
+              << " n=" << h.count()
+              << " (" << (total ? 100.0 * static_cast<double>(h.count()) / static_cast<double>(total) : 0.0)
+              << "%) avg=" << us_to_ms(h.mean())
+              << "ms p50=" << us_to_ms(static_cast<double>(h.value_at_percentile(50.0)))
+              << "ms p99=" << us_to_ms(static_cast<double>(h.value_at_percentile(99.0)))
+              << "ms p99.9=" << us_to_ms(static_cast<double>(h.value_at_percentile(99.9)))
+              << "ms max=" << us_to_ms(static_cast<double>(h.max())) << "ms\n";
+}
 
-    while (std::getline(f, line)) {
-        std::istringstream iss(line);
-        unsigned long long major = 0, minor = 0;
-        std::string name;
-        if (!(iss >> major >> minor >> name)) continue;
+// Warn once a run's throughput (or offered rate) reaches this share of
+// kv-loadgen's calibrated maximum
+constexpr double kLoadgenLimitWarn = 0.7;
 
-        // Skip loopback / ram devices
-        if (name.rfind("loop", 0) == 0 || name.rfind("ram", 0) == 0) continue;
+// ---------- hot-set shift recovery ----------
 
-        unsigned long long rd_ios = 0, rd_merges = 0, rd_sectors = 0, rd_ticks = 0;
-        unsigned long long wr_ios = 0, wr_merges = 0, wr_sectors = 0, wr_ticks = 0;
+// After a --hotset-shift, the hit ratio / p99 count as recovered at the first
+// interval back within these factors of the interval before the shift
+constexpr double kHitRecovered = 0.95;
+constexpr double kP99Recovered = 1.2;
 
-        if (!(iss >> rd_ios >> rd_merges >> rd_sectors >> rd_ticks
-                  >> wr_ios >> wr_merges >> wr_sectors >> wr_ticks)) {
-            continue;
+// Follows the --timeseries intervals across hot-set shifts: the hit ratio and
+// p99 just before each shift, the worst interval after it, and how long until
+// both were back near where they were.
+class ShiftTracker {
+public:
+    void interval(uint64_t region, double shift_at_s, double t_s, bool have_hit, double hit, double p99) {
+        if (region != region_ && have_prev_) {
+            Shift s;
+            s.region     = region;
+            s.at_s       = shift_at_s;
+            s.have_hit   = have_hit && prev_have_hit_;
+            s.hit_before = prev_hit_;
+            s.p99_before = prev_p99_;
+            shifts_.push_back(s);
         }
+        region_ = region;
+        if (!shifts_.empty() && shifts_.back().region == region) {
+            Shift& s = shifts_.back();
+            double since = t_s - s.at_s;
+            if (s.have_hit && have_hit) {
+                s.hit_min = std::min(s.hit_min, hit);
+                if (s.hit_back_s < 0.0 && hit >= kHitRecovered * s.hit_before) s.hit_back_s = since;
+            }
+            s.p99_peak = std::max(s.p99_peak, p99);
+            if (s.p99_back_s < 0.0 && p99 <= kP99Recovered * s.p99_before) s.p99_back_s = since;
+        }
+        have_prev_     = true;
+        prev_have_hit_ = have_hit;
+        prev_hit_      = hit;
+        prev_p99_      = p99;
+    }
 
-        total_read  += rd_sectors;
-        total_write += wr_sectors;
+    void report() const {
+        for (const auto& s : shifts_) {
+            std::ostringstream os;
+            os << "Hot-set shift " << s.region << " at t=" << s.at_s << "s:";
+            if (s.have_hit) {
+                os << " hit_ratio " << s.hit_before << " -> min " << s.hit_min << ", "
+                   << recovered(s.hit_back_s) << ";";
+            }
+            os << " p99 " << s.p99_before << "ms -> peak " << s.p99_peak << "ms, "
+               << recovered(s.p99_back_s);
+            log_info(os.str());
+        }
     }
 
-    s.read_sectors  = total_read;
-    s.write_sectors = total_write;
-    return true;
-}
+private:
+    struct Shift {
+        uint64_t region     = 0;
+        double   at_s       = 0.0;
+        bool     have_hit   = false;
+        double   hit_before = 0.0;
+        double   hit_min    = 1.0;
+        double   hit_back_s = -1.0;   // < 0: not within this region's intervals
+        double   p99_before = 0.0;
+        double   p99_peak   = 0.0;
+        double   p99_back_s = -1.0;
+    };
 
-void compute_disk_rates(const DiskSample& a, const DiskSample& b,
-                        double seconds,
-                        double& read_MBps,
-                        double& write_MBps) {
-    if (seconds <= 0.0) {
-        read_MBps = write_MBps = 0.0;
-        return;
+    static std::string recovered(double s) {
+        if (s < 0.0) return "not recovered";
+        std::ostringstream os;
+        os << "recovered after " << s << "s";
+        return os.str();
     }
 
-    constexpr double sector_size = 512.0; // bytes
-    double read_bytes  = static_cast<double>(b.read_sectors  - a.read_sectors)  * sector_size;
-    double write_bytes = static_cast<double>(b.write_sectors - a.write_sectors) * sector_size;
+    std::vector<Shift> shifts_;
+    uint64_t           region_        = 0;
+    bool               have_prev_     = false;
+    bool               prev_have_hit_ = false;
+    double             prev_hit_      = 0.0;
+    double             prev_p99_      = 0.0;
+};
 
-    read_MBps  = (read_bytes  / (1024.0 * 1024.0)) / seconds;
-    write_MBps = (write_bytes / (1024.0 * 1024.0)) / seconds;
+// --conn-mode: requests per connection, 0 = keep-alive
+int parse_conn_mode(const std::string& mode) {
+    if (mode == "keepalive") return 0;
+    if (mode == "per-request") return 1;
+    if (mode.compare(0, 4, "per-") == 0 && mode.size() > 4 && mode.size() <= 13 &&
+        mode.find_first_not_of("0123456789", 4) == std::string::npos) {
+        int n = std::stoi(mode.substr(4));
+        if (n > 0) return n;
+    }
+    throw std::runtime_error("Unknown --conn-mode: " + mode + " (keepalive|per-request|per-<n>)");
+}
 
-    if (read_MBps  < 0.0) read_MBps  = 0.0;
-    if (write_MBps < 0.0) write_MBps = 0.0;
+// Where a --csv row with this header goes: path itself if it is new or has
+// the same header, otherwise the first of path.v2.csv, path.v3.csv, ... that
+// is. A file written by a version with other columns is never appended to,
+// since its rows would no longer line up with its header.
+std::string csv_append_path(const std::string& path, const std::string& header, bool& write_header) {
+    std::string stem = path, ext;
+    std::size_t dot = path.rfind('.');
+    if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+        stem = path.substr(0, dot);
+        ext  = path.substr(dot);
+    }
+    for (int v = 1;; ++v) {
+        std::string candidate = v == 1 ? path : stem + ".v" + std::to_string(v) + ext;
+        std::ifstream in(candidate);
+        std::string first;
+        if (!in || !std::getline(in, first)) {
+            write_header = true;
+        } else if (first == header) {
+            write_header = false;
+        } else {
+            continue;
+        }
+        if (v > 1) {
+            log_warn("--csv " + path + " has another column layout (older kv-loadgen?); writing to " +
+                     candidate + " instead");
+        }
+        return candidate;
+    }
 }
 
 } // namespace
 
 LoadGenConfig parse_loadgen_args(int argc, char** argv) {
     LoadGenConfig cfg;
+    cfg.args.assign(argv + 1, argv + argc);
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -153,7 +247,12 @@ LoadGenConfig parse_loadgen_args(int argc, char** argv) {
         if (arg == "--host")        cfg.host      = next(i);
         else if (arg == "--port")   cfg.port      = std::stoi(next(i));
         else if (arg == "--clients")cfg.clients   = std::stoi(next(i));
-        else if (arg == "--warmup") cfg.warmup_s  = std::stoi(next(i));
+        else if (arg == "--warmup") {
+            std::string v = next(i);
+            if (v == "auto") cfg.warmup_auto = true;
+            else             cfg.warmup_s    = std::stoi(v);
+        }
+        else if (arg == "--warmup-max") cfg.warmup_max_s = std::stoi(next(i));
         else if (arg == "--measure")cfg.measure_s = std::stoi(next(i));
         else if (arg == "--workload")cfg.workload = next(i);
         else if (arg == "--keys")   cfg.keys      = static_cast<std::size_t>(std::stoull(next(i)));
@@ -161,224 +260,682 @@ LoadGenConfig parse_loadgen_args(int argc, char** argv) {
         else if (arg == "--delete-ratio") cfg.delete_ratio = std::stod(next(i));
         else if (arg == "--seed")   cfg.seed      = std::stoull(next(i));
         else if (arg == "--csv")    cfg.csv_file  = next(i);
+        else if (arg == "--rate")   cfg.rate_rps  = std::stod(next(i));
+        else if (arg == "--arrival")cfg.arrival   = next(i);
+        else if (arg == "--hist-log") cfg.hist_log = next(i);
+        else if (arg == "--timeseries") cfg.timeseries_file = next(i);
+        else if (arg == "--interval") cfg.interval_s = std::stod(next(i));
+        else if (arg == "--cores")  cfg.cores     = next(i);
+        else if (arg == "--server-pid") {
+            for (int pid : parse_id_list(next(i))) cfg.server_pids.push_back(pid);
+        }
+        else if (arg == "--sample-interval") cfg.sample_interval_s = std::stod(next(i));
+        else if (arg == "--find-knee") cfg.find_knee = true;
+        else if (arg == "--knee-axis") cfg.knee_axis = next(i);
+        else if (arg == "--slo-p99") cfg.slo_p99_ms = std::stod(next(i));
+        else if (arg == "--knee-max") cfg.knee_max = std::stod(next(i));
+        else if (arg == "--knee-step") cfg.knee_step_s = std::stod(next(i));
+        else if (arg == "--knee-tolerance") cfg.knee_tolerance = std::stod(next(i));
+        else if (arg == "--knee-max-steps") cfg.knee_max_steps = std::stoi(next(i));
+        else if (arg == "--knee-out") cfg.knee_out = next(i);
+        else if (arg == "--coordinator") cfg.coordinator = true;
+        else if (arg == "--workers") cfg.workers = std::stoi(next(i));
+        else if (arg == "--worker-sockets") cfg.worker_sockets = next(i);
+        else if (arg == "--worker-listen") cfg.worker_listen = next(i);
+        else if (arg == "--worker-fd") cfg.worker_fd = std::stoi(next(i));
+        else if (arg == "--dist")   cfg.keydist.name = next(i);
+        else if (arg == "--engine") cfg.engine    = next(i);
+        else if (arg == "--value-size") cfg.value_size = next(i);
+        else if (arg == "--io-threads") cfg.io_threads = std::stoi(next(i));
+        else if (arg == "--pipeline") cfg.pipeline = std::stoi(next(i));
+        else if (arg == "--conn-mode") cfg.conn_mode = next(i);
+        else if (arg == "--zipf-theta") cfg.keydist.zipf_theta = std::stod(next(i));
+        else if (arg == "--hot-keys") cfg.keydist.hot_keys = static_cast<std::size_t>(std::stoull(next(i)));
+        else if (arg == "--hot-prob") cfg.keydist.hot_prob = std::stod(next(i));
+        else if (arg == "--exp-percentile") cfg.keydist.exp_percentile = std::stod(next(i));
+        else if (arg == "--exp-fraction") cfg.keydist.exp_fraction = std::stod(next(i));
+        else if (arg == "--scramble") cfg.keydist.scramble = next(i);
+        else if (arg == "--hotset-shift") cfg.hotset_shift_s = std::stod(next(i));
+        else if (arg == "--hotset-ramp") cfg.hotset_ramp_s = std::stod(next(i));
+        else if (arg == "--profile") cfg.profile_file = next(i);
+        else if (arg == "--preload") cfg.preload = true;
+        else if (arg == "--preload-only") cfg.preload = cfg.preload_only = true;
+        else if (arg == "--pg")     cfg.pg_conninfo = next(i);
+        else if (arg == "--direct-db") cfg.direct_db = true;
+        else if (arg == "--db-pool") cfg.db_pool = std::stoi(next(i));
+        else if (arg == "--calibrate") cfg.calibrate = true;
+        else if (arg == "--calibration") cfg.calibration_file = next(i);
+        else if (arg == "--preload-conns") cfg.preload_conns = std::stoi(next(i));
+        else if (arg == "--preload-pipeline") cfg.preload_pipeline = std::stoi(next(i));
+        else if (arg == "--insert-order") cfg.insert_order = next(i);
+        else if (arg == "--scan-max") cfg.scan_max = std::stoi(next(i));
+        else if (arg == "--insert-part") {
+            std::string v = next(i);
+            auto slash = v.find('/');
+            if (slash == std::string::npos) throw std::runtime_error("--insert-part expects <i>/<n>");
+            cfg.insert_offset = std::stoull(v.substr(0, slash));
+            cfg.insert_stride = std::stoull(v.substr(slash + 1));
+        }
         else if (arg == "--help" || arg == "-h") {
             std::cout
                 << "kv-loadgen options:\n"
                 << "  --host <ip>           Server host (default 127.0.0.1)\n"
                 << "  --port <n>            Server port (default 8080)\n"
-                << "  --clients <n>         Number of client threads\n"
-                << "  --warmup <s>          Warmup seconds (not measured)\n"
+                << "  --clients <n>         Number of clients (threads, or connections with --engine epoll)\n"
+                << "  --warmup <s>|auto     Warmup seconds (not measured); auto: until throughput and p99 settle\n"
+                << "  --warmup-max <s>      Longest --warmup auto (default 300)\n"
                 << "  --measure <s>         Measurement seconds\n"
-                << "  --workload <type>     get-popular|get-all|put-all|mixed\n"
+                << "  --workload <type>     get-popular|get-all|put-all|mixed|ycsb-a..ycsb-f\n"
                 << "  --keys <n>            Number of distinct keys\n"
                 << "  --put-ratio <r>       PUT ratio for mixed (0..1)\n"
                 << "  --delete-ratio <r>    DELETE ratio for mixed (0..1)\n"
                 << "  --seed <n>            RNG seed\n"
-                << "  --csv <file>          Write summary CSV row\n";
+                << "  --csv <file>          Write summary CSV row\n"
+                << "  --preload             Write every key once before the run and verify the count\n"
+                << "  --preload-only        Preload, then exit\n"
+                << "  --pg <conninfo>       Preload straight into PostgreSQL with COPY instead of PUTs\n"
+                << "  --preload-conns <n>   Preload connections (default 16)\n"
+                << "  --preload-pipeline <n> Preload PUTs in flight per connection (default 32)\n"
+                << "  --direct-db           Call the server's database layer from the client threads,\n"
+                << "                        bypassing HTTP and the cache (PostgreSQL from --pg)\n"
+                << "  --db-pool <n>         --direct-db: PostgreSQL connections (default: one per client)\n"
+                << "  --calibrate           Measure kv-loadgen's own max rate per connection model against\n"
+                << "                        an in-process null server, then exit\n"
+                << "  --calibration <file>  --calibrate: save the results; otherwise warn when a run nears them\n"
+                << "  --rate <rps>          Open-loop target rate across all clients (0 = closed-loop)\n"
+                << "  --arrival <type>      poisson|uniform inter-arrival times for --rate\n"
+                << "  --hist-log <file>     Write the full latency percentile distribution (HdrHistogram format)\n"
+                << "  --timeseries <file>   Write one CSV row per --interval (warmup included)\n"
+                << "  --interval <s>        Time-series interval in seconds (default 1)\n"
+                << "  --cores <list>        CPU cores to sample, e.g. 0-1 (default: all cores)\n"
+                << "  --server-pid <pids>   Sample CPU, context switches and I/O of these processes\n"
+                << "                        and their children (comma list, repeatable)\n"
+                << "  --sample-interval <s> System sampling interval in the measurement window (default 1)\n"
+                << "  --find-knee           Search for the saturation knee instead of one fixed run\n"
+                << "  --knee-axis <axis>    clients|rate (default: rate if --rate is given, else clients)\n"
+                << "  --slo-p99 <ms>        p99 latency SLO for --find-knee (default 10)\n"
+                << "  --knee-max <n>        Upper bound on the axis (default 32768 clients / 1e6 req/s)\n"
+                << "  --knee-step <s>       Max seconds per step if it never settles (default 20)\n"
+                << "  --knee-tolerance <f>  Stop bisecting once the bracket is within f (default 0.1)\n"
+                << "  --knee-max-steps <n>  Max steps in one search (default 16)\n"
+                << "  --knee-out <file>     Write the throughput/latency curve as CSV\n"
+                << "  --coordinator         Split --clients/--rate across worker processes and merge results\n"
+                << "  --workers <n>         coordinator: spawn n local worker processes\n"
+                << "  --worker-sockets <p>  coordinator: also use workers listening on these Unix sockets\n"
+                << "  --worker-listen <p>   Run as a worker, serving coordinators on Unix socket p\n"
+                << "  --dist <type>         uniform|zipf|hotspot|latest|exponential\n"
+                << "                        (default: hotspot for get-popular, uniform otherwise)\n"
+                << "  --zipf-theta <t>      Zipf/latest skew, 0 < t < 1 (default 0.99)\n"
+                << "  --hot-keys <n>        hotspot: size of the hot set (default 5)\n"
+                << "  --hot-prob <p>        hotspot: fraction of requests to the hot set (default 0.9)\n"
+                << "  --exp-percentile <p>  exponential: p% of requests fall in...\n"
+                << "  --exp-fraction <f>    ...the first f of the keyspace (default 95 / 0.1)\n"
+                << "  --scramble <mode>     auto|on|off hash ranks across the keyspace (auto: zipf, exponential)\n"
+                << "  --hotset-shift <s>    Move the hot region to a new part of the keyspace every s seconds\n"
+                << "  --hotset-ramp <s>     ...migrating traffic to it over s seconds (default 0: abrupt)\n"
+                << "  --profile <file>      JSON load shape: phases of constant, ramp, square and sine\n"
+                << "                        targets for --rate or the active clients; replaces --measure\n"
+                << "  --insert-order <o>    ycsb-*: hashed|ordered key names (default hashed)\n"
+                << "  --scan-max <n>        ycsb-e: scans read 1..n consecutive keys (default 100)\n"
+                << "  --insert-part <i>/<n> ycsb-*: use every n-th insert key starting at i (set by --coordinator)\n"
+                << "  --value-size <spec>   PUT value sizes: <n>|uniform:<min>-<max>|pareto:<min>:<alpha>[:<max>]|trace:<file>\n"
+                << "  --engine <type>       threads|epoll (default threads)\n"
+                << "  --io-threads <n>      epoll: event-loop threads (default: one per core)\n"
+                << "  --pipeline <n>        epoll: max in-flight requests per connection (default 1)\n"
+                << "  --conn-mode <m>       keepalive|per-request|per-<n>: open a new connection per\n"
+                << "                        request or every n requests (epoll; default keepalive)\n";
             std::exit(0);
         }
     }
 
+    if (cfg.arrival != "poisson" && cfg.arrival != "uniform") {
+        throw std::runtime_error("Unknown --arrival: " + cfg.arrival);
+    }
+    if (cfg.interval_s <= 0.0) {
+        throw std::runtime_error("--interval must be > 0");
+    }
+    if (cfg.warmup_s < 0 || cfg.warmup_max_s < 1) {
+        throw std::runtime_error("--warmup must be >= 0 and --warmup-max >= 1");
+    }
+    if (cfg.warmup_auto && cfg.coordinator) {
+        // Workers would each settle at a different moment
+        throw std::runtime_error("--warmup auto cannot be combined with --coordinator");
+    }
+    if (cfg.engine != "threads" && cfg.engine != "epoll") {
+        throw std::runtime_error("Unknown --engine: " + cfg.engine);
+    }
+    if (cfg.pipeline < 1) {
+        throw std::runtime_error("--pipeline must be >= 1");
+    }
+    cfg.conn_reuse = parse_conn_mode(cfg.conn_mode);
+    if (cfg.direct_db) {
+        if (cfg.engine != "threads") {
+            throw std::runtime_error("--direct-db runs its own client threads; drop --engine");
+        }
+        if (cfg.coordinator) {
+            throw std::runtime_error("--direct-db cannot be combined with --coordinator");
+        }
+        if (cfg.db_pool < 0) {
+            throw std::runtime_error("--db-pool must be >= 0");
+        }
+    }
+    if (cfg.calibrate && (cfg.direct_db || cfg.coordinator || cfg.find_knee)) {
+        throw std::runtime_error("--calibrate cannot be combined with --direct-db, --coordinator or --find-knee");
+    }
+    if (cfg.conn_reuse > 0 && cfg.engine != "epoll") {
+        // httplib connects inside the request, so connect time can't be told apart
+        throw std::runtime_error("--conn-mode " + cfg.conn_mode + " needs --engine epoll");
+    }
+    if (cfg.preload_conns < 1 || cfg.preload_pipeline < 1) {
+        throw std::runtime_error("--preload-conns and --preload-pipeline must be >= 1");
+    }
+    if (cfg.insert_order != "hashed" && cfg.insert_order != "ordered") {
+        throw std::runtime_error("Unknown --insert-order: " + cfg.insert_order);
+    }
+    if (cfg.hotset_shift_s < 0.0 || cfg.hotset_ramp_s < 0.0 ||
+        (cfg.hotset_ramp_s > 0.0 && cfg.hotset_ramp_s > cfg.hotset_shift_s)) {
+        throw std::runtime_error("--hotset-ramp needs --hotset-shift >= it, both >= 0");
+    }
+    if (cfg.hotset_shift_s > 0.0 && cfg.find_knee) {
+        throw std::runtime_error("--hotset-shift cannot be combined with --find-knee");
+    }
+    if (!cfg.profile_file.empty()) {
+        LoadProfile::load(cfg.profile_file, cfg); // validate early
+        if (cfg.find_knee || cfg.coordinator) {
+            throw std::runtime_error("--profile cannot be combined with --find-knee or --coordinator");
+        }
+    }
+    if (cfg.scan_max < 1) {
+        throw std::runtime_error("--scan-max must be >= 1");
+    }
+    if (cfg.insert_stride < 1 || cfg.insert_offset >= cfg.insert_stride) {
+        throw std::runtime_error("--insert-part <i>/<n> needs 0 <= i < n");
+    }
+    if (cfg.sample_interval_s <= 0.0) {
+        throw std::runtime_error("--sample-interval must be > 0");
+    }
+    if (!cfg.cores.empty()) {
+        parse_id_list(cfg.cores); // validate early
+    }
+    if (cfg.coordinator) {
+        if (cfg.workers < 0 || (cfg.workers == 0 && cfg.worker_sockets.empty())) {
+            throw std::runtime_error("--coordinator needs --workers <n> and/or --worker-sockets <paths>");
+        }
+        if (cfg.find_knee) {
+            throw std::runtime_error("--find-knee cannot be combined with --coordinator");
+        }
+        if (!cfg.timeseries_file.empty()) {
+            throw std::runtime_error("--timeseries is not supported with --coordinator");
+        }
+    }
+    if (cfg.find_knee) {
+        if (cfg.knee_axis.empty()) cfg.knee_axis = cfg.rate_rps > 0.0 ? "rate" : "clients";
+        if (cfg.knee_axis != "clients" && cfg.knee_axis != "rate") {
+            throw std::runtime_error("Unknown --knee-axis: " + cfg.knee_axis);
+        }
+        if (cfg.knee_axis == "clients" && cfg.rate_rps > 0.0) {
+            throw std::runtime_error("--knee-axis clients searches closed-loop; drop --rate");
+        }
+        if (cfg.slo_p99_ms <= 0.0 || cfg.knee_step_s <= 0.0 || cfg.knee_max_steps < 1) {
+            throw std::runtime_error("--slo-p99, --knee-step and --knee-max-steps must be > 0");
+        }
+    }
+
     return cfg;
 }
 
-int run_loadgen(const LoadGenConfig& cfg) {
-    log_info("Loadgen connecting to " + cfg.host + ":" + std::to_string(cfg.port) +
-             " workload=" + cfg.workload +
-             " clients=" + std::to_string(cfg.clients));
-
-    std::atomic<uint64_t> ok{0};
-    std::atomic<uint64_t> fail{0};
-    std::mutex lat_mu;
-    std::vector<double> lat_ms;
-
-    auto start_all = std::chrono::steady_clock::now();
-    auto warmup_end = start_all + std::chrono::seconds(cfg.warmup_s);
-    auto measure_end = warmup_end + std::chrono::seconds(cfg.measure_s);
-
-    // Samples for CPU and disk over the measurement window (warmup excluded)
-    CpuSample cpu_before{}, cpu_after{};
-    DiskSample disk_before{}, disk_after{};
-    bool have_cpu_samples  = false;
-    bool have_disk_samples = false;
-
-    auto worker = [&](int id) {
-        httplib::Client cli(cfg.host, cfg.port);
-        cli.set_keep_alive(true);
-
-        std::mt19937_64 rng(cfg.seed + static_cast<std::uint64_t>(id));
-        if (cfg.keys == 0) {
-            // Avoid UB if someone misconfigures keys=0
-            return;
-        }
-        std::uniform_int_distribution<std::uint64_t> keydist(0, cfg.keys - 1);
-        std::uniform_real_distribution<double> u01(0.0, 1.0);
-
-        // For get-popular: define a hot subset
-        const double hot_prob = 0.9; // 90% of requests go to hot set
-        std::size_t hot_count = std::min<std::size_t>(5, cfg.keys); // up to 5 hot keys
-        std::uniform_int_distribution<std::uint64_t> hotdist(
-            0, hot_count > 0 ? static_cast<std::uint64_t>(hot_count - 1) : 0
-        );
-        // Cold range: [hot_count, cfg.keys-1] if there is any cold key
-        std::uniform_int_distribution<std::uint64_t> colddist(
-            hot_count, cfg.keys > hot_count ? static_cast<std::uint64_t>(cfg.keys - 1)
-                                            : static_cast<std::uint64_t>(hot_count)
-        );
-
-        while (std::chrono::steady_clock::now() < measure_end) {
-            Op op = Op::GET;
-
-            if (cfg.workload == "get-popular") {
-                op = Op::GET;
-            } else if (cfg.workload == "get-all") {
-                op = Op::GET;
-            } else if (cfg.workload == "put-all") {
-                op = Op::PUT;
-            } else if (cfg.workload == "mixed") {
-                double r = u01(rng);
-                if (r < cfg.put_ratio) op = Op::PUT;
-                else if (r < cfg.put_ratio + cfg.delete_ratio) op = Op::DEL;
-                else op = Op::GET;
-            }
+RunResult run_measurement(const LoadGenConfig& cfg, LgClock::time_point start, bool sample_system,
+                          const LoadProfile* profile) {
+    RunContext ctx(cfg);
+    RunStats& stats = ctx.stats;
+    ctx.profile   = profile;
+    ctx.open_loop = cfg.rate_rps > 0.0 && cfg.clients > 0;
+    stats.track_intervals = !cfg.timeseries_file.empty() || cfg.warmup_auto;
 
-            // --- Key selection logic ---
-            uint64_t key_index = 0;
+    WorkloadGenerators gens = make_workload_generators(cfg);
+    ctx.mix     = gens.mix;
+    ctx.keydist = gens.keydist.get();
+    ctx.follow_inserts = gens.follow_inserts;
+    ctx.hotset_stride  = gens.hotset_stride;
+    ctx.values  = gens.values.get();
 
-            if (cfg.workload == "get-popular") {
-                // 90% of requests go to the first 'hot_count' keys,
-                // remaining 10% spread across the rest of the keyspace.
-                if (cfg.keys <= hot_count) {
-                    // All keys are "hot" if total keys <= hot_count
-                    key_index = hotdist(rng);
-                } else {
-                    double r = u01(rng);
-                    if (r < hot_prob) {
-                        key_index = hotdist(rng);     // pick from hot subset
-                    } else {
-                        key_index = colddist(rng);    // pick from cold keys
-                    }
-                }
-            } else {
-                // Other workloads: uniform over full key range
-                key_index = keydist(rng);
+    stats.init_recorders(cfg.clients);
+    auto& recorders = stats.recorders;
+
+    // --warmup auto starts out with the longest warmup allowed; the
+    // interval thread pulls the window in once the run looks steady
+    const auto start_all    = start;
+    const auto measure_for  = std::chrono::seconds(cfg.measure_s);
+    const auto warmup_limit = start + std::chrono::seconds(cfg.warmup_auto ? cfg.warmup_max_s : cfg.warmup_s);
+    ctx.start = start;
+    ctx.set_window(warmup_limit, warmup_limit + measure_for);
+
+    // System samples over the measurement window (warmup excluded): the
+    // summary uses first -> last, the per-interval rates give the peaks.
+    SysSampler sys(cfg.cores.empty() ? std::vector<int>{} : parse_id_list(cfg.cores),
+                   cfg.server_pids);
+    SysWindow sys_window(sys, cfg.sample_interval_s);
+    if (sample_system) {
+        SysSample probe;
+        if (sys.sample(probe) && !probe.have_cpu) {
+            log_warn("CPU sampling unavailable: not every core in --cores " + cfg.cores +
+                     " is listed in /proc/stat");
+        }
+    }
+    MetricsWindow metrics_window(cfg.host, cfg.port);
+    auto start_windows = [&](LgClock::time_point from, LgClock::time_point to) {
+        if (!sample_system) return;
+        sys_window.start(from, to);
+        if (!cfg.direct_db) metrics_window.start(from, to);
+    };
+    if (!cfg.warmup_auto) start_windows(ctx.warmup_end(), ctx.measure_end());
+
+    // Interval thread: every interval, drain the per-recorder interval
+    // histograms. During --warmup auto they go to the steady-state
+    // detector; for --timeseries, /metrics, CPU and disk are sampled over
+    // the same interval and written out with them.
+    std::thread ts_sampler;
+    ShiftTracker shifts;
+    bool warmup_steady = false;
+    if (stats.track_intervals) {
+        ts_sampler = std::thread([&]() {
+            std::ofstream out;
+            if (!cfg.timeseries_file.empty()) {
+                out.open(cfg.timeseries_file);
+                if (!out) log_warn("Failed to open time-series file: " + cfg.timeseries_file);
+            }
+            if (!out.is_open() && !cfg.warmup_auto) return;
+            if (out.is_open()) {
+                out << "t_s,phase,ok,fail,thr_rps,p50_ms,p99_ms,max_ms,"
+                       "srv_requests,srv_errors,srv_cache_hits,srv_cache_misses,srv_hit_ratio,"
+                       "cpu_utilization,disk_read_MBps,disk_write_MBps,ctxt_per_s,proc_cpu_pct,"
+                       "hotset,since_shift_s,profile_phase,target\n";
             }
 
-            std::string key = "key" + std::to_string(key_index);
+            MetricsScraper scraper(cfg.host, cfg.port);
 
-            auto t0 = std::chrono::steady_clock::now();
+            ServerMetrics m_prev{}, m_now{};
+            SysSample s_prev{}, s_now{};
+            bool have_m = out.is_open() && scraper.scrape(m_prev);
+            bool have_s = out.is_open() && sys.sample(s_prev);
 
-            bool success = false;
+            SteadyStateDetector detector;
+            bool warming = cfg.warmup_auto;
 
-            if (op == Op::GET) {
-                auto res = cli.Get(("/get/" + url_encode(key)).c_str());
-                success = (res && res->status == 200);
-            } else if (op == Op::PUT) {
-                httplib::Params p;
-                p.emplace("value", "v" + std::to_string(id));
-                auto res = cli.Put(("/put/" + url_encode(key)).c_str(), p);
-                success = (res && res->status == 200);
-            } else { // DEL
-                auto res = cli.Delete(("/delete/" + url_encode(key)).c_str());
-                success = (res && (res->status == 200 || res->status == 404));
-            }
+            HdrHistogram agg;
+            const auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(cfg.interval_s));
+            auto prev_tick = start_all;
 
-            auto t1 = std::chrono::steady_clock::now();
-            double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            while (prev_tick < ctx.measure_end()) {
+                auto tick = std::min(prev_tick + step, warming ? warmup_limit : ctx.measure_end());
+                std::this_thread::sleep_until(tick);
 
-            auto now = std::chrono::steady_clock::now();
-            if (now > warmup_end && now <= measure_end) {
-                if (success) ok.fetch_add(1, std::memory_order_relaxed);
-                else         fail.fetch_add(1, std::memory_order_relaxed);
+                uint64_t iv_ok = 0, iv_fail = 0;
+                stats.drain_interval(agg, iv_ok, iv_fail);
 
-                std::lock_guard<std::mutex> lk(lat_mu);
-                lat_ms.push_back(ms);
-            }
-        }
-    };
+                double secs = std::chrono::duration<double>(tick - prev_tick).count();
+                double t_s  = std::chrono::duration<double>(tick - start_all).count();
 
-    // Background sampler: measure CPU and disk during the *measurement* window only
-    std::thread sampler([&]() {
-        // Wait until warmup is done
-        std::this_thread::sleep_until(warmup_end);
+                if (warming) {
+                    double thr = secs > 0.0 ? static_cast<double>(iv_ok) / secs : 0.0;
+                    warmup_steady = detector.add(thr, static_cast<double>(agg.value_at_percentile(99.0)));
+                    if (warmup_steady || tick >= warmup_limit) {
+                        warming = false;
+                        ctx.set_window(tick, tick + measure_for);
+                        start_windows(tick, tick + measure_for);
+                        std::ostringstream os;
+                        os << (warmup_steady ? "Steady" : "Not steady") << " after " << t_s
+                           << "s of warmup; measuring for " << cfg.measure_s << "s";
+                        log_info(os.str());
+                    }
+                }
+                if (!out.is_open()) {
+                    prev_tick = tick;
+                    continue;
+                }
 
-        have_cpu_samples  = read_cpu_sample(cpu_before);
-        have_disk_samples = read_disk_sample(disk_before);
+                ServerMetricsDelta md;
+                bool m_ok = have_m && scraper.scrape(m_now);
+                if (m_ok) {
+                    md = metrics_delta(m_prev, m_now);
+                    m_prev = m_now;
+                } else if (!have_m) {
+                    // server may have come up after we started
+                    have_m = scraper.scrape(m_prev);
+                }
 
-        // Wait until measurement is done
-        std::this_thread::sleep_until(measure_end);
+                SysRates sr;
+                if (have_s && sys.sample(s_now)) {
+                    sr = sys.rates(s_prev, s_now);
+                    s_prev = std::move(s_now);
+                }
 
-        if (have_cpu_samples) {
-            have_cpu_samples = read_cpu_sample(cpu_after);
-        }
-        if (have_disk_samples) {
-            have_disk_samples = read_disk_sample(disk_after);
-        }
-    });
+                out << t_s << ","
+                    << (tick <= ctx.warmup_end() ? "warmup" : "measure") << ","
+                    << iv_ok << ","
+                    << iv_fail << ","
+                    << (secs > 0.0 ? static_cast<double>(iv_ok) / secs : 0.0) << ","
+                    << us_to_ms(static_cast<double>(agg.value_at_percentile(50.0))) << ","
+                    << us_to_ms(static_cast<double>(agg.value_at_percentile(99.0))) << ","
+                    << us_to_ms(static_cast<double>(agg.max())) << ",";
+                // Left empty (not 0) when /metrics couldn't be scraped, so a
+                // missed scrape doesn't read as a hit-ratio cliff
+                if (m_ok) {
+                    out << md.requests << ","
+                        << md.errors << ","
+                        << md.cache_hits << ","
+                        << md.cache_misses << ","
+                        << md.hit_ratio() << ",";
+                } else {
+                    out << ",,,,,";
+                }
+                out << sr.cpu_util << ","
+                    << sr.disk_read_MBps << ","
+                    << sr.disk_write_MBps << ","
+                    << sr.ctxt_per_s << ","
+                    << sr.total_proc().cpu_pct << ",";
+                if (ctx.hotset_stride) {
+                    // Region at the interval's midpoint (shifts can fall on a
+                    // tick), and how far into it the interval ended
+                    uint64_t region = ctx.hotset_region(prev_tick + (tick - prev_tick) / 2);
+                    double shift_at = std::chrono::duration<double>(ctx.warmup_end() - start_all).count() +
+                                      static_cast<double>(region) * cfg.hotset_shift_s;
+                    out << region << ",";
+                    if (region > 0) out << t_s - shift_at;
+                    if (tick > ctx.warmup_end()) {
+                        double p99 = us_to_ms(static_cast<double>(agg.value_at_percentile(99.0)));
+                        shifts.interval(region, shift_at, t_s, m_ok && md.cache_hits + md.cache_misses > 0,
+                                        md.hit_ratio(), p99);
+                    }
+                } else {
+                    out << ",";
+                }
+                out << ",";
+                if (profile) {
+                    auto mid = prev_tick + (tick - prev_tick) / 2;
+                    out << profile->phases()[static_cast<std::size_t>(ctx.phase_at(mid))].name << ","
+                        << profile->target_at(ctx.profile_time(mid));
+                } else {
+                    out << ",";
+                }
+                out << "\n";
+                out.flush();
 
-    std::vector<std::thread> threads;
-    threads.reserve(cfg.clients);
-    for (int i = 0; i < cfg.clients; ++i) {
-        threads.emplace_back(worker, i);
+                prev_tick = tick;
+            }
+        });
     }
-    for (auto& t : threads) t.join();
 
-    auto end_all = std::chrono::steady_clock::now();
-    (void)end_all; // currently unused
+    // Distributed runs agree on a start moment in advance
+    std::this_thread::sleep_until(start);
+    run_engine(ctx);
+
+    sys_window.join();
+    metrics_window.join();
+    if (ts_sampler.joinable()) {
+        ts_sampler.join();
+        shifts.report();
+    }
 
-    if (sampler.joinable()) {
-        sampler.join();
+    RunResult res;
+    res.open_loop  = ctx.open_loop;
+    res.ok         = stats.ok.load();
+    res.fail       = stats.fail.load();
+    res.late       = stats.late.load();
+    res.missed     = stats.missed.load();
+    res.max_lag_us = stats.max_lag_us.load();
+    res.tx_bytes   = stats.tx_bytes.load();
+    res.rx_bytes   = stats.rx_bytes.load();
+    res.connects     = stats.connects.load();
+    res.connect_fail = stats.connect_fail.load();
+    res.warmup_s      = std::chrono::duration<double>(ctx.warmup_end() - start_all).count();
+    res.warmup_steady = warmup_steady;
+    for (auto& rp : recorders) {
+        res.latency.merge(rp->hist);
+        if (rp->connect) res.connect_latency.merge(*rp->connect);
+        for (std::size_t k = 0; k < kOpKinds; ++k) {
+            if (rp->by_kind[k]) res.ops[k].latency.merge(*rp->by_kind[k]);
+        }
+        for (std::size_t s = 0; s < kStatusClasses; ++s) {
+            if (rp->by_status[s]) res.by_status[s].merge(*rp->by_status[s]);
+        }
+        for (std::size_t s = 0; s < kReadSources; ++s) {
+            if (rp->by_source[s]) res.by_source[s].merge(*rp->by_source[s]);
+        }
+        for (std::size_t p = 0; p < kLatencyParts; ++p) {
+            if (rp->by_part[p]) res.by_part[p].merge(*rp->by_part[p]);
+        }
+    }
+    for (std::size_t k = 0; k < kOpKinds; ++k) {
+        res.ops[k].ok   = stats.kind_ok[k].load();
+        res.ops[k].fail = stats.kind_fail[k].load();
     }
+    if (profile) {
+        res.phases_by_rate = profile->by_rate();
+        for (const auto& p : profile->phases()) {
+            RunResult::Phase ph;
+            ph.name       = p.name;
+            ph.shape      = p.describe();
+            ph.target     = p.mean_target();
+            ph.duration_s = p.duration_s;
+            res.phases.push_back(std::move(ph));
+        }
+        // The last phase also covers the rounding of the window to whole seconds
+        res.phases.back().duration_s = static_cast<double>(cfg.measure_s) - profile->phases().back().start_s;
+        for (auto& rp : recorders) {
+            for (std::size_t p = 0; p < rp->by_phase.size() && p < res.phases.size(); ++p) {
+                if (!rp->by_phase[p]) continue;
+                res.phases[p].ok   += rp->by_phase[p]->ok;
+                res.phases[p].fail += rp->by_phase[p]->fail;
+                res.phases[p].latency.merge(rp->by_phase[p]->hist);
+            }
+        }
+    }
+
+    res.have_sys      = sys_window.ok();
+    res.sys           = sys_window.rates();
+    res.cpu_peak      = sys_window.cpu_peak();
+    res.proc_cpu_peak = sys_window.proc_cpu_peak();
+    res.have_srv      = metrics_window.ok();
+    res.srv           = metrics_window.delta();
+    return res;
+}
 
+void report_run(const LoadGenConfig& cfg, const RunResult& res) {
     double measure_seconds = static_cast<double>(cfg.measure_s);
-    double thr = measure_seconds > 0.0 ? static_cast<double>(ok.load()) / measure_seconds : 0.0;
+    double thr = measure_seconds > 0.0 ? static_cast<double>(res.ok) / measure_seconds : 0.0;
 
-    double avg = 0.0;
-    if (!lat_ms.empty()) {
-        double sum = 0.0;
-        for (double x : lat_ms) sum += x;
-        avg = sum / static_cast<double>(lat_ms.size());
-    }
-    double p50 = pctl(lat_ms, 50.0);
-    double p95 = pctl(lat_ms, 95.0);
-    double p99 = pctl(lat_ms, 99.0);
+    const HdrHistogram& lat = res.latency;
 
-    double cpu_util = 0.0;
-    double disk_read_MBps = 0.0;
-    double disk_write_MBps = 0.0;
+    double avg  = us_to_ms(lat.mean());
+    double p50  = us_to_ms(static_cast<double>(lat.value_at_percentile(50.0)));
+    double p95  = us_to_ms(static_cast<double>(lat.value_at_percentile(95.0)));
+    double p99  = us_to_ms(static_cast<double>(lat.value_at_percentile(99.0)));
+    double p999 = us_to_ms(static_cast<double>(lat.value_at_percentile(99.9)));
+    double pmax = us_to_ms(static_cast<double>(lat.max()));
 
-    if (have_cpu_samples) {
-        cpu_util = cpu_utilization(cpu_before, cpu_after);
-    }
-    if (have_disk_samples) {
-        compute_disk_rates(disk_before, disk_after, measure_seconds,
-                           disk_read_MBps, disk_write_MBps);
-    }
+    double tx_MBps = measure_seconds > 0.0
+        ? static_cast<double>(res.tx_bytes) / (1024.0 * 1024.0) / measure_seconds : 0.0;
+    double rx_MBps = measure_seconds > 0.0
+        ? static_cast<double>(res.rx_bytes) / (1024.0 * 1024.0) / measure_seconds : 0.0;
+
+    const SysRates& sys_rates = res.sys;
+    ProcRate proc = sys_rates.total_proc();
+    double cpu_util        = sys_rates.cpu_util;
+    double disk_read_MBps  = sys_rates.disk_read_MBps;
+    double disk_write_MBps = sys_rates.disk_write_MBps;
+    const std::string cores_label = cfg.cores.empty() ? "all" : cfg.cores;
+    // --cores may be a comma list; the CSV field uses ';' like disks and ops
+    std::string cores_field = cores_label;
+    std::replace(cores_field.begin(), cores_field.end(), ',', ';');
 
     std::cout << "Loadgen summary:\n"
-              << "  ok=" << ok.load() << " fail=" << fail.load() << "\n"
+              << "  ok=" << res.ok << " fail=" << res.fail << "\n"
               << "  throughput=" << thr << " req/s\n"
               << "  avg=" << avg << "ms p50=" << p50
-              << "ms p95=" << p95 << "ms p99=" << p99 << "ms\n"
-              << "  cpu_util=" << cpu_util << "%\n"
+              << "ms p95=" << p95 << "ms p99=" << p99
+              << "ms p99.9=" << p999 << "ms max=" << pmax << "ms\n"
+              << "  cpu_util=" << cpu_util << "% (cores " << cores_label
+              << ", peak " << res.cpu_peak << "%) ctxt=" << sys_rates.ctxt_per_s << "/s\n"
               << "  disk_read=" << disk_read_MBps << " MB/s"
               << " disk_write=" << disk_write_MBps << " MB/s\n";
+    for (const auto& d : sys_rates.disks) {
+        std::cout << "    " << d.name << ": read=" << d.read_MBps
+                  << " MB/s write=" << d.write_MBps << " MB/s\n";
+    }
+    for (const auto& p : sys_rates.procs) {
+        std::cout << "  pid " << p.pid << " (" << p.comm << ", " << p.nprocs << " procs):"
+                  << " cpu=" << p.cpu_pct << "% vctx=" << p.vctx_per_s
+                  << "/s nvctx=" << p.nvctx_per_s << "/s";
+        if (p.have_io) {
+            std::cout << " read=" << p.read_MBps << " MB/s write=" << p.write_MBps << " MB/s";
+        } else {
+            std::cout << " io=n/a";
+        }
+        std::cout << "\n";
+    }
+    // Per-operation latency whenever the workload mixes operations
+    std::size_t kinds_seen = 0;
+    for (const auto& o : res.ops) kinds_seen += (o.ok + o.fail) > 0 ? 1 : 0;
+    const bool per_op = kinds_seen > 1 || cfg.workload.compare(0, 5, "ycsb-") == 0;
+    if (per_op) {
+        for (std::size_t k = 0; k < kOpKinds; ++k) {
+            const auto& o = res.ops[k];
+            if (o.ok + o.fail == 0) continue;
+            std::cout << "  " << std::left << std::setw(7) << op_kind_name(static_cast<OpKind>(k))
+                      << std::right
+                      << " ok=" << o.ok << " fail=" << o.fail
+                      << " thr=" << (measure_seconds > 0.0 ? static_cast<double>(o.ok) / measure_seconds : 0.0)
+                      << " ops/s avg=" << us_to_ms(o.latency.mean())
+                      << "ms p50=" << us_to_ms(static_cast<double>(o.latency.value_at_percentile(50.0)))
+                      << "ms p99=" << us_to_ms(static_cast<double>(o.latency.value_at_percentile(99.0)))
+                      << "ms p99.9=" << us_to_ms(static_cast<double>(o.latency.value_at_percentile(99.9)))
+                      << "ms max=" << us_to_ms(static_cast<double>(o.latency.max())) << "ms\n";
+        }
+    }
+    // Outcome split, whenever anything but 2xx came back
+    if (lat.count() > res.by_status[static_cast<std::size_t>(StatusClass::OK)].count()) {
+        std::cout << "  by status:\n";
+        for (std::size_t s = 0; s < kStatusClasses; ++s) {
+            if (res.by_status[s].count()) print_breakdown_line(status_label(s), res.by_status[s], lat.count());
+        }
+    }
+    // Reads split by where the server found the value (X-Cache header)
+    uint64_t sourced = res.by_source[0].count() + res.by_source[1].count();
+    if (sourced) {
+        std::cout << "  reads by source:\n";
+        for (std::size_t s = 0; s < kReadSources; ++s) {
+            print_breakdown_line(source_label(s), res.by_source[s], sourced);
+        }
+    }
+    // Network / pool wait / service split from Server-Timing (kv-server --server-timing)
+    const uint64_t timed = res.by_part[0].count();
+    if (timed) {
+        double sum = 0.0;
+        for (const auto& h : res.by_part) sum += h.mean();
+        std::cout << "  latency breakdown (" << timed
+                  << (cfg.direct_db ? " ops, pool wait / query" : " ops with Server-Timing") << "):\n";
+        for (std::size_t p = 0; p < kLatencyParts; ++p) {
+            const auto& h = res.by_part[p];
+            std::cout << "    " << std::left << std::setw(9) << part_label(p) << std::right
+                      << " avg=" << us_to_ms(h.mean()) << "ms ("
+                      << (sum > 0.0 ? 100.0 * h.mean() / sum : 0.0)
+                      << "% of avg) p50=" << us_to_ms(static_cast<double>(h.value_at_percentile(50.0)))
+                      << "ms p99=" << us_to_ms(static_cast<double>(h.value_at_percentile(99.0)))
+                      << "ms p99.9=" << us_to_ms(static_cast<double>(h.value_at_percentile(99.9)))
+                      << "ms max=" << us_to_ms(static_cast<double>(h.max())) << "ms\n";
+        }
+    }
+    // Per-phase results of a --profile run
+    if (!res.phases.empty()) {
+        std::cout << "  profile phases (" << (res.phases_by_rate ? "req/s" : "clients") << "):\n";
+        for (const auto& ph : res.phases) {
+            std::cout << "    " << std::left << std::setw(10) << ph.name << std::right
+                      << " " << ph.shape << " for " << ph.duration_s << "s"
+                      << " ok=" << ph.ok << " fail=" << ph.fail
+                      << " thr=" << (ph.duration_s > 0.0 ? static_cast<double>(ph.ok) / ph.duration_s : 0.0)
+                      << " req/s p50=" << us_to_ms(static_cast<double>(ph.latency.value_at_percentile(50.0)))
+                      << "ms p99=" << us_to_ms(static_cast<double>(ph.latency.value_at_percentile(99.0)))
+                      << "ms p99.9=" << us_to_ms(static_cast<double>(ph.latency.value_at_percentile(99.9)))
+                      << "ms max=" << us_to_ms(static_cast<double>(ph.latency.max())) << "ms\n";
+        }
+    }
+    if (res.have_srv) {
+        const ServerMetricsDelta& s = res.srv;
+        std::cout << "  server: requests=" << s.requests << " errors=" << s.errors
+                  << " cache_hits=" << s.cache_hits << " cache_misses=" << s.cache_misses
+                  << " hit_ratio=" << s.hit_ratio() << "\n";
+    } else {
+        std::cout << "  server: /metrics unavailable\n";
+    }
+    std::cout << "  payload_tx=" << tx_MBps << " MB/s payload_rx=" << rx_MBps << " MB/s\n";
+    // New connections (epoll engine; httplib's are invisible), e.g. from --conn-mode
+    const HdrHistogram& conn = res.connect_latency;
+    if (res.connects + res.connect_fail > 0) {
+        std::cout << "  connections (" << cfg.conn_mode << "): new=" << res.connects
+                  << " (" << (measure_seconds > 0.0 ? static_cast<double>(res.connects) / measure_seconds : 0.0)
+                  << "/s) fail=" << res.connect_fail
+                  << " connect avg=" << us_to_ms(conn.mean())
+                  << "ms p50=" << us_to_ms(static_cast<double>(conn.value_at_percentile(50.0)))
+                  << "ms p99=" << us_to_ms(static_cast<double>(conn.value_at_percentile(99.0)))
+                  << "ms p99.9=" << us_to_ms(static_cast<double>(conn.value_at_percentile(99.9)))
+                  << "ms max=" << us_to_ms(static_cast<double>(conn.max())) << "ms\n";
+    }
+    if (res.open_loop) {
+        std::cout << "  offered=" << (res.phases.empty() ? "" : "profile, peak ") << cfg.rate_rps
+                  << " req/s (" << cfg.arrival << ")"
+                  << " late=" << res.late << " missed=" << res.missed
+                  << " max_lag=" << static_cast<double>(res.max_lag_us) / 1000.0 << "ms\n";
+    }
+    if (cfg.warmup_auto) {
+        std::cout << "  warmup=auto: " << (res.warmup_steady ? "steady after " : "not steady after ")
+                  << res.warmup_s << "s (max " << cfg.warmup_max_s << "s)\n";
+        if (!res.warmup_steady) {
+            log_warn("No steady state within --warmup-max " + std::to_string(cfg.warmup_max_s) +
+                     "s; the window may still include warmup effects");
+        }
+    }
+    // Against kv-loadgen's own ceiling (--calibrate); per process, so not
+    // for merged coordinator results
+    double loadgen_max = 0.0;
+    if (!cfg.calibration_file.empty() && !cfg.coordinator) {
+        int calibrated_clients = 0;
+        loadgen_max = calibrated_max_rps(cfg, calibrated_clients);
+        if (loadgen_max > 0.0) {
+            double demand = std::max(thr, res.open_loop ? cfg.rate_rps : 0.0);
+            std::cout << "  loadgen: " << 100.0 * demand / loadgen_max << "% of its calibrated max "
+                      << loadgen_max << " req/s (" << connection_model(cfg) << ", "
+                      << calibrated_clients << " clients)\n";
+            if (demand >= kLoadgenLimitWarn * loadgen_max) {
+                log_warn("Run is at " + std::to_string(static_cast<int>(100.0 * demand / loadgen_max)) +
+                         "% of kv-loadgen's calibrated max for " + connection_model(cfg) +
+                         "; throughput and latency may be limited by the load generator, not the server");
+            }
+        }
+    }
 
     if (!cfg.csv_file.empty()) {
-        bool exists = false;
-        {
-            std::ifstream in(cfg.csv_file);
-            exists = in.good();
-        }
-        std::ofstream out(cfg.csv_file, std::ios::app);
+        static const std::string kCsvHeader =
+            "timestamp,host,port,workload,clients,warmup_s,measure_s,keys,"
+            "put_ratio,delete_ratio,seed,ok,fail,thr_rps,avg_ms,p50_ms,p95_ms,p99_ms,"
+            "cpu_utilization,disk_read_MBps,disk_write_MBps,"
+            "rate_rps,arrival,late,missed,max_lag_ms,p999_ms,max_ms,"
+            "value_size,tx_MBps,rx_MBps,"
+            "cores,cpu_peak,ctxt_per_s,proc_cpu_pct,proc_cpu_peak,"
+            "proc_vctx_per_s,proc_nvctx_per_s,proc_read_MBps,proc_write_MBps,disks,ops,"
+            "srv_requests,srv_errors,srv_cache_hits,srv_cache_misses,srv_hit_ratio,"
+            "n_2xx,n_404,n_other,n_5xx,n_error,status,reads,"
+            "net_avg_ms,net_p99_ms,pool_wait_avg_ms,pool_wait_p99_ms,service_avg_ms,service_p99_ms,"
+            "phases,conn_mode,connects,conn_per_s,connect_fail,connect_avg_ms,connect_p99_ms,"
+            "loadgen_max_rps,warmup_detected_s,warmup_steady";
+        bool write_header = false;
+        const std::string csv_path = csv_append_path(cfg.csv_file, kCsvHeader, write_header);
+        std::ofstream out(csv_path, std::ios::app);
         if (!out) {
-            std::cerr << "Failed to open CSV file: " << cfg.csv_file << "\n";
+            std::cerr << "Failed to open CSV file: " << csv_path << "\n";
         } else {
-            if (!exists) {
-                out << "timestamp,host,port,workload,clients,warmup_s,measure_s,keys,"
-                       "put_ratio,delete_ratio,seed,ok,fail,thr_rps,avg_ms,p50_ms,p95_ms,p99_ms,"
-                       "cpu_utilization,disk_read_MBps,disk_write_MBps\n";
-            }
+            if (write_header) out << kCsvHeader << "\n";
             auto ts = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
             out << ts << ","
                 << cfg.host << ","
@@ -391,8 +948,8 @@ int run_loadgen(const LoadGenConfig& cfg) {
                 << cfg.put_ratio << ","
                 << cfg.delete_ratio << ","
                 << cfg.seed << ","
-                << ok.load() << ","
-                << fail.load() << ","
+                << res.ok << ","
+                << res.fail << ","
                 << thr << ","
                 << avg << ","
                 << p50 << ","
@@ -400,9 +957,152 @@ int run_loadgen(const LoadGenConfig& cfg) {
                 << p99 << ","
                 << cpu_util << ","
                 << disk_read_MBps << ","
-                << disk_write_MBps << "\n";
+                << disk_write_MBps << ","
+                << cfg.rate_rps << ","
+                << (res.open_loop ? cfg.arrival : "closed") << ","
+                << res.late << ","
+                << res.missed << ","
+                << static_cast<double>(res.max_lag_us) / 1000.0 << ","
+                << p999 << ","
+                << pmax << ","
+                << (cfg.value_size.empty() ? "legacy" : cfg.value_size) << ","
+                << tx_MBps << ","
+                << rx_MBps << ","
+                << cores_field << ","
+                << res.cpu_peak << ","
+                << sys_rates.ctxt_per_s << ","
+                << proc.cpu_pct << ","
+                << res.proc_cpu_peak << ","
+                << proc.vctx_per_s << ","
+                << proc.nvctx_per_s << ","
+                << proc.read_MBps << ","
+                << proc.write_MBps << ","
+                << format_disks(sys_rates) << ","
+                << format_ops(res) << ",";
+            // Left empty (not 0) when /metrics couldn't be scraped
+            if (res.have_srv) {
+                out << res.srv.requests << ","
+                    << res.srv.errors << ","
+                    << res.srv.cache_hits << ","
+                    << res.srv.cache_misses << ","
+                    << res.srv.hit_ratio() << ",";
+            } else {
+                out << ",,,,,";
+            }
+            for (const auto& h : res.by_status) out << h.count() << ",";
+            out << format_breakdown(res.by_status, status_label) << ","
+                << format_breakdown(res.by_source, source_label);
+            // Left empty when the server sent no Server-Timing
+            for (const auto& h : res.by_part) {
+                out << ",";
+                if (timed) out << us_to_ms(h.mean()) << ","
+                               << us_to_ms(static_cast<double>(h.value_at_percentile(99.0)));
+                else       out << ",";
+            }
+            out << "," << format_phases(res) << ","
+                << cfg.conn_mode << ","
+                << res.connects << ","
+                << (measure_seconds > 0.0 ? static_cast<double>(res.connects) / measure_seconds : 0.0) << ","
+                << res.connect_fail << ",";
+            // Left empty when no connection was timed
+            if (conn.count()) {
+                out << us_to_ms(conn.mean()) << ","
+                    << us_to_ms(static_cast<double>(conn.value_at_percentile(99.0)));
+            } else {
+                out << ",";
+            }
+            out << ",";
+            if (loadgen_max > 0.0) out << loadgen_max;
+            // Left empty for a fixed --warmup
+            out << ",";
+            if (cfg.warmup_auto) out << res.warmup_s << "," << (res.warmup_steady ? 1 : 0);
+            else                 out << ",";
+            out << "\n";
+        }
+    }
+
+    if (!cfg.hist_log.empty()) {
+        std::ofstream out(cfg.hist_log);
+        if (!out) {
+            std::cerr << "Failed to open histogram log: " << cfg.hist_log << "\n";
+        } else {
+            out << "# kv-loadgen workload=" << cfg.workload
+                << " clients=" << cfg.clients
+                << " rate_rps=" << cfg.rate_rps
+                << " measure_s=" << cfg.measure_s << " (values in ms)\n";
+            lat.write_percentiles(out, 1000.0);
+            if (per_op) {
+                for (std::size_t k = 0; k < kOpKinds; ++k) {
+                    if (res.ops[k].latency.count() == 0) continue;
+                    out << "\n# op=" << op_kind_name(static_cast<OpKind>(k)) << "\n";
+                    res.ops[k].latency.write_percentiles(out, 1000.0);
+                }
+            }
+            for (std::size_t s = 0; s < kStatusClasses; ++s) {
+                if (res.by_status[s].count() == 0 || res.by_status[s].count() == lat.count()) continue;
+                out << "\n# status=" << status_label(s) << "\n";
+                res.by_status[s].write_percentiles(out, 1000.0);
+            }
+            for (std::size_t s = 0; s < kReadSources; ++s) {
+                if (res.by_source[s].count() == 0) continue;
+                out << "\n# read=" << source_label(s) << "\n";
+                res.by_source[s].write_percentiles(out, 1000.0);
+            }
+            for (std::size_t p = 0; p < kLatencyParts && timed; ++p) {
+                out << "\n# part=" << part_label(p) << "\n";
+                res.by_part[p].write_percentiles(out, 1000.0);
+            }
+            if (conn.count()) {
+                out << "\n# connect\n";
+                conn.write_percentiles(out, 1000.0);
+            }
         }
     }
+}
+
+namespace {
+
+std::string engine_label(const LoadGenConfig& cfg) {
+    return cfg.direct_db ? "direct-db (PostgreSQL, no HTTP)" : cfg.engine;
+}
+
+// The profile sets the window (whole seconds, the last phase runs on to
+// fill it) and the load: the peak rate, thinned per client, or as many
+// clients as the peak, idled down to the current target.
+int run_profile(const LoadGenConfig& base) {
+    LoadProfile profile = LoadProfile::load(base.profile_file, base);
+    LoadGenConfig cfg = base;
+    cfg.measure_s = static_cast<int>(std::ceil(profile.duration_s()));
+    if (profile.by_rate()) {
+        cfg.rate_rps = profile.peak();
+    } else {
+        cfg.clients  = static_cast<int>(std::ceil(profile.peak()));
+        cfg.rate_rps = 0.0;
+    }
+
+    log_info("Loadgen connecting to " + cfg.host + ":" + std::to_string(cfg.port) +
+             " profile=" + cfg.profile_file +
+             " phases=" + std::to_string(profile.phases().size()) +
+             " measure_s=" + std::to_string(cfg.measure_s) +
+             (profile.by_rate() ? " clients=" + std::to_string(cfg.clients) : " max_clients=" + std::to_string(cfg.clients)) +
+             " engine=" + engine_label(cfg));
+
+    RunResult res = run_measurement(cfg, LgClock::now(), true, &profile);
+    report_run(cfg, res);
+    return 0;
+}
+
+} // namespace
+
+int run_loadgen(const LoadGenConfig& cfg) {
+    if (!cfg.profile_file.empty()) return run_profile(cfg);
+
+    log_info("Loadgen connecting to " + cfg.host + ":" + std::to_string(cfg.port) +
+             " workload=" + cfg.workload +
+             " clients=" + std::to_string(cfg.clients) +
+             " engine=" + engine_label(cfg));
 
+    RunResult res = run_measurement(cfg, LgClock::now(), true);
+    report_run(cfg, res);
     return 0;
 }
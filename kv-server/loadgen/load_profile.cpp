@@ -0,0 +1,165 @@
+#include "load_profile.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+double number(const json& j, const char* key, const std::string& where) {
+    if (!j.contains(key)) throw std::runtime_error(where + ": missing \"" + key + "\"");
+    if (!j.at(key).is_number()) throw std::runtime_error(where + ": \"" + key + "\" must be a number");
+    return j.at(key).get<double>();
+}
+
+double number_or(const json& j, const char* key, double def, const std::string& where) {
+    return j.contains(key) ? number(j, key, where) : def;
+}
+
+ProfilePhase parse_phase(const json& j, std::size_t i, const LoadGenConfig& cfg) {
+    if (!j.is_object()) throw std::runtime_error("--profile: phase " + std::to_string(i) + " is not an object");
+
+    ProfilePhase p;
+    p.name  = j.value("name", "phase" + std::to_string(i));
+    p.shape = j.value("shape", "constant");
+    const std::string where = "--profile phase \"" + p.name + "\"";
+    // The name is written as-is into CSV fields and their ';' / ':' sub-fields
+    if (p.name.empty() ||
+        std::any_of(p.name.begin(), p.name.end(), [](unsigned char ch) {
+            return ch < 0x20 || ch == ',' || ch == ';' || ch == ':' || ch == '"';
+        })) {
+        throw std::runtime_error(where + ": name must be non-empty, without , ; : \" or control characters");
+    }
+
+    p.duration_s = number(j, "duration", where);
+    if (p.duration_s <= 0.0) throw std::runtime_error(where + ": duration must be > 0");
+
+    double lowest = 0.0;
+    if (p.shape == "constant") {
+        p.target = number(j, "target", where);
+        lowest   = p.target;
+    } else if (p.shape == "ramp") {
+        p.from = number(j, "from", where);
+        p.to   = number(j, "to", where);
+        lowest = std::min(p.from, p.to);
+    } else if (p.shape == "square" || p.shape == "sine") {
+        p.period_s = number(j, "period", where);
+        if (p.period_s <= 0.0) throw std::runtime_error(where + ": period must be > 0");
+        if (p.shape == "square") {
+            p.low  = number(j, "low", where);
+            p.high = number(j, "high", where);
+            p.duty = number_or(j, "duty", 0.5, where);
+            if (p.duty <= 0.0 || p.duty >= 1.0) throw std::runtime_error(where + ": duty must be in (0, 1)");
+            lowest = std::min(p.low, p.high);
+        } else {
+            p.mean      = number(j, "mean", where);
+            p.amplitude = number(j, "amplitude", where);
+            lowest      = p.mean - std::fabs(p.amplitude);
+        }
+    } else {
+        throw std::runtime_error(where + ": unknown shape \"" + p.shape + "\" (constant|ramp|square|sine)");
+    }
+    if (lowest < 0.0) throw std::runtime_error(where + ": target goes below 0");
+
+    // Operation mix: the run's unless the phase names a workload
+    LoadGenConfig wc = cfg;
+    if (j.contains("workload")) {
+        p.workload      = j.at("workload").get<std::string>();
+        wc.workload     = p.workload;
+        wc.put_ratio    = number_or(j, "put_ratio", cfg.put_ratio, where);
+        wc.delete_ratio = number_or(j, "delete_ratio", cfg.delete_ratio, where);
+    }
+    try {
+        p.mix = workload_mix(wc);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(where + ": " + e.what());
+    }
+    return p;
+}
+
+} // namespace
+
+double ProfilePhase::target_at(double t) const {
+    t = std::clamp(t, 0.0, duration_s);
+    if (shape == "ramp") return from + (to - from) * t / duration_s;
+    if (shape == "square") {
+        double into = std::fmod(t, period_s);
+        return into < duty * period_s ? high : low;
+    }
+    if (shape == "sine") return mean + amplitude * std::sin(2.0 * kPi * t / period_s);
+    return target;
+}
+
+double ProfilePhase::mean_target() const {
+    if (shape == "ramp") return (from + to) / 2.0;
+    if (shape == "constant") return target;
+    // Partial periods make the exact mean depend on the phase length
+    constexpr int kSteps = 1000;
+    double sum = 0.0;
+    for (int i = 0; i < kSteps; ++i) sum += target_at((i + 0.5) * duration_s / kSteps);
+    return sum / kSteps;
+}
+
+std::string ProfilePhase::describe() const {
+    std::ostringstream os;
+    if (shape == "ramp")        os << "ramp " << from << "->" << to;
+    else if (shape == "square") os << "square " << low << "/" << high << " every " << period_s << "s";
+    else if (shape == "sine")   os << "sine " << mean << "+-" << amplitude << " every " << period_s << "s";
+    else                        os << target;
+    return os.str();
+}
+
+LoadProfile LoadProfile::load(const std::string& path, const LoadGenConfig& cfg) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open --profile " + path);
+    json j;
+    try {
+        in >> j;
+    } catch (const std::exception& e) {
+        throw std::runtime_error("--profile " + path + ": " + e.what());
+    }
+    if (!j.is_object() || !j.contains("phases") || !j.at("phases").is_array() || j.at("phases").empty()) {
+        throw std::runtime_error("--profile " + path + ": expected {\"phases\": [...]}");
+    }
+
+    LoadProfile prof;
+    std::string by = j.value("by", "rate");
+    if (by != "rate" && by != "clients") {
+        throw std::runtime_error("--profile " + path + ": \"by\" must be rate or clients");
+    }
+    prof.by_rate_ = by == "rate";
+
+    std::size_t i = 0;
+    for (const auto& pj : j.at("phases")) {
+        ProfilePhase p = parse_phase(pj, i++, cfg);
+        p.start_s = prof.duration_s_;
+        prof.duration_s_ += p.duration_s;
+        if (p.shape == "ramp")        prof.peak_ = std::max({prof.peak_, p.from, p.to});
+        else if (p.shape == "square") prof.peak_ = std::max({prof.peak_, p.low, p.high});
+        else if (p.shape == "sine")   prof.peak_ = std::max(prof.peak_, p.mean + std::fabs(p.amplitude));
+        else                          prof.peak_ = std::max(prof.peak_, p.target);
+        prof.phases_.push_back(std::move(p));
+    }
+    if (prof.peak_ <= 0.0) throw std::runtime_error("--profile " + path + ": every target is 0");
+    return prof;
+}
+
+std::size_t LoadProfile::phase_at(double t) const {
+    for (std::size_t i = 0; i + 1 < phases_.size(); ++i) {
+        if (t < phases_[i].start_s + phases_[i].duration_s) return i;
+    }
+    return phases_.size() - 1;
+}
+
+double LoadProfile::target_at(double t) const {
+    const ProfilePhase& p = phases_[phase_at(t)];
+    return p.target_at(t - p.start_s);
+}
@@ -7,7 +7,13 @@ int main(int argc, char** argv) {
     try {
         LoadGenConfig cfg = parse_loadgen_args(argc, argv);
         log_set_level("INFO");
-        return run_loadgen(cfg);
+        if (cfg.worker_fd >= 0 || !cfg.worker_listen.empty()) return run_worker(cfg);
+        if (cfg.calibrate) return run_calibration(cfg);
+        if (cfg.preload && !run_preload(cfg)) return 1;
+        if (cfg.preload_only) return 0;
+        if (cfg.direct_db && !direct_db_open(cfg)) return 1;
+        if (cfg.coordinator) return run_coordinator(cfg);
+        return cfg.find_knee ? run_knee_search(cfg) : run_loadgen(cfg);
     } catch (const std::exception& e) {
         std::cerr << "kv-loadgen fatal error: " << e.what() << "\n";
         return 1;
@@ -0,0 +1,230 @@
+#include "null_server.h"
+#include "utils.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+constexpr int         kWaitMs    = 100;   // how often a loop checks stop_
+constexpr std::size_t kReadChunk = 16 * 1024;
+
+const char kGetResponse[]   = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 5\r\n\r\nvalue";
+const char kOtherResponse[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\n\r\nOK";
+const char kCloseHeader[]   = "Connection: close\r\n";
+
+struct Conn {
+    std::string in;
+    std::string out;
+    bool        closing  = false;  // close once out is flushed
+    bool        want_out = false;  // waiting for EPOLLOUT (reads paused)
+};
+
+// Value of header `name` (lower-case, with colon) in [p, end), or nullptr
+const char* find_header(const char* p, const char* end, const char* name) {
+    std::size_t n = std::strlen(name);
+    for (const char* line = p; line < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+        if (!eol) eol = end;
+        if (static_cast<std::size_t>(eol - line) > n) {
+            std::size_t i = 0;
+            while (i < n && std::tolower(static_cast<unsigned char>(line[i])) == name[i]) ++i;
+            if (i == n) {
+                const char* v = line + n;
+                while (v < eol && *v == ' ') ++v;
+                return v;
+            }
+        }
+        line = eol + 1;
+    }
+    return nullptr;
+}
+
+// Answer every complete request in c.in. False on a malformed request.
+bool serve(Conn& c) {
+    std::size_t off = 0;
+    for (;;) {
+        std::size_t head = c.in.find("\r\n\r\n", off);
+        if (head == std::string::npos) break;
+        const char* p   = c.in.data() + off;
+        const char* end = c.in.data() + head;
+
+        std::size_t body = 0;
+        if (const char* v = find_header(p, end, "content-length:")) {
+            body = static_cast<std::size_t>(std::strtoull(v, nullptr, 10));
+        }
+        if (c.in.size() < head + 4 + body) break;
+
+        const char* v = find_header(p, end, "connection:");
+        bool close = v && (end - v) >= 5 && strncasecmp(v, "close", 5) == 0;
+        if (std::strncmp(p, "GET ", 4) == 0) {
+            c.out.append(kGetResponse, sizeof(kGetResponse) - 1);
+        } else {
+            c.out.append(kOtherResponse, sizeof(kOtherResponse) - 1);
+        }
+        if (close) {
+            // Slot the header in before the blank line of the response just added
+            c.out.insert(c.out.rfind("\r\n\r\n") + 2, kCloseHeader);
+            c.closing = true;
+            off = c.in.size();
+            break;
+        }
+        off = head + 4 + body;
+    }
+    if (off) c.in.erase(0, off);
+    return c.in.size() <= 64 * 1024;
+}
+
+// Write as much of c.out as the socket takes. False once the connection is done.
+bool flush(int fd, Conn& c) {
+    std::size_t off = 0;
+    while (off < c.out.size()) {
+        ssize_t n = send(fd, c.out.data() + off, c.out.size() - off, MSG_NOSIGNAL);
+        if (n > 0) {
+            off += static_cast<std::size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    c.out.erase(0, off);
+    return !(c.closing && c.out.empty());
+}
+
+} // namespace
+
+bool NullServer::start() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        log_error(std::string("null server: socket() failed: ") + std::strerror(errno));
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+    socklen_t len = sizeof(addr);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 4096) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        log_error(std::string("null server: bind/listen failed: ") + std::strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+
+    stop_ = false;
+    for (int i = 0; i < threads_; ++i) loops_.emplace_back(&NullServer::loop, this);
+    return true;
+}
+
+void NullServer::stop() {
+    stop_ = true;
+    for (auto& t : loops_) t.join();
+    loops_.clear();
+    if (listen_fd_ >= 0) close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+// One epoll loop; the loops share the listening socket (EPOLLEXCLUSIVE, so
+// a new connection wakes one of them) and each serves what it accepted.
+void NullServer::loop() {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        log_error(std::string("null server: epoll_create1 failed: ") + std::strerror(errno));
+        return;
+    }
+    epoll_event lev{};
+    lev.events  = EPOLLIN | EPOLLEXCLUSIVE;
+    lev.data.fd = listen_fd_;
+    epoll_ctl(ep, EPOLL_CTL_ADD, listen_fd_, &lev);
+
+    std::unordered_map<int, Conn> conns;
+    auto drop = [&](int fd) {
+        epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        conns.erase(fd);
+    };
+
+    epoll_event events[256];
+    char buf[kReadChunk];
+    while (!stop_.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(ep, events, 256, kWaitMs);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                for (;;) {
+                    int c = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (c < 0) break;
+                    int one = 1;
+                    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    epoll_event ev{};
+                    ev.events  = EPOLLIN | EPOLLRDHUP;
+                    ev.data.fd = c;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, c, &ev);
+                    conns[c];
+                }
+                continue;
+            }
+
+            auto it = conns.find(fd);
+            if (it == conns.end()) continue;
+            Conn& c = it->second;
+
+            bool alive = true;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                for (;;) {
+                    ssize_t r = recv(fd, buf, sizeof(buf), 0);
+                    if (r > 0) {
+                        c.in.append(buf, static_cast<std::size_t>(r));
+                        if (static_cast<std::size_t>(r) < sizeof(buf)) break;
+                    } else if (r < 0 && errno == EINTR) {
+                        continue;
+                    } else if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        break;
+                    } else {
+                        alive = false;
+                        break;
+                    }
+                }
+                if (alive && !c.closing) alive = serve(c);
+            }
+            if (alive) alive = flush(fd, c);
+            if (!alive) {
+                drop(fd);
+                continue;
+            }
+            // Wait for the socket to drain before reading more
+            bool want_out = !c.out.empty();
+            if (want_out != c.want_out) {
+                epoll_event ev{};
+                ev.events  = EPOLLRDHUP | (want_out ? EPOLLOUT : EPOLLIN);
+                ev.data.fd = fd;
+                epoll_ctl(ep, EPOLL_CTL_MOD, fd, &ev);
+                c.want_out = want_out;
+            }
+        }
+    }
+
+    for (auto& kv : conns) close(kv.first);
+    close(ep);
+}
@@ -0,0 +1,297 @@
+#include "load_generator.h"
+#include "loadgen_engine.h"
+#include "utils.h"
+
+#include <httplib.h>
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// --preload: write key indexes [0, --keys) once before the measurement.
+// Through the server, this is the epoll engine issuing pipelined PUTs over
+// --preload-conns connections; with --pg the rows go straight into kv_store
+// with one COPY per connection (into a temp table, then upserted, so a
+// reload over existing keys works). Either way the keys that landed are
+// checked before the run starts: by GETs of a sample through the server,
+// by counting the rows with COPY.
+
+namespace {
+
+// Progress is logged this often
+constexpr auto kProgressEvery = std::chrono::seconds(5);
+// An HTTP preload that makes no progress for this long is given up, and so
+// is one with more failed PUTs (each retried) than keys
+constexpr auto kStallTimeout = std::chrono::seconds(30);
+// COPY data is sent in chunks of about this size
+constexpr std::size_t kCopyChunk = 1 << 20;
+// Keys read back after an HTTP preload, spread evenly over the keyspace
+constexpr uint64_t kVerifySample = 1000;
+
+struct PreloadOutcome {
+    uint64_t written  = 0;   // acknowledged PUTs / rows upserted
+    uint64_t checked  = 0;   // keys looked for: a sample over HTTP, all with COPY
+    uint64_t verified = 0;   // of those, keys found
+    uint64_t bytes    = 0;   // value payload
+};
+
+// ---------- HTTP: pipelined PUTs on the epoll engine ----------
+
+bool preload_http(const LoadGenConfig& cfg, const ValueGenerator* values, PreloadOutcome& out) {
+    LoadGenConfig pc = cfg;
+    pc.engine   = "epoll";
+    pc.clients  = cfg.preload_conns;
+    pc.pipeline = cfg.preload_pipeline;
+    pc.rate_rps = 0.0;
+
+    RunContext ctx(pc);
+    ctx.values    = values;
+    ctx.fill_keys = cfg.keys;
+    ctx.stats.init_recorders(pc.clients);
+    ctx.start       = LgClock::now();
+    ctx.set_window(ctx.start, ctx.start + std::chrono::hours(24 * 365));
+
+    std::atomic<bool> stalled{false};
+    std::thread progress([&]() {
+        uint64_t last_done = 0;
+        auto last_change = LgClock::now();
+        auto next_log = last_change + kProgressEvery;
+        while (!ctx.stop.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            uint64_t done = ctx.stats.ok.load();
+            auto now = LgClock::now();
+            if (done >= cfg.keys) break;
+            if (ctx.stats.fail.load() > cfg.keys) {
+                stalled = true;
+                break;
+            }
+            if (done != last_done) {
+                last_done = done;
+                last_change = now;
+            } else if (now - last_change > kStallTimeout) {
+                stalled = true;
+                break;
+            }
+            if (now >= next_log) {
+                next_log += kProgressEvery;
+                log_info("Preload: " + std::to_string(done) + "/" + std::to_string(cfg.keys) + " keys");
+            }
+        }
+        ctx.stop.store(true, std::memory_order_relaxed);
+    });
+
+    run_epoll_engine(ctx);
+    ctx.stop.store(true, std::memory_order_relaxed);
+    progress.join();
+
+    uint64_t fail = ctx.stats.fail.load();
+    if (stalled) log_error("Preload gave up: no progress for " + std::to_string(kStallTimeout.count()) +
+                           " s or too many failed PUTs");
+    if (fail) log_warn("Preload: " + std::to_string(fail) + " PUTs failed and were retried");
+
+    out.written = ctx.stats.ok.load();
+    out.bytes   = ctx.stats.tx_bytes.load();
+    if (stalled) return false;
+
+    // An acknowledged PUT says nothing about what a GET will find (a server
+    // that drops writes acknowledges them too), so read a sample back
+    httplib::Client cli(cfg.host, cfg.port);
+    cli.set_keep_alive(true);
+    out.checked = std::min(kVerifySample, cfg.keys);
+    for (uint64_t s = 0; s < out.checked; ++s) {
+        uint64_t i = cfg.keys * s / out.checked;
+        auto res = cli.Get(("/get/" + url_encode(make_key(cfg, i))).c_str());
+        if (res && res->status == 200) ++out.verified;
+    }
+    return true;
+}
+
+// ---------- PostgreSQL: COPY ----------
+
+bool exec_sql(PGconn* c, const char* sql) {
+    PGresult* r = PQexec(c, sql);
+    bool ok = r && (PQresultStatus(r) == PGRES_COMMAND_OK || PQresultStatus(r) == PGRES_TUPLES_OK);
+    if (!ok) log_error(std::string("Preload: ") + sql + " failed: " + PQerrorMessage(c));
+    if (r) PQclear(r);
+    return ok;
+}
+
+// Append s in COPY text format
+void append_copy_field(std::string& out, std::string_view s) {
+    for (char ch : s) {
+        switch (ch) {
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t";  break;
+            case '\n': out += "\\n";  break;
+            case '\r': out += "\\r";  break;
+            default:   out += ch;     break;
+        }
+    }
+}
+
+// One connection's slice [lo, hi): COPY into a temp table, upsert into
+// kv_store, then count the slice's keys that are now in kv_store.
+bool copy_slice(const LoadGenConfig& cfg, const ValueGenerator* values, int slot,
+                uint64_t lo, uint64_t hi, std::atomic<uint64_t>& copied, PreloadOutcome& out) {
+    std::unique_ptr<PGconn, decltype(&PQfinish)> conn(PQconnectdb(cfg.pg_conninfo.c_str()), &PQfinish);
+    PGconn* c = conn.get();
+    if (PQstatus(c) != CONNECTION_OK) {
+        log_error(std::string("Preload: PQconnectdb failed: ") + PQerrorMessage(c));
+        return false;
+    }
+    if (!exec_sql(c, "CREATE TEMP TABLE kv_preload (key TEXT, value TEXT)")) return false;
+
+    PGresult* r = PQexec(c, "COPY kv_preload (key, value) FROM STDIN");
+    bool started = r && PQresultStatus(r) == PGRES_COPY_IN;
+    if (r) PQclear(r);
+    if (!started) {
+        log_error(std::string("Preload: COPY failed: ") + PQerrorMessage(c));
+        return false;
+    }
+
+    std::mt19937_64 rng(cfg.seed + 7919u * static_cast<std::uint64_t>(slot));
+    const std::string legacy = "v" + std::to_string(slot);
+    std::string buf;
+    buf.reserve(kCopyChunk + 4096);
+    bool ok = true;
+    uint64_t reported = lo;
+    for (uint64_t i = lo; i < hi && ok; ++i) {
+        std::string_view v = values ? values->next(rng) : std::string_view(legacy);
+        append_copy_field(buf, make_key(cfg, i));
+        buf += '\t';
+        append_copy_field(buf, v);
+        buf += '\n';
+        out.bytes += v.size();
+        if (buf.size() >= kCopyChunk || i + 1 == hi) {
+            ok = PQputCopyData(c, buf.data(), static_cast<int>(buf.size())) == 1;
+            buf.clear();
+            copied.fetch_add(i + 1 - reported, std::memory_order_relaxed);
+            reported = i + 1;
+        }
+    }
+    ok = PQputCopyEnd(c, ok ? nullptr : "preload aborted") == 1 && ok;
+    while ((r = PQgetResult(c)) != nullptr) {
+        if (PQresultStatus(r) != PGRES_COMMAND_OK) ok = false;
+        PQclear(r);
+    }
+    if (!ok) {
+        log_error(std::string("Preload: COPY failed: ") + PQerrorMessage(c));
+        return false;
+    }
+
+    r = PQexec(c, "INSERT INTO kv_store (key, value) SELECT key, value FROM kv_preload "
+                  "ON CONFLICT (key) DO UPDATE SET value = EXCLUDED.value");
+    ok = r && PQresultStatus(r) == PGRES_COMMAND_OK;
+    if (ok) out.written = std::strtoull(PQcmdTuples(r), nullptr, 10);
+    else    log_error(std::string("Preload: upsert failed: ") + PQerrorMessage(c));
+    if (r) PQclear(r);
+    if (!ok) return false;
+
+    out.checked = hi - lo;
+    r = PQexec(c, "SELECT count(*) FROM kv_preload JOIN kv_store USING (key)");
+    ok = r && PQresultStatus(r) == PGRES_TUPLES_OK && PQntuples(r) == 1;
+    if (ok) out.verified = std::strtoull(PQgetvalue(r, 0, 0), nullptr, 10);
+    else    log_error(std::string("Preload: count failed: ") + PQerrorMessage(c));
+    if (r) PQclear(r);
+    return ok;
+}
+
+bool preload_pg(const LoadGenConfig& cfg, const ValueGenerator* values, PreloadOutcome& out) {
+    {
+        std::unique_ptr<PGconn, decltype(&PQfinish)> conn(PQconnectdb(cfg.pg_conninfo.c_str()), &PQfinish);
+        if (PQstatus(conn.get()) != CONNECTION_OK) {
+            log_error(std::string("Preload: PQconnectdb failed: ") + PQerrorMessage(conn.get()));
+            return false;
+        }
+        // Same schema as kv-server's ensure_table()
+        if (!exec_sql(conn.get(), "CREATE TABLE IF NOT EXISTS kv_store ("
+                                  "  key   TEXT PRIMARY KEY,"
+                                  "  value TEXT NOT NULL"
+                                  ")")) {
+            return false;
+        }
+    }
+
+    const int n = static_cast<int>(std::min<uint64_t>(static_cast<uint64_t>(cfg.preload_conns), cfg.keys));
+    std::vector<PreloadOutcome> parts(static_cast<std::size_t>(n));
+    std::vector<char> ok(static_cast<std::size_t>(n), 0);
+    std::atomic<uint64_t> copied{0};
+    std::atomic<int> running{n};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i) {
+        uint64_t lo = cfg.keys * static_cast<uint64_t>(i) / static_cast<uint64_t>(n);
+        uint64_t hi = cfg.keys * static_cast<uint64_t>(i + 1) / static_cast<uint64_t>(n);
+        threads.emplace_back([&, i, lo, hi]() {
+            auto k = static_cast<std::size_t>(i);
+            ok[k] = copy_slice(cfg, values, i, lo, hi, copied, parts[k]) ? 1 : 0;
+            running.fetch_sub(1);
+        });
+    }
+
+    auto next_log = LgClock::now() + kProgressEvery;
+    while (running.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (LgClock::now() >= next_log) {
+            next_log += kProgressEvery;
+            log_info("Preload: " + std::to_string(copied.load()) + "/" + std::to_string(cfg.keys) +
+                     " rows copied");
+        }
+    }
+    for (auto& t : threads) t.join();
+
+    bool all_ok = true;
+    for (int i = 0; i < n; ++i) {
+        const auto& p = parts[static_cast<std::size_t>(i)];
+        out.written  += p.written;
+        out.checked  += p.checked;
+        out.verified += p.verified;
+        out.bytes    += p.bytes;
+        all_ok = all_ok && ok[static_cast<std::size_t>(i)];
+    }
+    return all_ok;
+}
+
+} // namespace
+
+bool run_preload(const LoadGenConfig& cfg) {
+    if (cfg.keys == 0) {
+        log_error("--preload needs --keys > 0");
+        return false;
+    }
+    const bool via_pg = !cfg.pg_conninfo.empty();
+    log_info("Preloading " + std::to_string(cfg.keys) + " keys " +
+             (via_pg ? "with COPY over " : "with pipelined PUTs over ") +
+             std::to_string(cfg.preload_conns) + " connections");
+
+    std::unique_ptr<ValueGenerator> values;
+    if (!cfg.value_size.empty()) values = std::make_unique<ValueGenerator>(cfg.value_size, cfg.seed);
+
+    PreloadOutcome out;
+    auto t0 = LgClock::now();
+    bool ok = via_pg ? preload_pg(cfg, values.get(), out) : preload_http(cfg, values.get(), out);
+    double secs = std::chrono::duration<double>(LgClock::now() - t0).count();
+
+    double rate = secs > 0.0 ? static_cast<double>(out.written) / secs : 0.0;
+    double mbps = secs > 0.0 ? static_cast<double>(out.bytes) / (1024.0 * 1024.0) / secs : 0.0;
+    log_info("Preload: " + std::to_string(out.written) + " keys in " + std::to_string(secs) +
+             " s (" + std::to_string(rate) + " keys/s, " + std::to_string(mbps) + " MB/s payload)");
+
+    const std::string of = std::to_string(out.verified) + "/" + std::to_string(out.checked) +
+                           (out.checked < cfg.keys ? " sampled keys" : " keys");
+    if (!ok || out.written < cfg.keys || out.verified < out.checked) {
+        log_error("Preload incomplete: " + std::to_string(out.written) + "/" + std::to_string(cfg.keys) +
+                  " keys written, " + of + " found");
+        return false;
+    }
+    log_info("Preload verified: " + of + " present");
+    return true;
+}
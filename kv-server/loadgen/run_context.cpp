@@ -0,0 +1,661 @@
+#include "loadgen_engine.h"
+#include "load_profile.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Latency recorders per core; see Recorder in loadgen_engine.h
+constexpr std::size_t kRecordersPerCore = 4;
+
+// Keyspace fraction the hot set moves by on each --hotset-shift (1 - 1/phi)
+constexpr double kHotsetStep = 0.3819660112501051;
+
+// How often a blocking client idled by a clients profile checks whether it is needed
+constexpr auto kIdlePoll = std::chrono::milliseconds(10);
+
+struct YcsbPreset {
+    const char* workload;
+    OpMix       mix;
+    const char* dist;
+};
+
+// YCSB core workloads A-F (read, update, insert, delete, scan, rmw)
+const YcsbPreset kYcsbPresets[] = {
+    {"ycsb-a", {0.50, 0.50, 0.00, 0.0, 0.00, 0.00}, "zipf"},    // update heavy
+    {"ycsb-b", {0.95, 0.05, 0.00, 0.0, 0.00, 0.00}, "zipf"},    // read mostly
+    {"ycsb-c", {1.00, 0.00, 0.00, 0.0, 0.00, 0.00}, "zipf"},    // read only
+    {"ycsb-d", {0.95, 0.00, 0.05, 0.0, 0.00, 0.00}, "latest"},  // read latest
+    {"ycsb-e", {0.00, 0.00, 0.05, 0.0, 0.95, 0.00}, "zipf"},    // short ranges
+    {"ycsb-f", {0.50, 0.00, 0.00, 0.0, 0.00, 0.50}, "zipf"},    // read-modify-write
+};
+
+const YcsbPreset* find_ycsb_preset(const std::string& workload) {
+    for (const auto& p : kYcsbPresets) {
+        if (workload == p.workload) return &p;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+OpMix workload_mix(const LoadGenConfig& cfg) {
+    OpMix m;
+    if (const YcsbPreset* p = find_ycsb_preset(cfg.workload)) return p->mix;
+    if (cfg.workload == "get-popular" || cfg.workload == "get-all") return m;
+    if (cfg.workload == "put-all") {
+        m.read   = 0.0;
+        m.update = 1.0;
+    } else if (cfg.workload == "mixed") {
+        if (cfg.put_ratio < 0.0 || cfg.delete_ratio < 0.0 || cfg.put_ratio + cfg.delete_ratio > 1.0) {
+            throw std::runtime_error("--put-ratio and --delete-ratio must be >= 0 and sum to <= 1");
+        }
+        m.read   = 1.0 - cfg.put_ratio - cfg.delete_ratio;
+        m.update = cfg.put_ratio;
+        m.del    = cfg.delete_ratio;
+    } else {
+        throw std::runtime_error("Unknown --workload: " + cfg.workload);
+    }
+    return m;
+}
+
+const char* op_kind_name(OpKind kind) {
+    switch (kind) {
+        case OpKind::READ:   return "read";
+        case OpKind::UPDATE: return "update";
+        case OpKind::INSERT: return "insert";
+        case OpKind::DELETE: return "delete";
+        case OpKind::SCAN:   return "scan";
+        case OpKind::RMW:    return "rmw";
+    }
+    return "?";
+}
+
+StatusClass status_class(int status) {
+    if (status <= 0) return StatusClass::TRANSPORT;
+    if (status >= 200 && status < 300) return StatusClass::OK;
+    if (status == 404) return StatusClass::NOT_FOUND;
+    if (status >= 500) return StatusClass::SERVER_ERROR;
+    return StatusClass::OTHER;
+}
+
+const char* status_class_name(StatusClass sc) {
+    switch (sc) {
+        case StatusClass::OK:           return "2xx";
+        case StatusClass::NOT_FOUND:    return "404";
+        case StatusClass::OTHER:        return "other";
+        case StatusClass::SERVER_ERROR: return "5xx";
+        case StatusClass::TRANSPORT:    return "error";
+    }
+    return "?";
+}
+
+const char* read_source_name(ReadSource src) {
+    switch (src) {
+        case ReadSource::CACHE:   return "cache";
+        case ReadSource::DB:      return "db";
+        case ReadSource::UNKNOWN: break;
+    }
+    return "unknown";
+}
+
+const char* latency_part_name(LatencyPart part) {
+    switch (part) {
+        case LatencyPart::NETWORK:   return "network";
+        case LatencyPart::POOL_WAIT: return "pool_wait";
+        case LatencyPart::SERVICE:   return "service";
+    }
+    return "?";
+}
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// "dur=<ms>" among a metric's ";"-separated parameters, in us; -1 if absent
+int64_t metric_dur_us(std::string_view params) {
+    while (!params.empty()) {
+        std::size_t semi = params.find(';');
+        std::string_view p = trim(params.substr(0, semi));
+        params = semi == std::string_view::npos ? std::string_view() : params.substr(semi + 1);
+        if (p.compare(0, 4, "dur=") != 0) continue;
+        std::string num(p.substr(4));
+        char* end = nullptr;
+        double ms = std::strtod(num.c_str(), &end);
+        if (end == num.c_str() || ms < 0.0) return -1;
+        return static_cast<int64_t>(ms * 1000.0 + 0.5);
+    }
+    return -1;
+}
+
+} // namespace
+
+bool parse_server_timing(std::string_view v, ServerTiming& out) {
+    out = ServerTiming{};
+    bool have_total = false;
+    while (!v.empty()) {
+        std::size_t comma = v.find(',');
+        std::string_view metric = trim(v.substr(0, comma));
+        v = comma == std::string_view::npos ? std::string_view() : v.substr(comma + 1);
+
+        std::size_t semi = metric.find(';');
+        if (semi == std::string_view::npos) continue;
+        std::string_view name = trim(metric.substr(0, semi));
+        int64_t us = metric_dur_us(metric.substr(semi + 1));
+        if (us < 0) continue;
+        if (name == "pool_wait")  out.pool_wait_us = us;
+        else if (name == "cache") out.cache_us     = us;
+        else if (name == "db")    out.db_us        = us;
+        else if (name == "total") { out.total_us = us; have_total = true; }
+    }
+    return have_total;
+}
+
+std::string make_key(const LoadGenConfig& cfg, uint64_t idx) {
+    if (cfg.workload.compare(0, 5, "ycsb-") != 0) return "key" + std::to_string(idx);
+    return "user" + std::to_string(cfg.insert_order == "ordered" ? idx : fnv1a64(idx));
+}
+
+// ---------- Workload setup ----------
+
+WorkloadGenerators make_workload_generators(const LoadGenConfig& cfg) {
+    if (cfg.keys == 0) {
+        throw std::runtime_error("--keys must be > 0");
+    }
+
+    WorkloadGenerators g;
+    g.mix = workload_mix(cfg);
+
+    // One shared key distribution (immutable; each client brings its own RNG).
+    // Without --dist, get-popular keeps its hot set (5 keys, 90% of requests),
+    // the YCSB presets use YCSB's request distribution and every other
+    // workload is uniform over the keyspace.
+    KeyDistConfig kd = cfg.keydist;
+    if (kd.name.empty()) {
+        const YcsbPreset* p = find_ycsb_preset(cfg.workload);
+        kd.name = p ? p->dist : (cfg.workload == "get-popular") ? "hotspot" : "uniform";
+    }
+    g.keydist = make_key_distribution(kd, cfg.keys);
+    g.follow_inserts = kd.name == "latest";
+    log_info("Key distribution: " + kd.name);
+
+    if (cfg.hotset_shift_s > 0.0) {
+        if (g.follow_inserts) {
+            throw std::runtime_error("--hotset-shift does not apply to the latest distribution");
+        }
+        // Golden-ratio steps: successive regions land far apart and don't
+        // come back around for a long time
+        g.hotset_stride = std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(cfg.keys) * kHotsetStep));
+        log_info("Hot set shifts every " + std::to_string(cfg.hotset_shift_s) + " s" +
+                 (cfg.hotset_ramp_s > 0.0 ? " over " + std::to_string(cfg.hotset_ramp_s) + " s" : " (abrupt)"));
+    }
+
+    // Value pool is generated once, before the clock starts
+    if (!cfg.value_size.empty()) {
+        g.values = std::make_unique<ValueGenerator>(cfg.value_size, cfg.seed);
+        log_info("Value sizes: " + cfg.value_size +
+                 " (mean ~" + std::to_string(static_cast<long long>(g.values->mean_size())) +
+                 " B, max " + std::to_string(g.values->max_size()) + " B)");
+    }
+    return g;
+}
+
+void run_engine(RunContext& ctx) {
+    if (ctx.cfg.direct_db) {
+        run_direct_db_engine(ctx);
+    } else if (ctx.cfg.engine == "epoll") {
+        run_epoll_engine(ctx);
+    } else {
+        run_threads_engine(ctx);
+    }
+}
+
+// ---------- RunResult ----------
+
+void RunResult::merge(const RunResult& o) {
+    open_loop  = open_loop || o.open_loop;
+    ok        += o.ok;
+    fail      += o.fail;
+    late      += o.late;
+    missed    += o.missed;
+    max_lag_us = std::max(max_lag_us, o.max_lag_us);
+    tx_bytes  += o.tx_bytes;
+    rx_bytes  += o.rx_bytes;
+    connects     += o.connects;
+    connect_fail += o.connect_fail;
+    latency.merge(o.latency);
+    connect_latency.merge(o.connect_latency);
+    for (std::size_t k = 0; k < kOpKinds; ++k) {
+        ops[k].ok   += o.ops[k].ok;
+        ops[k].fail += o.ops[k].fail;
+        ops[k].latency.merge(o.ops[k].latency);
+    }
+    for (std::size_t s = 0; s < kStatusClasses; ++s) by_status[s].merge(o.by_status[s]);
+    for (std::size_t s = 0; s < kReadSources; ++s) by_source[s].merge(o.by_source[s]);
+    for (std::size_t p = 0; p < kLatencyParts; ++p) by_part[p].merge(o.by_part[p]);
+    if (phases.size() < o.phases.size()) phases.resize(o.phases.size());
+    for (std::size_t p = 0; p < o.phases.size(); ++p) {
+        if (phases[p].name.empty()) {
+            phases[p].name       = o.phases[p].name;
+            phases[p].shape      = o.phases[p].shape;
+            phases[p].target     = o.phases[p].target;
+            phases[p].duration_s = o.phases[p].duration_s;
+        }
+        phases[p].ok   += o.phases[p].ok;
+        phases[p].fail += o.phases[p].fail;
+        phases[p].latency.merge(o.phases[p].latency);
+    }
+}
+
+// ---------- RunStats ----------
+
+void RunStats::init_recorders(int clients) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t n = std::max<std::size_t>(
+        1, std::min<std::size_t>(static_cast<std::size_t>(std::max(clients, 1)),
+                                 kRecordersPerCore * cores));
+    recorders.clear();
+    recorders.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        recorders.emplace_back(std::make_unique<Recorder>());
+    }
+}
+
+void RunStats::drain_interval(HdrHistogram& into, uint64_t& iv_ok, uint64_t& iv_fail) {
+    into.reset();
+    iv_ok = iv_fail = 0;
+    for (auto& rp : recorders) {
+        std::lock_guard<std::mutex> lk(rp->mu);
+        into.merge(rp->interval);
+        rp->interval.reset();
+        iv_ok   += rp->interval_ok;
+        iv_fail += rp->interval_fail;
+        rp->interval_ok = rp->interval_fail = 0;
+    }
+}
+
+namespace {
+
+void record_into(std::unique_ptr<HdrHistogram>& h, int64_t us) {
+    if (!h) h = std::make_unique<HdrHistogram>();
+    h->record(us);
+}
+
+} // namespace
+
+void RunStats::record(Recorder& rec, const Outcome& o, int64_t us, bool in_window) {
+    const auto k = static_cast<std::size_t>(o.kind);
+    const bool success = o.success;
+    if (in_window) {
+        if (success) {
+            ok.fetch_add(1, std::memory_order_relaxed);
+            kind_ok[k].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            fail.fetch_add(1, std::memory_order_relaxed);
+            kind_fail[k].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (in_window || track_intervals) {
+        std::lock_guard<std::mutex> lk(rec.mu);
+        if (in_window) {
+            rec.hist.record(us);
+            record_into(rec.by_kind[k], us);
+            record_into(rec.by_status[static_cast<std::size_t>(status_class(o.status))], us);
+            if (success && o.source != ReadSource::UNKNOWN) {
+                record_into(rec.by_source[static_cast<std::size_t>(o.source) - 1], us);
+            }
+            if (o.phase >= 0) {
+                auto p = static_cast<std::size_t>(o.phase);
+                if (p >= rec.by_phase.size()) rec.by_phase.resize(p + 1);
+                if (!rec.by_phase[p]) rec.by_phase[p] = std::make_unique<Recorder::PhaseStats>();
+                rec.by_phase[p]->hist.record(us);
+                if (success) ++rec.by_phase[p]->ok;
+                else         ++rec.by_phase[p]->fail;
+            }
+            if (o.timed) {
+                // Timer granularity can make the server's total exceed ours
+                int64_t total = std::min(o.timing.total_us, us);
+                int64_t wait  = std::min(o.timing.pool_wait_us, total);
+                record_into(rec.by_part[static_cast<std::size_t>(LatencyPart::NETWORK)], us - total);
+                record_into(rec.by_part[static_cast<std::size_t>(LatencyPart::POOL_WAIT)], wait);
+                record_into(rec.by_part[static_cast<std::size_t>(LatencyPart::SERVICE)], total - wait);
+            }
+        }
+        if (track_intervals) {
+            rec.interval.record(us);
+            if (success) ++rec.interval_ok;
+            else         ++rec.interval_fail;
+        }
+    }
+}
+
+void RunStats::note_lag(int64_t lag_us) {
+    if (lag_us > kLateSlackUs) late.fetch_add(1, std::memory_order_relaxed);
+    int64_t prev = max_lag_us.load(std::memory_order_relaxed);
+    while (lag_us > prev && !max_lag_us.compare_exchange_weak(prev, lag_us)) {}
+}
+
+void RunStats::record_connect(Recorder& rec, bool ok, int64_t us, bool in_window) {
+    if (!in_window) return;
+    if (!ok) {
+        connect_fail.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    connects.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lk(rec.mu);
+    record_into(rec.connect, us);
+}
+
+// ---------- AckedCounter ----------
+
+void AckedCounter::acknowledge(uint64_t n) {
+    std::lock_guard<std::mutex> lk(mu_);
+    uint64_t limit = limit_.load(std::memory_order_relaxed);
+    if (n != limit) {
+        done_.insert(n);
+        return;
+    }
+    ++limit;
+    while (!done_.empty() && done_.erase(limit)) ++limit;
+    limit_.store(limit, std::memory_order_release);
+}
+
+// ---------- RequestSource ----------
+
+RequestSource::RequestSource(RunContext& ctx, std::mt19937_64& rng, int client_id)
+    : ctx_(ctx), rng_(rng), legacy_value_("v" + std::to_string(client_id))
+{
+}
+
+// ---------- RunContext ----------
+
+uint64_t RunContext::hotset_region(LgClock::time_point t) const {
+    const auto from = warmup_end();
+    if (t <= from) return 0;
+    double s = std::chrono::duration<double>(t - from).count();
+    return static_cast<uint64_t>(s / cfg.hotset_shift_s);
+}
+
+uint64_t RunContext::shift_hotset(uint64_t index, std::mt19937_64& rng) const {
+    auto now = LgClock::now();
+    uint64_t region = hotset_region(now);
+    if (region > 0 && cfg.hotset_ramp_s > 0.0) {
+        // Share of requests on the new region grows linearly over the ramp
+        double into = std::chrono::duration<double>(now - warmup_end()).count() -
+                      static_cast<double>(region) * cfg.hotset_shift_s;
+        if (into < cfg.hotset_ramp_s &&
+            std::uniform_real_distribution<double>(0.0, cfg.hotset_ramp_s)(rng) >= into) {
+            --region;
+        }
+    }
+    // region is at most measure_s / hotset_shift_s, so this can't overflow
+    return (index + region * hotset_stride) % cfg.keys;
+}
+
+double RunContext::profile_time(LgClock::time_point t) const {
+    const auto from = warmup_end();
+    return t <= from ? 0.0 : std::chrono::duration<double>(t - from).count();
+}
+
+int RunContext::phase_at(LgClock::time_point t) const {
+    return profile ? static_cast<int>(profile->phase_at(profile_time(t))) : -1;
+}
+
+const OpMix& RunContext::mix_at(LgClock::time_point t) const {
+    return profile ? profile->phases()[profile->phase_at(profile_time(t))].mix : mix;
+}
+
+bool RunContext::client_active(int client_id, LgClock::time_point t) const {
+    if (!profile || profile->by_rate()) return true;
+    return client_id < static_cast<int>(std::lround(profile->target_at(profile_time(t))));
+}
+
+// Only acknowledged inserts count: an insert still in flight, or (with
+// --insert-part) another worker's share of the insert keyspace, may not
+// exist yet and would be read as a 404
+uint64_t RequestSource::key_count() const {
+    return ctx_.cfg.keys + ctx_.acked_inserts.limit();
+}
+
+uint64_t RequestSource::existing_key(uint64_t rank) const {
+    const LoadGenConfig& cfg = ctx_.cfg;
+    if (rank < cfg.keys) return rank;
+    return cfg.keys + (rank - cfg.keys) * cfg.insert_stride + cfg.insert_offset;
+}
+
+uint64_t RequestSource::existing_rank(uint64_t index) const {
+    const LoadGenConfig& cfg = ctx_.cfg;
+    if (index < cfg.keys) return index;
+    return cfg.keys + (index - cfg.keys - cfg.insert_offset) / cfg.insert_stride;
+}
+
+bool RequestSource::next(RequestSpec& out) {
+    const LoadGenConfig& cfg = ctx_.cfg;
+    const OpMix& m = ctx_.profile ? ctx_.mix_at(LgClock::now()) : ctx_.mix;
+
+    if (ctx_.fill_keys > 0) {
+        uint64_t i = 0;
+        bool retry = false;
+        if (ctx_.fill_retry_pending.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lk(ctx_.fill_mu);
+            if (!ctx_.fill_retry.empty()) {
+                i = ctx_.fill_retry.back();
+                ctx_.fill_retry.pop_back();
+                retry = true;
+            }
+            ctx_.fill_retry_pending.store(!ctx_.fill_retry.empty(), std::memory_order_release);
+        }
+        if (!retry) {
+            i = ctx_.inserts.fetch_add(1, std::memory_order_relaxed);
+            if (i >= ctx_.fill_keys) return false;
+        }
+        out.op        = Op::PUT;
+        out.kind      = OpKind::UPDATE;
+        out.index     = i;
+        out.remaining = 0;
+        out.key       = make_key(cfg, i);
+        out.value     = ctx_.values ? ctx_.values->next(rng_) : std::string_view(legacy_value_);
+        return true;
+    }
+
+    out.kind = OpKind::READ;
+    if (m.update == 1.0) {
+        out.kind = OpKind::UPDATE;
+    } else if (m.read < 1.0) {
+        std::uniform_real_distribution<double> u01(0.0, 1.0);
+        double r = u01(rng_);
+        if      ((r -= m.update) < 0.0) out.kind = OpKind::UPDATE;
+        else if ((r -= m.del)    < 0.0) out.kind = OpKind::DELETE;
+        else if ((r -= m.insert) < 0.0) out.kind = OpKind::INSERT;
+        else if ((r -= m.scan)   < 0.0) out.kind = OpKind::SCAN;
+        else if ((r -= m.rmw)    < 0.0) out.kind = OpKind::RMW;
+    }
+
+    out.remaining = 0;
+    if (out.kind == OpKind::INSERT) {
+        uint64_t n = ctx_.inserts.fetch_add(1, std::memory_order_relaxed);
+        out.index = cfg.keys + n * cfg.insert_stride + cfg.insert_offset;
+    } else {
+        out.index = ctx_.keydist->next(rng_);
+        if (ctx_.hotset_stride) out.index = ctx_.shift_hotset(out.index, rng_);
+        // "latest" favours the end of the loaded keyspace; follow it as inserts extend it
+        if (ctx_.follow_inserts) out.index = existing_key(out.index + ctx_.acked_inserts.limit());
+    }
+
+    switch (out.kind) {
+        case OpKind::UPDATE:
+        case OpKind::INSERT: out.op = Op::PUT; break;
+        case OpKind::DELETE: out.op = Op::DEL; break;
+        case OpKind::SCAN:
+            out.op = Op::GET;
+            out.remaining = std::uniform_int_distribution<int>(1, cfg.scan_max)(rng_) - 1;
+            break;
+        case OpKind::RMW:
+            out.op = Op::GET;
+            out.remaining = 1;
+            break;
+        default: out.op = Op::GET; break;
+    }
+
+    out.key = make_key(cfg, out.index);
+    if (out.op == Op::PUT) {
+        out.value = ctx_.values ? ctx_.values->next(rng_) : std::string_view(legacy_value_);
+    }
+    return true;
+}
+
+void RequestSource::follow(RequestSpec& req) {
+    --req.remaining;
+    if (req.kind == OpKind::RMW) {
+        req.op    = Op::PUT;
+        req.value = ctx_.values ? ctx_.values->next(rng_) : std::string_view(legacy_value_);
+    } else {
+        // Scan: the next key in insert order, wrapping within the existing keys
+        req.index = existing_key((existing_rank(req.index) + 1) % key_count());
+    }
+    req.key = make_key(ctx_.cfg, req.index);
+}
+
+// ---------- ArrivalSchedule ----------
+
+// Each client owns 1/clients of the target rate. Uniform arrivals are
+// staggered so clients don't fire in lockstep; Poisson arrivals start after a
+// random first gap.
+ArrivalSchedule::ArrivalSchedule(const RunContext& ctx, std::mt19937_64& rng, int client_id)
+    : ctx_(ctx),
+      rng_(rng),
+      client_rate_(ctx.cfg.clients > 0
+                       ? (ctx.profile ? ctx.profile->peak() : ctx.cfg.rate_rps) / ctx.cfg.clients
+                       : 0.0),
+      gapdist_(client_rate_ > 0.0 ? client_rate_ : 1.0),
+      intended_(ctx.start)
+{
+    if (ctx_.cfg.arrival == "uniform") {
+        intended_ += std::chrono::duration_cast<LgClock::duration>(
+            std::chrono::duration<double>(static_cast<double>(client_id) / (client_rate_ * ctx_.cfg.clients)));
+    } else {
+        intended_ += gap();
+    }
+    thin();
+}
+
+void ArrivalSchedule::advance() {
+    intended_ += gap();
+    thin();
+}
+
+// Under a rate profile, candidate sends come at the peak rate and each is
+// kept with probability target / peak, which turns the Poisson process into
+// one following the profile. Uniform arrivals keep a running share instead,
+// so the spacing stays even.
+void ArrivalSchedule::thin() {
+    if (!ctx_.profile) return;
+    const bool uniform = ctx_.cfg.arrival == "uniform";
+    while (intended_ < ctx_.measure_end()) {
+        double keep = ctx_.profile->target_at(ctx_.profile_time(intended_)) / ctx_.profile->peak();
+        if (uniform) {
+            kept_ += keep;
+            if (kept_ >= 1.0) {
+                kept_ -= 1.0;
+                return;
+            }
+        } else if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < keep) {
+            return;
+        }
+        intended_ += gap();
+    }
+}
+
+LgClock::duration ArrivalSchedule::gap() {
+    double s = (ctx_.cfg.arrival == "uniform") ? 1.0 / client_rate_ : gapdist_(rng_);
+    return std::chrono::duration_cast<LgClock::duration>(std::chrono::duration<double>(s));
+}
+
+uint64_t ArrivalSchedule::drain_missed() {
+    // A run stopped early has no meaningful end of window to count against
+    if (ctx_.stop.load(std::memory_order_relaxed)) return 0;
+    if (intended_ < ctx_.warmup_end()) intended_ = ctx_.warmup_end();
+    uint64_t n = 0;
+    while (intended_ < ctx_.measure_end()) {
+        ++n;
+        advance();
+    }
+    return n;
+}
+
+// ---------- Blocking client loop ----------
+
+void run_blocking_client(RunContext& ctx, int id, const SendRequestFn& send) {
+    const LoadGenConfig& cfg = ctx.cfg;
+    RunStats& stats = ctx.stats;
+    Recorder& rec = stats.recorder_for(static_cast<std::size_t>(id));
+
+    std::mt19937_64 rng(cfg.seed + static_cast<std::uint64_t>(id));
+    RequestSource source(ctx, rng, id);
+    RequestSpec req;
+
+    std::unique_ptr<ArrivalSchedule> sched;
+    if (ctx.open_loop) sched = std::make_unique<ArrivalSchedule>(ctx, rng, id);
+
+    while (!ctx.finished(LgClock::now())) {
+        if (sched) {
+            auto intended = sched->intended();
+            if (intended >= ctx.measure_end()) break;
+            auto now = LgClock::now();
+            if (now < intended) {
+                std::this_thread::sleep_until(intended);
+                if (ctx.stop.load(std::memory_order_relaxed)) break;
+            } else if (intended > ctx.warmup_end()) {
+                stats.note_lag(std::chrono::duration_cast<std::chrono::microseconds>(now - intended).count());
+            }
+        } else if (!ctx.client_active(id, LgClock::now())) {
+            std::this_thread::sleep_for(kIdlePoll);
+            continue;
+        }
+
+        if (!source.next(req)) break;
+
+        // Closed-loop latency starts at the actual send; open-loop latency
+        // starts at the intended send so server stalls aren't hidden
+        // (coordinated omission).
+        auto t0 = sched ? sched->intended() : LgClock::now();
+
+        // Multi-request operations (scan, RMW) stop at the first failure
+        uint64_t tx = 0, rx = 0;
+        Outcome out;
+        out.kind  = req.kind;
+        out.timed = true;
+        out.success = send(req, tx, rx, out);
+        while (out.success && req.remaining > 0) {
+            source.follow(req);
+            out.success = send(req, tx, rx, out);
+        }
+        // Cache / DB split for plain reads only, not scans or RMW
+        if (req.kind != OpKind::READ) out.source = ReadSource::UNKNOWN;
+
+        auto t1 = LgClock::now();
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        bool in_window = ctx.in_window(t1);
+        out.phase = ctx.phase_at(t1);
+        stats.record(rec, out, us, in_window);
+        ctx.complete(req.kind, req.index, out.success);
+        stats.count_bytes(tx, rx, in_window);
+
+        if (sched) sched->advance();
+    }
+
+    // Whatever is left of this client's schedule inside the window was
+    // never sent because the client was stuck waiting on the server.
+    if (sched) stats.missed.fetch_add(sched->drain_missed(), std::memory_order_relaxed);
+}
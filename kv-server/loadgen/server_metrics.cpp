@@ -0,0 +1,80 @@
+#include "server_metrics.h"
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+#include <exception>
+
+using json = nlohmann::json;
+
+namespace {
+
+// The end-of-window scrape may queue behind the last requests of a saturated run
+constexpr int kWindowTimeoutS = 5;
+
+uint64_t counter_delta(uint64_t before, uint64_t after) {
+    return after >= before ? after - before : after;
+}
+
+} // namespace
+
+double ServerMetricsDelta::hit_ratio() const {
+    uint64_t lookups = cache_hits + cache_misses;
+    return lookups > 0 ? static_cast<double>(cache_hits) / static_cast<double>(lookups) : 0.0;
+}
+
+ServerMetricsDelta metrics_delta(const ServerMetrics& a, const ServerMetrics& b) {
+    ServerMetricsDelta d;
+    d.requests     = counter_delta(a.requests_total, b.requests_total);
+    d.errors       = counter_delta(a.errors_total,   b.errors_total);
+    d.cache_hits   = counter_delta(a.cache_hits,     b.cache_hits);
+    d.cache_misses = counter_delta(a.cache_misses,   b.cache_misses);
+    return d;
+}
+
+// ---------- MetricsScraper ----------
+
+MetricsScraper::MetricsScraper(const std::string& host, int port, int timeout_s)
+    : cli_(std::make_unique<httplib::Client>(host, port))
+{
+    cli_->set_keep_alive(true);
+    cli_->set_connection_timeout(timeout_s);
+    cli_->set_read_timeout(timeout_s);
+}
+
+MetricsScraper::~MetricsScraper() = default;
+
+bool MetricsScraper::scrape(ServerMetrics& m) {
+    auto res = cli_->Get("/metrics");
+    if (!res || res->status != 200) return false;
+    try {
+        json j = json::parse(res->body);
+        m.requests_total = j.value("requests_total", uint64_t{0});
+        m.errors_total   = j.value("errors_total",   uint64_t{0});
+        m.cache_hits     = j.value("cache_hits",     uint64_t{0});
+        m.cache_misses   = j.value("cache_misses",   uint64_t{0});
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+// ---------- MetricsWindow ----------
+
+void MetricsWindow::start(std::chrono::steady_clock::time_point from,
+                          std::chrono::steady_clock::time_point to) {
+    thread_ = std::thread([this, from, to]() {
+        MetricsScraper scraper(host_, port_, kWindowTimeoutS);
+        ServerMetrics first, last;
+        std::this_thread::sleep_until(from);
+        if (!scraper.scrape(first)) return;
+        std::this_thread::sleep_until(to);
+        if (!scraper.scrape(last)) return;
+        delta_ = metrics_delta(first, last);
+        ok_ = true;
+    });
+}
+
+void MetricsWindow::join() {
+    if (thread_.joinable()) thread_.join();
+}
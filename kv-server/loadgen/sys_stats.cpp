@@ -0,0 +1,368 @@
+#include "sys_stats.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Counter delta clamped at zero (threads/children exiting between samples)
+unsigned long long delta(unsigned long long a, unsigned long long b) {
+    return b >= a ? b - a : 0;
+}
+
+double to_MBps(unsigned long long bytes, double seconds) {
+    return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+std::vector<std::string> list_dir(const std::string& path) {
+    std::vector<std::string> out;
+    DIR* d = opendir(path.c_str());
+    if (!d) return out;
+    while (dirent* e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        out.emplace_back(e->d_name);
+    }
+    closedir(d);
+    return out;
+}
+
+bool is_number(const std::string& s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// /proc/<pid>/stat: comm may contain spaces and parens, so parse after the last ')'
+bool read_proc_stat(int pid, std::string* comm, int* ppid,
+                    unsigned long long* utime, unsigned long long* stime) {
+    std::ifstream f("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!f || !std::getline(f, line)) return false;
+    std::size_t open = line.find('(');
+    std::size_t close = line.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) return false;
+    if (comm) *comm = line.substr(open + 1, close - open - 1);
+
+    std::istringstream iss(line.substr(close + 2));
+    std::string state;
+    long long parent = 0;
+    iss >> state >> parent;
+    // fields 5..13 (pgrp .. cmajflt) precede utime/stime
+    std::string skip;
+    for (int i = 0; i < 9; ++i) iss >> skip;
+    unsigned long long ut = 0, st = 0;
+    if (!(iss >> ut >> st)) return false;
+    if (ppid) *ppid = static_cast<int>(parent);
+    if (utime) *utime = ut;
+    if (stime) *stime = st;
+    return true;
+}
+
+// Context switches are per thread in /proc; sum over /proc/<pid>/task/*
+void read_ctx_switches(int pid, unsigned long long& vctx, unsigned long long& nvctx) {
+    vctx = nvctx = 0;
+    const std::string base = "/proc/" + std::to_string(pid) + "/task/";
+    for (const auto& tid : list_dir(base)) {
+        std::ifstream f(base + tid + "/status");
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.rfind("voluntary_ctxt_switches:", 0) == 0) {
+                vctx += std::stoull(line.substr(line.find(':') + 1));
+            } else if (line.rfind("nonvoluntary_ctxt_switches:", 0) == 0) {
+                nvctx += std::stoull(line.substr(line.find(':') + 1));
+            }
+        }
+    }
+}
+
+// read_bytes/write_bytes are storage I/O; needs the same uid or root
+bool read_proc_io(int pid, unsigned long long& rd, unsigned long long& wr) {
+    std::ifstream f("/proc/" + std::to_string(pid) + "/io");
+    if (!f) return false;
+    std::string key;
+    unsigned long long v = 0;
+    bool have_rd = false, have_wr = false;
+    while (f >> key >> v) {
+        if (key == "read_bytes:")       { rd = v; have_rd = true; }
+        else if (key == "write_bytes:") { wr = v; have_wr = true; }
+    }
+    return have_rd && have_wr;
+}
+
+bool read_proc(int pid, int root, ProcCounters& p) {
+    p.pid = pid;
+    p.root = root;
+    if (!read_proc_stat(pid, nullptr, nullptr, &p.utime, &p.stime)) return false;
+    read_ctx_switches(pid, p.vctx, p.nvctx);
+    p.have_io = read_proc_io(pid, p.read_bytes, p.write_bytes);
+    return true;
+}
+
+} // namespace
+
+ProcRate SysRates::total_proc() const {
+    ProcRate t;
+    t.have_io = !procs.empty();
+    for (const auto& p : procs) {
+        t.nprocs      += p.nprocs;
+        t.cpu_pct     += p.cpu_pct;
+        t.vctx_per_s  += p.vctx_per_s;
+        t.nvctx_per_s += p.nvctx_per_s;
+        t.read_MBps   += p.read_MBps;
+        t.write_MBps  += p.write_MBps;
+        t.have_io = t.have_io && p.have_io;
+    }
+    return t;
+}
+
+std::vector<int> parse_id_list(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty()) continue;
+        std::size_t dash = part.find('-');
+        try {
+            if (dash == std::string::npos) {
+                out.push_back(std::stoi(part));
+            } else {
+                int lo = std::stoi(part.substr(0, dash));
+                int hi = std::stoi(part.substr(dash + 1));
+                if (lo > hi) std::swap(lo, hi);
+                for (int i = lo; i <= hi; ++i) out.push_back(i);
+            }
+        } catch (const std::logic_error&) {
+            throw std::invalid_argument("bad id list: " + s);
+        }
+    }
+    if (out.empty()) throw std::invalid_argument("empty id list: " + s);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+SysSampler::SysSampler(std::vector<int> cores, std::vector<int> pids)
+    : cores_(std::move(cores)), pids_(std::move(pids))
+{
+    std::sort(cores_.begin(), cores_.end());
+    std::sort(pids_.begin(), pids_.end());
+    pids_.erase(std::unique(pids_.begin(), pids_.end()), pids_.end());
+
+    long tck = sysconf(_SC_CLK_TCK);
+    if (tck > 0) ticks_per_s_ = static_cast<double>(tck);
+
+    for (int pid : pids_) {
+        std::string comm;
+        if (!read_proc_stat(pid, &comm, nullptr, nullptr, nullptr)) comm = "?";
+        comms_.push_back(comm);
+    }
+
+    // /sys/block lists whole devices only (partitions live underneath them);
+    // devices with slaves (device-mapper, md) are stacked on other devices.
+    for (const auto& name : list_dir("/sys/block")) {
+        if (name.rfind("loop", 0) == 0 || name.rfind("ram", 0) == 0) continue;
+        std::string dev = name;
+        std::replace(dev.begin(), dev.end(), '!', '/'); // e.g. cciss!c0d0
+        whole_.push_back(dev);
+        if (!list_dir("/sys/block/" + name + "/slaves").empty()) stacked_.push_back(dev);
+    }
+}
+
+bool SysSampler::sample(SysSample& s) const {
+    s = SysSample{};
+    s.t_s = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // CPU: the aggregate "cpu" line, or the sum of the selected "cpuN" lines
+    {
+        std::ifstream f("/proc/stat");
+        std::string line;
+        std::size_t found = 0;
+        while (std::getline(f, line)) {
+            std::istringstream iss(line);
+            std::string label;
+            iss >> label;
+            if (label == "ctxt") {
+                iss >> s.ctxt;
+                continue;
+            }
+            if (label.rfind("cpu", 0) != 0) continue;
+
+            bool want;
+            if (cores_.empty()) {
+                want = (label == "cpu");
+            } else {
+                want = label.size() > 3 && is_number(label.substr(3)) &&
+                       std::binary_search(cores_.begin(), cores_.end(), std::stoi(label.substr(3)));
+            }
+            if (!want) continue;
+
+            CpuTimes c;
+            if (iss >> c.user >> c.nice >> c.system >> c.idle >> c.iowait
+                    >> c.irq >> c.softirq >> c.steal) {
+                s.cpu.user += c.user;       s.cpu.nice += c.nice;
+                s.cpu.system += c.system;   s.cpu.idle += c.idle;
+                s.cpu.iowait += c.iowait;   s.cpu.irq += c.irq;
+                s.cpu.softirq += c.softirq; s.cpu.steal += c.steal;
+                ++found;
+            }
+        }
+        s.have_cpu = found > 0 && (cores_.empty() || found == cores_.size());
+    }
+
+    // Disk: whole devices only, so partitions aren't counted twice
+    {
+        std::ifstream f("/proc/diskstats");
+        s.have_disk = f.is_open();
+        std::string line;
+        while (std::getline(f, line)) {
+            std::istringstream iss(line);
+            unsigned long long major = 0, minor = 0;
+            DiskCounters d;
+            if (!(iss >> major >> minor >> d.name)) continue;
+            if (whole_.empty()) {
+                // no sysfs: fall back to skipping loop/ram only
+                if (d.name.rfind("loop", 0) == 0 || d.name.rfind("ram", 0) == 0) continue;
+            } else if (std::find(whole_.begin(), whole_.end(), d.name) == whole_.end()) {
+                continue;
+            }
+
+            unsigned long long rd_ios = 0, rd_merges = 0, rd_ticks = 0;
+            unsigned long long wr_ios = 0, wr_merges = 0;
+            if (!(iss >> rd_ios >> rd_merges >> d.read_sectors >> rd_ticks
+                      >> wr_ios >> wr_merges >> d.write_sectors)) {
+                continue;
+            }
+            d.stacked = std::find(stacked_.begin(), stacked_.end(), d.name) != stacked_.end();
+            s.disks.push_back(std::move(d));
+        }
+    }
+
+    // Server processes plus their direct children (one /proc scan per sample)
+    if (!pids_.empty()) {
+        for (int pid : pids_) {
+            ProcCounters p;
+            if (read_proc(pid, pid, p)) s.procs.push_back(p);
+        }
+        for (const auto& entry : list_dir("/proc")) {
+            if (!is_number(entry)) continue;
+            int pid = std::stoi(entry);
+            int ppid = 0;
+            if (!read_proc_stat(pid, nullptr, &ppid, nullptr, nullptr)) continue;
+            if (!std::binary_search(pids_.begin(), pids_.end(), ppid)) continue;
+            if (std::binary_search(pids_.begin(), pids_.end(), pid)) continue;
+            ProcCounters p;
+            if (read_proc(pid, ppid, p)) s.procs.push_back(p);
+        }
+    }
+
+    return s.have_cpu || s.have_disk || !s.procs.empty();
+}
+
+SysRates SysSampler::rates(const SysSample& a, const SysSample& b) const {
+    SysRates r;
+    double secs = b.t_s - a.t_s;
+    if (secs <= 0.0) return r;
+
+    if (a.have_cpu && b.have_cpu) {
+        double total = static_cast<double>(delta(a.cpu.total(), b.cpu.total()));
+        double idle  = static_cast<double>(delta(a.cpu.idle_all(), b.cpu.idle_all()));
+        if (total > 0.0) r.cpu_util = 100.0 * (1.0 - idle / total);
+    }
+    r.ctxt_per_s = static_cast<double>(delta(a.ctxt, b.ctxt)) / secs;
+
+    constexpr unsigned long long sector_size = 512; // /proc/diskstats is always 512-byte sectors
+    for (const auto& db : b.disks) {
+        auto it = std::find_if(a.disks.begin(), a.disks.end(),
+                               [&](const DiskCounters& d) { return d.name == db.name; });
+        if (it == a.disks.end()) continue;
+        DiskRate dr;
+        dr.name       = db.name;
+        dr.read_MBps  = to_MBps(delta(it->read_sectors,  db.read_sectors)  * sector_size, secs);
+        dr.write_MBps = to_MBps(delta(it->write_sectors, db.write_sectors) * sector_size, secs);
+        if (!db.stacked) {
+            r.disk_read_MBps  += dr.read_MBps;
+            r.disk_write_MBps += dr.write_MBps;
+        }
+        r.disks.push_back(std::move(dr));
+    }
+
+    // Per-pid deltas over processes present in both samples, folded into roots
+    std::map<int, const ProcCounters*> before;
+    for (const auto& p : a.procs) before[p.pid] = &p;
+
+    for (std::size_t i = 0; i < pids_.size(); ++i) {
+        ProcRate pr;
+        pr.pid = pids_[i];
+        pr.comm = comms_[i];
+        pr.have_io = true;
+        unsigned long long ticks = 0, vctx = 0, nvctx = 0, rd = 0, wr = 0;
+        for (const auto& pb : b.procs) {
+            if (pb.root != pids_[i]) continue;
+            auto it = before.find(pb.pid);
+            if (it == before.end()) continue;
+            const ProcCounters& pa = *it->second;
+            ++pr.nprocs;
+            ticks += delta(pa.utime + pa.stime, pb.utime + pb.stime);
+            vctx  += delta(pa.vctx,  pb.vctx);
+            nvctx += delta(pa.nvctx, pb.nvctx);
+            if (pa.have_io && pb.have_io) {
+                rd += delta(pa.read_bytes,  pb.read_bytes);
+                wr += delta(pa.write_bytes, pb.write_bytes);
+            } else {
+                pr.have_io = false;
+            }
+        }
+        if (pr.nprocs == 0) pr.have_io = false;
+        pr.cpu_pct     = 100.0 * static_cast<double>(ticks) / ticks_per_s_ / secs;
+        pr.vctx_per_s  = static_cast<double>(vctx)  / secs;
+        pr.nvctx_per_s = static_cast<double>(nvctx) / secs;
+        pr.read_MBps   = to_MBps(rd, secs);
+        pr.write_MBps  = to_MBps(wr, secs);
+        r.procs.push_back(std::move(pr));
+    }
+    return r;
+}
+
+// ---------- SysWindow ----------
+
+SysWindow::SysWindow(const SysSampler& sampler, double interval_s)
+    : sampler_(sampler), interval_s_(interval_s)
+{
+}
+
+void SysWindow::start(std::chrono::steady_clock::time_point from,
+                      std::chrono::steady_clock::time_point to) {
+    thread_ = std::thread([this, from, to]() {
+        std::this_thread::sleep_until(from);
+
+        SysSample prev;
+        if (!sampler_.sample(prev)) return;
+        first_ = prev;
+
+        const auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval_s_));
+        auto tick = from;
+        while (tick < to) {
+            tick = std::min(tick + step, to);
+            std::this_thread::sleep_until(tick);
+
+            SysSample now;
+            sampler_.sample(now);
+            SysRates r = sampler_.rates(prev, now);
+            cpu_peak_      = std::max(cpu_peak_, r.cpu_util);
+            proc_cpu_peak_ = std::max(proc_cpu_peak_, r.total_proc().cpu_pct);
+            prev = std::move(now);
+        }
+        last_ = std::move(prev);
+        ok_ = true;
+    });
+}
+
+void SysWindow::join() {
+    if (thread_.joinable()) thread_.join();
+}
@@ -0,0 +1,396 @@
+#include "pg_proxy.h"
+#include "utils.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kReadChunk = 64 * 1024;
+
+// Bytes a pipe holds back before it stops reading, so that TCP flow control
+// reaches the sender when the link is slower than it; also the socket
+// receive buffers, which would otherwise autotune to megabytes and let a
+// bulk write finish at loopback speed
+constexpr std::size_t kWindowBytes = 256 * 1024;
+
+Clock::duration from_ms(double ms) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+}
+
+// "host:port" or ":port"; the host is kept when only a port is given
+void parse_endpoint(const std::string& arg, const std::string& s, std::string& host, int& port) {
+    std::size_t colon = s.rfind(':');
+    if (colon == std::string::npos) throw std::runtime_error(arg + " expects host:port, got " + s);
+    if (colon > 0) host = s.substr(0, colon);
+    port = std::stoi(s.substr(colon + 1));
+    if (port < 0 || port > 65535) throw std::runtime_error(arg + ": bad port in " + s);
+}
+
+bool resolve(const std::string& host, int port, bool passive, sockaddr_storage& out, socklen_t& len) {
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (passive) hints.ai_flags = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) {
+        return false;
+    }
+    std::memcpy(&out, res->ai_addr, res->ai_addrlen);
+    len = static_cast<socklen_t>(res->ai_addrlen);
+    freeaddrinfo(res);
+    return true;
+}
+
+// PostgreSQL's messages are small; without TCP_NODELAY Nagle would add
+// delays of its own on top of the configured ones
+void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// Before listen() / connect(), so the advertised window is sized from it
+void set_rcvbuf(int fd) {
+    int size = static_cast<int>(kWindowBytes);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+// One direction of the simulated network, shared by all connections: the
+// serialization queue for --bandwidth and the place stalls happen
+struct Link {
+    explicit Link(const char* n) : name(n) {}
+
+    const char*           name;
+    std::mutex            mu;
+    std::mt19937_64       rng;
+    Clock::time_point     free_at{};    // when the link can start on the next chunk
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> chunks{0};
+    std::atomic<uint64_t> stalls{0};
+};
+
+struct Proxy {
+    explicit Proxy(const ProxyConfig& c) : cfg(c) {}
+
+    const ProxyConfig&   cfg;
+    sockaddr_storage     upstream{};
+    socklen_t            upstream_len = 0;
+    Link                 to_db{"to-db"};
+    Link                 to_client{"to-client"};
+    std::atomic<int>     active{0};
+    std::atomic<uint64_t> accepted{0};
+};
+
+// When a chunk of n bytes read now arrives at the far end: it waits for
+// the link (and any stall), occupies it for n / bandwidth, then travels
+// latency + jitter
+Clock::time_point schedule(Link& link, const ProxyConfig& cfg, std::size_t n, Clock::time_point now) {
+    std::lock_guard<std::mutex> lk(link.mu);
+    Clock::time_point start = std::max(now, link.free_at);
+    if (cfg.stall_prob > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(link.rng) < cfg.stall_prob) {
+        start += from_ms(cfg.stall_ms);
+        link.stalls.fetch_add(1, std::memory_order_relaxed);
+        log_debug(std::string("Stalling ") + link.name);
+    }
+    link.free_at = start;
+    if (cfg.bandwidth_mbps > 0.0) {
+        link.free_at += from_ms(static_cast<double>(n) * 8.0 / (cfg.bandwidth_mbps * 1000.0));
+    }
+    double delay_ms = cfg.latency_ms;
+    if (cfg.jitter_ms > 0.0) delay_ms += std::uniform_real_distribution<double>(0.0, cfg.jitter_ms)(link.rng);
+
+    link.bytes.fetch_add(n, std::memory_order_relaxed);
+    link.chunks.fetch_add(1, std::memory_order_relaxed);
+    return link.free_at + from_ms(delay_ms);
+}
+
+struct Chunk {
+    Clock::time_point due;
+    std::string       data;
+};
+
+// One direction of one connection: a reader queues what arrives on src
+// with its delivery time, a writer sends it to dst when it is due. At most
+// kWindowBytes are queued; the reader waits for the writer beyond that.
+struct Pipe {
+    Pipe(int s, int d, Link& l) : src(s), dst(d), link(l) {}
+
+    int                     src;
+    int                     dst;
+    Link&                   link;
+    std::mutex              mu;
+    std::condition_variable cv;          // writer: data queued or eof
+    std::condition_variable space;       // reader: queue below the window, or broken
+    std::deque<Chunk>       queue;
+    std::size_t             queued = 0;  // bytes in queue
+    Clock::time_point       last_due{};  // keeps jitter from reordering the stream
+    bool                    eof    = false;
+    bool                    broken = false;  // writer gave up; the reader stops too
+};
+
+void pump_in(Pipe& p, const ProxyConfig& cfg) {
+    char buf[kReadChunk];
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(p.mu);
+            p.space.wait(lk, [&] { return p.queued < kWindowBytes || p.broken; });
+            if (p.broken) return;
+        }
+        ssize_t n = recv(p.src, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lk(p.mu);
+        if (n <= 0) {
+            p.eof = true;
+            p.cv.notify_one();
+            return;
+        }
+        Clock::time_point due = std::max(schedule(p.link, cfg, static_cast<std::size_t>(n), now), p.last_due);
+        p.last_due = due;
+        p.queue.push_back({due, std::string(buf, static_cast<std::size_t>(n))});
+        p.queued += static_cast<std::size_t>(n);
+        p.cv.notify_one();
+    }
+}
+
+bool send_all(int fd, const std::string& data) {
+    std::size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n > 0) {
+            off += static_cast<std::size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void pump_out(Pipe& p) {
+    std::unique_lock<std::mutex> lk(p.mu);
+    for (;;) {
+        if (p.queue.empty()) {
+            if (p.eof) break;
+            p.cv.wait(lk);
+            continue;
+        }
+        Clock::time_point due = p.queue.front().due;
+        if (Clock::now() < due) {
+            p.cv.wait_until(lk, due);
+            continue;
+        }
+        std::string data = std::move(p.queue.front().data);
+        p.queue.pop_front();
+
+        lk.unlock();
+        bool ok = send_all(p.dst, data);
+        lk.lock();
+        if (!ok) {
+            // The far side is gone: tear the whole connection down, which
+            // also wakes this pipe's reader and the other direction
+            shutdown(p.src, SHUT_RDWR);
+            shutdown(p.dst, SHUT_RDWR);
+            p.queue.clear();
+            p.queued = 0;
+            p.broken = true;
+            p.space.notify_one();
+            return;
+        }
+        // Freed window: the reader may take more from the sender
+        p.queued -= data.size();
+        p.space.notify_one();
+    }
+    // Pass the half-close on once everything before it is delivered
+    shutdown(p.dst, SHUT_WR);
+}
+
+void serve_connection(Proxy& px, int client_fd, const std::string& peer) {
+    int up = socket(px.upstream.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (up >= 0) set_rcvbuf(up);
+    if (up < 0 || connect(up, reinterpret_cast<const sockaddr*>(&px.upstream), px.upstream_len) != 0) {
+        log_warn("Upstream connect for " + peer + " failed: " + std::strerror(errno));
+        if (up >= 0) close(up);
+        close(client_fd);
+        return;
+    }
+    set_nodelay(up);
+
+    int active = px.active.fetch_add(1) + 1;
+    log_debug("Connection from " + peer + " (" + std::to_string(active) + " active)");
+
+    Pipe to_db(client_fd, up, px.to_db);
+    Pipe to_client(up, client_fd, px.to_client);
+    std::thread threads[] = {
+        std::thread(pump_in, std::ref(to_db), std::cref(px.cfg)),
+        std::thread(pump_out, std::ref(to_db)),
+        std::thread(pump_in, std::ref(to_client), std::cref(px.cfg)),
+        std::thread(pump_out, std::ref(to_client)),
+    };
+    for (auto& t : threads) t.join();
+    close(up);
+    close(client_fd);
+
+    active = px.active.fetch_sub(1) - 1;
+    log_debug("Connection from " + peer + " closed (" + std::to_string(active) + " active)");
+}
+
+std::string peer_name(const sockaddr_storage& addr) {
+    char host[INET6_ADDRSTRLEN] = "?";
+    int port = 0;
+    if (addr.ss_family == AF_INET) {
+        const auto* a = reinterpret_cast<const sockaddr_in*>(&addr);
+        inet_ntop(AF_INET, &a->sin_addr, host, sizeof(host));
+        port = ntohs(a->sin_port);
+    } else if (addr.ss_family == AF_INET6) {
+        const auto* a = reinterpret_cast<const sockaddr_in6*>(&addr);
+        inet_ntop(AF_INET6, &a->sin6_addr, host, sizeof(host));
+        port = ntohs(a->sin6_port);
+    }
+    return std::string(host) + ":" + std::to_string(port);
+}
+
+// Traffic since the last report, per direction
+void stats_loop(Proxy& px) {
+    uint64_t last[2][3] = {};
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::seconds(px.cfg.stats_s));
+        std::ostringstream os;
+        os << "conns=" << px.active.load() << " (accepted " << px.accepted.load() << ")";
+        Link* links[2] = {&px.to_db, &px.to_client};
+        for (int i = 0; i < 2; ++i) {
+            uint64_t now[3] = {links[i]->bytes.load(), links[i]->chunks.load(), links[i]->stalls.load()};
+            os << " " << links[i]->name << ": " << (now[0] - last[i][0]) << "B/" << (now[1] - last[i][1])
+               << " chunks/" << (now[2] - last[i][2]) << " stalls";
+            std::copy(now, now + 3, last[i]);
+        }
+        log_info(os.str());
+    }
+}
+
+} // namespace
+
+ProxyConfig parse_proxy_args(int argc, char** argv) {
+    ProxyConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](int& i) -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--listen")            parse_endpoint(arg, next(i), cfg.listen_host, cfg.listen_port);
+        else if (arg == "--upstream")     parse_endpoint(arg, next(i), cfg.upstream_host, cfg.upstream_port);
+        else if (arg == "--latency-ms")   cfg.latency_ms     = std::stod(next(i));
+        else if (arg == "--jitter-ms")    cfg.jitter_ms      = std::stod(next(i));
+        else if (arg == "--bandwidth")    cfg.bandwidth_mbps = std::stod(next(i));
+        else if (arg == "--stall-prob")   cfg.stall_prob     = std::stod(next(i));
+        else if (arg == "--stall-ms")     cfg.stall_ms       = std::stod(next(i));
+        else if (arg == "--seed")         cfg.seed           = std::stoull(next(i));
+        else if (arg == "--stats")        cfg.stats_s        = std::stoi(next(i));
+        else if (arg == "--log-level")    cfg.log_level      = next(i);
+        else if (arg == "--cpu")          cfg.cpu_affinity   = next(i);
+        else if (arg == "--help" || arg == "-h") {
+            std::cout
+                << "kv-pgproxy options:\n"
+                << "  --listen <host:port>    Address to accept on (default " << cfg.listen_host << ":" << cfg.listen_port << ")\n"
+                << "  --upstream <host:port>  PostgreSQL to forward to (default " << cfg.upstream_host << ":" << cfg.upstream_port << ")\n"
+                << "  --latency-ms <ms>       One-way delay added in each direction (default 0)\n"
+                << "  --jitter-ms <ms>        Extra uniform 0..ms delay per chunk (default 0)\n"
+                << "  --bandwidth <Mbit/s>    Per-direction link rate shared by all connections (default unlimited)\n"
+                << "  --stall-prob <p>        Chance per chunk that its direction stalls (default 0)\n"
+                << "  --stall-ms <ms>         Length of a stall\n"
+                << "  --seed <n>              RNG seed for jitter and stalls (default random)\n"
+                << "  --stats <s>             Log traffic counters every s seconds\n"
+                << "  --log-level <lvl>       TRACE|DEBUG|INFO|WARN|ERROR|OFF (default " << cfg.log_level << ")\n"
+                << "  --cpu <spec>            CPU affinity (e.g. \"2\" or \"2-3\")\n";
+            std::exit(0);
+        }
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    if (cfg.latency_ms < 0.0 || cfg.jitter_ms < 0.0 || cfg.bandwidth_mbps < 0.0 || cfg.stall_ms < 0.0) {
+        throw std::runtime_error("--latency-ms, --jitter-ms, --bandwidth and --stall-ms must be >= 0");
+    }
+    if (cfg.stall_prob < 0.0 || cfg.stall_prob > 1.0) throw std::runtime_error("--stall-prob must be in [0, 1]");
+    if (cfg.stall_prob > 0.0 && cfg.stall_ms <= 0.0) throw std::runtime_error("--stall-prob needs --stall-ms");
+    if (cfg.stats_s < 0) throw std::runtime_error("--stats must be >= 0");
+    return cfg;
+}
+
+int run_proxy(const ProxyConfig& cfg) {
+    Proxy px(cfg);
+    if (!resolve(cfg.upstream_host, cfg.upstream_port, false, px.upstream, px.upstream_len)) {
+        log_error("Failed to resolve upstream " + cfg.upstream_host);
+        return 1;
+    }
+    std::random_device rd;
+    px.to_db.rng.seed(cfg.seed ? cfg.seed : rd());
+    px.to_client.rng.seed(cfg.seed ? cfg.seed + 1 : rd());
+
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    if (!resolve(cfg.listen_host, cfg.listen_port, true, addr, addr_len)) {
+        log_error("Failed to resolve listen address " + cfg.listen_host);
+        return 1;
+    }
+    int lfd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (lfd >= 0) {
+        setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        set_rcvbuf(lfd);   // inherited by accepted connections
+    }
+    if (lfd < 0 || bind(lfd, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0 || listen(lfd, 1024) != 0) {
+        log_error("Failed to listen on " + cfg.listen_host + ":" + std::to_string(cfg.listen_port) + ": " +
+                  std::strerror(errno));
+        if (lfd >= 0) close(lfd);
+        return 1;
+    }
+
+    std::ostringstream os;
+    os << "kv-pgproxy " << cfg.listen_host << ":" << cfg.listen_port << " -> " << cfg.upstream_host << ":"
+       << cfg.upstream_port << " latency=" << cfg.latency_ms << "ms jitter=" << cfg.jitter_ms << "ms bandwidth=";
+    if (cfg.bandwidth_mbps > 0.0) os << cfg.bandwidth_mbps << "Mbit/s"; else os << "unlimited";
+    if (cfg.stall_prob > 0.0) os << " stalls=" << cfg.stall_ms << "ms@p" << cfg.stall_prob;
+    log_info(os.str());
+
+    if (cfg.stats_s > 0) std::thread(stats_loop, std::ref(px)).detach();
+
+    for (;;) {
+        sockaddr_storage peer{};
+        socklen_t peer_len = sizeof(peer);
+        int fd = accept4(lfd, reinterpret_cast<sockaddr*>(&peer), &peer_len, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            log_error(std::string("accept() failed: ") + std::strerror(errno));
+            // Out of descriptors, most likely; let some connections finish
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        set_nodelay(fd);
+        px.accepted.fetch_add(1, std::memory_order_relaxed);
+        std::thread(serve_connection, std::ref(px), fd, peer_name(peer)).detach();
+    }
+}
@@ -0,0 +1,25 @@
+#include "pg_proxy.h"
+#include "utils.h"
+
+#include <iostream>
+
+int main(int argc, char** argv) {
+    try {
+        ProxyConfig cfg = parse_proxy_args(argc, argv);
+        log_set_level(cfg.log_level);
+
+        if (!cfg.cpu_affinity.empty()) {
+            std::string err;
+            if (!set_process_affinity(cfg.cpu_affinity, &err)) {
+                log_warn("Failed to set CPU affinity: " + err);
+            } else {
+                log_info("Process CPU affinity set to: " + cfg.cpu_affinity);
+            }
+        }
+
+        return run_proxy(cfg);
+    } catch (const std::exception& e) {
+        std::cerr << "kv-pgproxy fatal error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -10,7 +10,10 @@ import matplotlib.pyplot as plt
 
 def load_all_csv(csv_dir: str) -> pd.DataFrame:
     pattern = os.path.join(csv_dir, "*.csv")
-    files: List[str] = glob.glob(pattern)
+    # --find-knee curves (knee_*.csv) are per-step, not per-run: their
+    # clients/thr_rps would be averaged into the sweep points
+    files: List[str] = [f for f in glob.glob(pattern)
+                        if not os.path.basename(f).startswith("knee_")]
     if not files:
         raise SystemExit(f"No CSV files found in {csv_dir!r}")
 
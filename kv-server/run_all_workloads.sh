@@ -5,6 +5,9 @@ set -euo pipefail
 ROOT="$HOME/Desktop/DECS/kv-server"
 BUILD="$ROOT/build"
 CSV_DIR="$ROOT/csv"
+# --find-knee curves have their own columns; kept out of csv/ so that
+# plot_results.py doesn't mix their steps into the client sweep
+KNEE_DIR="$ROOT/knee"
 
 mkdir -p "$CSV_DIR"
 cd "$BUILD"
@@ -14,6 +17,30 @@ HOST=127.0.0.1
 PORT=8080
 KEYS=5000000
 
+# epoll multiplexes all clients over a few threads; "threads" spawns one
+# thread per client, which stops scaling long before 32768 clients.
+ENGINE="${ENGINE:-epoll}"
+
+# Server + PostgreSQL are pinned to these cores (README section 7); sample
+# them and the server processes (the postmaster covers all backends).
+SERVER_CORES="${SERVER_CORES:-0-1}"
+SERVER_PIDS="${SERVER_PIDS:-$( (pgrep -x kv-server; pgrep -o -x postgres) | paste -sd, - || true)}"
+SYS_ARGS=(--cores "$SERVER_CORES")
+if [[ -n "$SERVER_PIDS" ]]; then
+  SYS_ARGS+=(--server-pid "$SERVER_PIDS")
+fi
+
+# Fill the keyspace once up front (PRELOAD=0 skips it). With PG_CONNINFO set
+# the rows are COPYed straight into PostgreSQL instead of PUT via the server.
+if [[ "${PRELOAD:-1}" == 1 ]]; then
+  PRELOAD_ARGS=(--preload-only --keys "$KEYS")
+  if [[ -n "${PG_CONNINFO:-}" ]]; then
+    PRELOAD_ARGS+=(--pg "$PG_CONNINFO")
+  fi
+  echo "[PRELOAD] keys=$KEYS"
+  taskset -c 2-3 ./kv-loadgen --host "$HOST" --port "$PORT" "${PRELOAD_ARGS[@]}"
+fi
+
 # Timings
 WARMUP_PUT=60
 MEASURE_PUT=300
@@ -24,6 +51,29 @@ MEASURE_GET=300
 # Client counts to sweep
 CLIENTS=(8 16 32 64 128 256 512 1024 2048 4096 8192 16384 32768)
 
+# KNEE=1: one adaptive --find-knee search per workload instead of the full
+# sweep (minutes instead of hours); SLO_P99 is the p99 target in ms.
+if [[ "${KNEE:-0}" == 1 ]]; then
+  mkdir -p "$KNEE_DIR"
+  for spec in put-all:putall get-popular:cpu_getpopular get-all:io_getall; do
+    wl="${spec%%:*}"
+    name="${spec##*:}"
+    echo "[KNEE] workload=$wl"
+    taskset -c 2-3 ./kv-loadgen \
+      --host "$HOST" \
+      --port "$PORT" \
+      --workload "$wl" \
+      --engine "$ENGINE" \
+      --keys "$KEYS" \
+      --clients 8 \
+      --find-knee \
+      --slo-p99 "${SLO_P99:-10}" \
+      --knee-out "$KNEE_DIR/knee_${name}.csv"
+  done
+  echo "Knee searches completed. CSVs are in: $KNEE_DIR"
+  exit 0
+fi
+
 for c in "${CLIENTS[@]}"; do
   echo "============================"
   echo "Clients: $c"
@@ -35,6 +85,8 @@ for c in "${CLIENTS[@]}"; do
     --port "$PORT" \
     --workload put-all \
     --clients "$c" \
+    --engine "$ENGINE" \
+    "${SYS_ARGS[@]}" \
     --keys "$KEYS" \
     --warmup "$WARMUP_PUT" \
     --measure "$MEASURE_PUT" \
@@ -46,6 +98,8 @@ for c in "${CLIENTS[@]}"; do
     --port "$PORT" \
     --workload get-popular \
     --clients "$c" \
+    --engine "$ENGINE" \
+    "${SYS_ARGS[@]}" \
     --keys "$KEYS" \
     --warmup "$WARMUP_GET" \
     --measure "$MEASURE_GET" \
@@ -57,6 +111,8 @@ for c in "${CLIENTS[@]}"; do
     --port "$PORT" \
     --workload get-all \
     --clients "$c" \
+    --engine "$ENGINE" \
+    "${SYS_ARGS[@]}" \
     --keys "$KEYS" \
     --warmup "$WARMUP_GET" \
     --measure "$MEASURE_GET" \
@@ -0,0 +1,386 @@
+#!/usr/bin/env python3
+"""
+Performance regression gate: run bench-hotpath, bench-cache and bench-server
+with fixed settings, and compare every metric with the samples stored in a
+baseline JSON file.
+
+A metric regresses when both hold:
+  * a one-sided Mann-Whitney U test says the current samples are worse than
+    the baseline's (p < alpha), and
+  * the medians differ by more than the metric's tolerance, in the bad
+    direction.
+The first keeps noise from failing the gate, the second keeps a real but
+negligible shift from doing so.
+
+Absolute numbers only compare on the machine that produced them, so the
+baseline is per machine: it records the host, CPU model and count and the
+benchmark settings, and a check on anything else is refused.
+
+Exit status: 0 if nothing regressed, 1 on a regression, 2 if the check
+could not be made (no baseline for this machine or a suite, a benchmark
+failed, a baseline metric missing from the run). --update rewrites the
+baseline from the current run. The baseline lives in the build directory
+by default, so it is never committed.
+"""
+import argparse
+import csv
+import datetime
+import json
+import math
+import os
+import platform
+import re
+import subprocess
+import sys
+import tempfile
+from typing import Dict, List, Optional, Tuple
+
+REPO_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINE_NAME = "perf_baseline.json"
+
+# Fixed benchmark settings. Changing them invalidates the baseline, which
+# records them and is checked against them.
+HOTPATH_ARGS = ["--reps", "5", "--warmup-ms", "50", "--min-rep-ms", "20"]
+CACHE_ARGS = ["--threads", "1,4", "--dist", "zipf", "--mix", "95:5:0",
+              "--capacity", "10000", "--value-size", "64", "--duration", "0.5"]
+SERVER_ARGS = ["--clients", "8", "--threads", "4", "--cache-size", "20000",
+               "--keys", "50000", "--dist", "zipf", "--read-ratio", "0.9",
+               "--db-latency-us", "200", "--warmup", "1", "--measure", "3"]
+
+SUITES = ["hotpath", "cache", "server"]
+
+# (unit, better, tolerance) per kind of metric; tail latency is noisier
+# than throughput and gets more room
+KIND_THROUGHPUT = ("ops/s", "higher", 0.10)
+KIND_NS_PER_OP = ("ns/op", "lower", 0.10)
+KIND_P99_NS = ("ns", "lower", 0.25)
+KIND_RPS = ("req/s", "higher", 0.10)
+KIND_P99_MS = ("ms", "lower", 0.25)
+
+Samples = Dict[str, Tuple[Tuple[str, str, float], List[float]]]
+
+
+# ---------- running the benchmarks ----------
+
+def run_bench(build_dir: str, name: str, args: List[str]) -> None:
+    exe = os.path.join(build_dir, name)
+    if not os.path.exists(exe):
+        raise RuntimeError(f"{exe} not found (build with -DBUILD_BENCH=ON)")
+    cmd = [exe] + args
+    print("+ " + " ".join(cmd), flush=True)
+    res = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    if res.returncode != 0:
+        raise RuntimeError(f"{name} exited with {res.returncode}:\n{res.stderr.strip()}")
+
+
+def read_csv(path: str) -> List[Dict[str, str]]:
+    with open(path, newline="") as f:
+        return list(csv.DictReader(f))
+
+
+def add(samples: Samples, metric: str, kind: Tuple[str, str, float], value: float) -> None:
+    samples.setdefault(metric, (kind, []))[1].append(value)
+
+
+def run_hotpath(build_dir: str, tmp: str, runs: int) -> Samples:
+    # One sample per process, its median repetition: repetitions within a
+    # process share its code layout and CPU state, so they vary less than
+    # runs do and would make the test overconfident
+    samples: Samples = {}
+    for i in range(runs):
+        out = os.path.join(tmp, f"hotpath_{i}.csv")
+        run_bench(build_dir, "bench-hotpath", HOTPATH_ARGS + ["--csv", out])
+        for row in read_csv(out):
+            add(samples, "hotpath/" + row["name"], KIND_NS_PER_OP, float(row["median_ns"]))
+    return samples
+
+
+def run_cache(build_dir: str, tmp: str, runs: int) -> Samples:
+    samples: Samples = {}
+    for i in range(runs):
+        out = os.path.join(tmp, f"cache_{i}.csv")
+        run_bench(build_dir, "bench-cache", CACHE_ARGS + ["--seed", str(42 + i), "--csv", out])
+        for row in read_csv(out):
+            case = f"cache/t{row['threads']}"
+            add(samples, case + "/ops_per_s", KIND_THROUGHPUT, float(row["ops_per_s"]))
+            add(samples, case + "/get_p99_ns", KIND_P99_NS, float(row["get_p99_ns"]))
+    return samples
+
+
+def run_server(build_dir: str, tmp: str, runs: int) -> Samples:
+    # bench-server appends one row per run
+    out = os.path.join(tmp, "server.csv")
+    for i in range(runs):
+        run_bench(build_dir, "bench-server", SERVER_ARGS + ["--seed", str(42 + i), "--csv", out])
+    samples: Samples = {}
+    for row in read_csv(out):
+        add(samples, "server/thr_rps", KIND_RPS, float(row["thr_rps"]))
+        add(samples, "server/p99_ms", KIND_P99_MS, float(row["p99_ms"]))
+    return samples
+
+
+RUNNERS = {"hotpath": run_hotpath, "cache": run_cache, "server": run_server}
+SUITE_ARGS = {"hotpath": HOTPATH_ARGS, "cache": CACHE_ARGS, "server": SERVER_ARGS}
+
+
+# ---------- statistics ----------
+
+def median(xs: List[float]) -> float:
+    s = sorted(xs)
+    n = len(s)
+    return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) / 2.0
+
+
+def u_statistic(worse: List[float], other: List[float]) -> float:
+    """Pairs (w, o) with w > o, ties counting one half."""
+    u = 0.0
+    for w in worse:
+        for o in other:
+            u += 1.0 if w > o else (0.5 if w == o else 0.0)
+    return u
+
+
+def exact_upper_p(m: int, n: int, u: float) -> float:
+    """P(U >= u) under H0 without ties, by counting rank arrangements."""
+    # ways[i][j][k]: orderings of i and j samples with k "wins" for the first
+    max_u = m * n
+    ways = [[[0] * (max_u + 1) for _ in range(n + 1)] for _ in range(m + 1)]
+    for j in range(n + 1):
+        ways[0][j][0] = 1
+    for i in range(1, m + 1):
+        ways[i][0][0] = 1
+        for j in range(1, n + 1):
+            for k in range(max_u + 1):
+                # the largest value is from the first sample (beats all j) or the second
+                ways[i][j][k] = (ways[i - 1][j][k - j] if k >= j else 0) + ways[i][j - 1][k]
+    total = math.comb(m + n, m)
+    return sum(ways[m][n][math.ceil(u):]) / total
+
+
+def mann_whitney_worse_p(current: List[float], baseline: List[float], better: str) -> float:
+    """One-sided p-value for 'current is worse than baseline'."""
+    # Orient so that a larger value is worse
+    if better == "higher":
+        current = [-x for x in current]
+        baseline = [-x for x in baseline]
+    m, n = len(current), len(baseline)
+    u = u_statistic(current, baseline)
+    combined = current + baseline
+    if len(set(combined)) == len(combined) and m * n <= 400:
+        return exact_upper_p(m, n, u)
+
+    # Normal approximation with tie correction and continuity correction
+    counts: Dict[float, int] = {}
+    for x in combined:
+        counts[x] = counts.get(x, 0) + 1
+    ties = sum(t ** 3 - t for t in counts.values())
+    N = m + n
+    var = m * n / 12.0 * ((N + 1) - ties / (N * (N - 1)))
+    if var <= 0:
+        return 1.0
+    z = (u - m * n / 2.0 - 0.5) / math.sqrt(var)
+    return 0.5 * math.erfc(z / math.sqrt(2.0))
+
+
+# ---------- comparison ----------
+
+def compare(baseline: dict, current: Samples, alpha: float) -> Tuple[List[List[str]], int, int, int]:
+    rows: List[List[str]] = []
+    regressions = improvements = missing = 0
+    base_metrics = baseline.get("metrics", {})
+
+    for metric in sorted(set(base_metrics) | set(current)):
+        if metric not in current:
+            # A benchmark case that stopped reporting must not pass unnoticed
+            b = base_metrics[metric]
+            rows.append([metric, fmt(median(b["samples"]), b["unit"]), "-", "", "", "MISSING"])
+            missing += 1
+            continue
+        (unit, better, tolerance), cur = current[metric]
+        if metric not in base_metrics:
+            rows.append([metric, "-", fmt(median(cur), unit), "", "", "new (no baseline)"])
+            continue
+
+        b = base_metrics[metric]
+        tolerance = b.get("tolerance", tolerance)
+        base_med, cur_med = median(b["samples"]), median(cur)
+        change = (cur_med - base_med) / base_med if base_med else 0.0
+        worse_change = change if better == "lower" else -change
+
+        p_worse = mann_whitney_worse_p(cur, b["samples"], better)
+        p_better = mann_whitney_worse_p(b["samples"], cur, better)
+        if p_worse < alpha and worse_change > tolerance:
+            status = f"REGRESSED (> {tolerance:.0%})"
+            regressions += 1
+            p = p_worse
+        elif p_better < alpha and -worse_change > tolerance:
+            status = "improved"
+            improvements += 1
+            p = p_better
+        else:
+            status = "ok"
+            p = min(p_worse, p_better)
+        rows.append([metric, fmt(base_med, unit), fmt(cur_med, unit), f"{change:+.1%}", f"{p:.3f}", status])
+    return rows, regressions, improvements, missing
+
+
+def fmt(v: float, unit: str) -> str:
+    return f"{v:.4g} {unit}"
+
+
+def print_table(rows: List[List[str]]) -> None:
+    header = ["metric", "baseline", "current", "change", "p", "status"]
+    widths = [max(len(r[i]) for r in rows + [header]) for i in range(len(header))]
+    line = "  ".join(h.ljust(w) for h, w in zip(header, widths))
+    print(line)
+    print("-" * len(line))
+    for r in rows:
+        print("  ".join(c.ljust(w) for c, w in zip(r, widths)))
+
+
+def cpu_model() -> str:
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor()
+
+
+def machine_info() -> dict:
+    return {"host": platform.node(), "cpu": cpu_model(), "cpus": os.cpu_count(),
+            "machine": platform.machine()}
+
+
+def same_machine(baseline: dict) -> bool:
+    return baseline.get("machine") == machine_info()
+
+
+def incompatibilities(baseline: dict, suites: List[str]) -> List[str]:
+    """Why this baseline can't be compared with a run here; empty if it can."""
+    problems = []
+    here, there = machine_info(), baseline.get("machine", {})
+    for key in ("host", "cpu", "cpus", "machine"):
+        if there.get(key) != here[key]:
+            problems.append(f"baseline {key} is {there.get(key)!r}, this machine's is {here[key]!r}")
+    recorded = {m.split("/", 1)[0] for m in baseline.get("metrics", {})}
+    for suite in suites:
+        if suite not in recorded:
+            problems.append(f"baseline has no {suite}/* metrics")
+        elif baseline.get("args", {}).get(suite) != " ".join(SUITE_ARGS[suite]):
+            problems.append(f"baseline {suite} settings differ from this script's")
+    return problems
+
+
+def write_baseline(path: str, current: Samples, old: Optional[dict], suites: List[str], alpha: float) -> None:
+    metrics = {}
+    old_metrics = (old or {}).get("metrics", {})
+    for metric, ((unit, better, tolerance), cur) in sorted(current.items()):
+        # Tolerances edited by hand survive an update
+        tolerance = old_metrics.get(metric, {}).get("tolerance", tolerance)
+        metrics[metric] = {"unit": unit, "better": better, "tolerance": tolerance,
+                           "samples": [round(x, 4) for x in cur]}
+    # Suites not rerun keep their old entries, if they come from this machine
+    if old and not same_machine(old):
+        old_metrics, old = {}, None
+    for metric, entry in old_metrics.items():
+        if metric.split("/", 1)[0] not in suites:
+            metrics.setdefault(metric, entry)
+    args = dict((old or {}).get("args", {}))
+    args.update({s: " ".join(SUITE_ARGS[s]) for s in suites})
+    doc = {
+        "created": datetime.datetime.now().isoformat(timespec="seconds"),
+        "machine": machine_info(),
+        "alpha": (old or {}).get("alpha", alpha),
+        "args": args,
+        "metrics": dict(sorted(metrics.items())),
+    }
+    # Sample lists on one line each, so the diff of an update stays readable
+    text = re.sub(r"\[\s+([-0-9.,e\s]+?)\s+\]",
+                  lambda m: "[" + ", ".join(x.strip() for x in m.group(1).split(",")) + "]",
+                  json.dumps(doc, indent=2))
+    with open(path, "w") as f:
+        f.write(text + "\n")
+    print(f"Baseline written to {path} ({len(current)} metrics)")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compare benchmark results with a stored baseline.")
+    parser.add_argument("--build-dir", default=os.path.join(REPO_DIR, "build"),
+                        help="Directory with the bench-* binaries (default: build/)")
+    parser.add_argument("--baseline", default=None,
+                        help=f"Baseline JSON file, recorded on this machine (default: {BASELINE_NAME} "
+                             "in the build directory)")
+    parser.add_argument("--suites", default=",".join(SUITES),
+                        help="Comma-separated subset of " + ",".join(SUITES))
+    parser.add_argument("--runs", type=int, default=7,
+                        help="Runs of each benchmark; each run is one sample (default 7)")
+    parser.add_argument("--alpha", type=float, default=None,
+                        help="Significance level (default: the baseline's, else 0.05)")
+    parser.add_argument("--update", action="store_true", help="Rewrite the baseline from this run")
+    parser.add_argument("--force", action="store_true",
+                        help="Compare even with a baseline from another machine or other settings")
+    args = parser.parse_args()
+
+    if args.baseline is None:
+        args.baseline = os.path.join(args.build_dir, BASELINE_NAME)
+    suites = [s for s in args.suites.split(",") if s]
+    unknown = [s for s in suites if s not in SUITES]
+    if unknown or args.runs < 3:
+        parser.error(f"unknown suites {unknown}" if unknown else "--runs must be >= 3")
+
+    baseline: Optional[dict] = None
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    elif not args.update:
+        print(f"No baseline at {args.baseline}; record one on this machine with --update "
+              "(cmake target perf-baseline)", file=sys.stderr)
+        return 2
+    if baseline is not None and not args.update:
+        problems = incompatibilities(baseline, suites)
+        for p in problems:
+            print(("warning: " if args.force else "perf-check: ") + p, file=sys.stderr)
+        if problems and not args.force:
+            print("The baseline doesn't match this machine and settings; record one here with --update "
+                  "(cmake target perf-baseline), or pass --force", file=sys.stderr)
+            return 2
+    alpha = args.alpha if args.alpha is not None else (baseline or {}).get("alpha", 0.05)
+
+    current: Samples = {}
+    with tempfile.TemporaryDirectory(prefix="perf_check_") as tmp:
+        for suite in suites:
+            try:
+                current.update(RUNNERS[suite](args.build_dir, tmp, args.runs))
+            except (RuntimeError, OSError, KeyError, ValueError) as e:
+                print(f"perf-check: {suite} failed: {e}", file=sys.stderr)
+                return 2
+
+    if args.update:
+        write_baseline(args.baseline, current, baseline, suites, alpha)
+        return 0
+
+    assert baseline is not None
+    # Only the suites that ran are compared
+    baseline = dict(baseline)
+    baseline["metrics"] = {k: v for k, v in baseline.get("metrics", {}).items()
+                           if k.split("/", 1)[0] in suites}
+    rows, regressions, improvements, missing = compare(baseline, current, alpha)
+    print()
+    print_table(rows)
+    print()
+    print(f"{len(rows)} metrics, {regressions} regressed, {improvements} improved, {missing} missing "
+          f"(Mann-Whitney one-sided, alpha={alpha})")
+    if missing:
+        print("Metrics in the baseline were not produced by this run; fix the benchmark, or "
+              "re-record the baseline with --update if they were dropped on purpose", file=sys.stderr)
+        return 2
+    if improvements and not regressions:
+        print("Improvements found; refresh the baseline with --update once they are merged")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -10,6 +10,7 @@
 using json = nlohmann::json;
 
 static void apply_json(Config& cfg, const json& j) {
+    if (j.contains("server_host"))      cfg.server_host      = j["server_host"].get<std::string>();
     if (j.contains("server_port"))      cfg.server_port      = j["server_port"].get<int>();
     if (j.contains("thread_pool_size")) cfg.thread_pool_size = j["thread_pool_size"].get<int>();
     if (j.contains("cache_size"))       cfg.cache_size       = j["cache_size"].get<std::size_t>();
@@ -17,6 +18,7 @@ static void apply_json(Config& cfg, const json& j) {
     if (j.contains("pg_conninfo"))      cfg.pg_conninfo      = j["pg_conninfo"].get<std::string>();
     if (j.contains("pg_pool_size"))     cfg.pg_pool_size     = j["pg_pool_size"].get<int>();
     if (j.contains("cpu_affinity"))     cfg.cpu_affinity     = j["cpu_affinity"].get<std::string>();
+    if (j.contains("server_timing"))    cfg.server_timing    = j["server_timing"].get<bool>();
 }
 
 Config parse_server_args(int argc, char** argv, int default_port) {
@@ -43,7 +45,9 @@ Config parse_server_args(int argc, char** argv, int default_port) {
             return argv[++i];
         };
 
-        if (arg == "--port") {
+        if (arg == "--host") {
+            cfg.server_host = next(i);
+        } else if (arg == "--port") {
             cfg.server_port = std::stoi(next(i));
         } else if (arg == "--threads") {
             cfg.thread_pool_size = std::stoi(next(i));
@@ -57,16 +61,20 @@ Config parse_server_args(int argc, char** argv, int default_port) {
             cfg.pg_pool_size = std::stoi(next(i));
         } else if (arg == "--cpu") {
             cfg.cpu_affinity = next(i);
+        } else if (arg == "--server-timing") {
+            cfg.server_timing = true;
         } else if (arg == "--help" || arg == "-h") {
             std::cout
                 << "kv-server options:\n"
+                << "  --host <addr>       Address to bind (default " << cfg.server_host << ")\n"
                 << "  --port <n>          Server port (default " << cfg.server_port << ")\n"
                 << "  --threads <n>       HTTP worker threads (default " << cfg.thread_pool_size << ")\n"
                 << "  --cache-size <n>    Cache capacity in entries (default " << cfg.cache_size << ")\n"
                 << "  --log-level <lvl>   TRACE|DEBUG|INFO|WARN|ERROR|OFF (default " << cfg.log_level << ")\n"
                 << "  --pg <conninfo>     PostgreSQL conninfo string\n"
                 << "  --pg-pool <n>       PostgreSQL connection pool size (default " << cfg.pg_pool_size << ")\n"
-                << "  --cpu <spec>        CPU affinity (e.g. \"0-1\" or \"2,3\")\n";
+                << "  --cpu <spec>        CPU affinity (e.g. \"0-1\" or \"2,3\")\n"
+                << "  --server-timing     Add a Server-Timing header to /get, /put and /delete responses\n";
             std::exit(0);
         }
     }
@@ -4,6 +4,7 @@
 #include <libpq-fe.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <memory>
 #include <mutex>
@@ -76,6 +77,34 @@ ConnSlot& pick_slot() {
     return *g_pool[static_cast<std::size_t>(i % g_pool.size())];
 }
 
+// Locks a pool slot, timing the wait and (until destroyed) the query when
+// the caller asked for a DbTiming.
+class TimedLock {
+public:
+    TimedLock(ConnSlot& s, DbTiming* timing) : timing_(timing) {
+        if (timing_) t0_ = std::chrono::steady_clock::now();
+        lk_ = std::unique_lock<std::mutex>(s.mu);
+        if (timing_) {
+            auto t1 = std::chrono::steady_clock::now();
+            timing_->wait_us += us_between(t0_, t1);
+            t0_ = t1;
+        }
+    }
+    ~TimedLock() {
+        if (timing_) timing_->exec_us += us_between(t0_, std::chrono::steady_clock::now());
+    }
+
+private:
+    static std::int64_t us_between(std::chrono::steady_clock::time_point a,
+                                   std::chrono::steady_clock::time_point b) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(b - a).count();
+    }
+
+    DbTiming*                             timing_;
+    std::chrono::steady_clock::time_point t0_;
+    std::unique_lock<std::mutex>          lk_;
+};
+
 } // namespace
 
 bool db_init(const Config& cfg) {
@@ -129,11 +158,11 @@ bool db_init(const Config& cfg) {
     return true;
 }
 
-bool db_put(const std::string& key, const std::string& value) {
+bool db_put(const std::string& key, const std::string& value, DbTiming* timing) {
     if (!g_inited || g_pool.empty()) return false;
 
     ConnSlot& s = pick_slot();
-    std::lock_guard<std::mutex> lk(s.mu);
+    TimedLock lk(s, timing);
 
     const char* params[2]  = { key.c_str(), value.c_str() };
     const int   lengths[2] = { static_cast<int>(key.size()), static_cast<int>(value.size()) };
@@ -148,11 +177,11 @@ bool db_put(const std::string& key, const std::string& value) {
     return ok;
 }
 
-bool db_get(const std::string& key, std::string& value_out) {
+bool db_get(const std::string& key, std::string& value_out, DbTiming* timing) {
     if (!g_inited || g_pool.empty()) return false;
 
     ConnSlot& s = pick_slot();
-    std::lock_guard<std::mutex> lk(s.mu);
+    TimedLock lk(s, timing);
 
     const char* params[1]  = { key.c_str() };
     const int   lengths[1] = { static_cast<int>(key.size()) };
@@ -173,11 +202,11 @@ bool db_get(const std::string& key, std::string& value_out) {
     return found;
 }
 
-bool db_delete(const std::string& key) {
+bool db_delete(const std::string& key, DbTiming* timing) {
     if (!g_inited || g_pool.empty()) return false;
 
     ConnSlot& s = pick_slot();
-    std::lock_guard<std::mutex> lk(s.mu);
+    TimedLock lk(s, timing);
 
     const char* params[1]  = { key.c_str() };
     const int   lengths[1] = { static_cast<int>(key.size()) };
@@ -0,0 +1,242 @@
+#include "hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+int clz64(std::uint64_t v) {
+    return v == 0 ? 64 : __builtin_clzll(v);
+}
+
+} // namespace
+
+HdrHistogram::HdrHistogram(std::int64_t lowest, std::int64_t highest, int sig_figs)
+    : lowest_(std::max<std::int64_t>(1, lowest)),
+      highest_(highest),
+      sig_figs_(sig_figs)
+{
+    if (sig_figs_ < 1 || sig_figs_ > 5) {
+        throw std::invalid_argument("HdrHistogram: sig_figs must be in 1..5");
+    }
+    if (highest_ < 2 * lowest_) {
+        throw std::invalid_argument("HdrHistogram: highest must be >= 2 * lowest");
+    }
+
+    // Enough linear sub-buckets per power of two to keep sig_figs digits
+    std::int64_t largest_single_unit = 2;
+    for (int i = 0; i < sig_figs_; ++i) largest_single_unit *= 10;
+    int sub_bucket_count_magnitude =
+        static_cast<int>(std::ceil(std::log2(static_cast<double>(largest_single_unit))));
+
+    sub_bucket_half_count_magnitude_ = std::max(sub_bucket_count_magnitude, 1) - 1;
+    unit_magnitude_        = 63 - clz64(static_cast<std::uint64_t>(lowest_));
+    sub_bucket_count_      = std::int64_t{1} << (sub_bucket_half_count_magnitude_ + 1);
+    sub_bucket_half_count_ = sub_bucket_count_ / 2;
+    sub_bucket_mask_       = (sub_bucket_count_ - 1) << unit_magnitude_;
+
+    std::int64_t smallest_untrackable = sub_bucket_count_ << unit_magnitude_;
+    bucket_count_ = 1;
+    while (smallest_untrackable <= highest_) {
+        if (smallest_untrackable > INT64_MAX / 2) { ++bucket_count_; break; }
+        smallest_untrackable <<= 1;
+        ++bucket_count_;
+    }
+
+    counts_.assign(static_cast<std::size_t>((bucket_count_ + 1) * sub_bucket_half_count_), 0);
+}
+
+int HdrHistogram::bucket_index(std::int64_t v) const {
+    int pow2ceiling = 64 - clz64(static_cast<std::uint64_t>(v | sub_bucket_mask_));
+    return pow2ceiling - unit_magnitude_ - (sub_bucket_half_count_magnitude_ + 1);
+}
+
+std::size_t HdrHistogram::counts_index(std::int64_t v) const {
+    int bi = bucket_index(v);
+    std::int64_t sbi = v >> (bi + unit_magnitude_);
+    std::int64_t base = static_cast<std::int64_t>(bi + 1) << sub_bucket_half_count_magnitude_;
+    return static_cast<std::size_t>(base + (sbi - sub_bucket_half_count_));
+}
+
+std::int64_t HdrHistogram::value_at_index(std::size_t idx) const {
+    std::int64_t i  = static_cast<std::int64_t>(idx);
+    int bi          = static_cast<int>(i >> sub_bucket_half_count_magnitude_) - 1;
+    std::int64_t sbi = (i & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+    if (bi < 0) {
+        sbi -= sub_bucket_half_count_;
+        bi = 0;
+    }
+    return sbi << (bi + unit_magnitude_);
+}
+
+std::int64_t HdrHistogram::lowest_equivalent(std::int64_t v) const {
+    int bi = bucket_index(v);
+    std::int64_t sbi = v >> (bi + unit_magnitude_);
+    return sbi << (bi + unit_magnitude_);
+}
+
+std::int64_t HdrHistogram::highest_equivalent(std::int64_t v) const {
+    int bi = bucket_index(v);
+    std::int64_t sbi = v >> (bi + unit_magnitude_);
+    int adjusted = (sbi >= sub_bucket_count_) ? bi + 1 : bi;
+    std::int64_t range = std::int64_t{1} << (unit_magnitude_ + adjusted);
+    return lowest_equivalent(v) + range - 1;
+}
+
+std::int64_t HdrHistogram::median_equivalent(std::int64_t v) const {
+    return lowest_equivalent(v) + (highest_equivalent(v) - lowest_equivalent(v) + 1) / 2;
+}
+
+void HdrHistogram::record(std::int64_t value, std::int64_t count) {
+    if (count <= 0) return;
+    if (value < 0) value = 0;
+    if (value > highest_) value = highest_;
+
+    counts_[counts_index(value)] += count;
+    total_ += count;
+    if (value < min_value_) min_value_ = value;
+    if (value > max_value_) max_value_ = value;
+}
+
+bool HdrHistogram::merge(const HdrHistogram& other) {
+    if (other.counts_.size() != counts_.size() ||
+        other.lowest_ != lowest_ || other.sig_figs_ != sig_figs_) {
+        return false;
+    }
+    for (std::size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    if (other.total_ > 0) {
+        min_value_ = std::min(min_value_, other.min_value_);
+        max_value_ = std::max(max_value_, other.max_value_);
+    }
+    return true;
+}
+
+void HdrHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_     = 0;
+    min_value_ = INT64_MAX;
+    max_value_ = 0;
+}
+
+bool HdrHistogram::set_counts(const std::vector<std::int64_t>& counts) {
+    if (counts.size() != counts_.size()) return false;
+    counts_ = counts;
+    recompute_totals();
+    return true;
+}
+
+void HdrHistogram::recompute_totals() {
+    total_     = 0;
+    min_value_ = INT64_MAX;
+    max_value_ = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i] == 0) continue;
+        std::int64_t v = value_at_index(i);
+        total_ += counts_[i];
+        min_value_ = std::min(min_value_, v);
+        max_value_ = std::max(max_value_, highest_equivalent(v));
+    }
+}
+
+std::int64_t HdrHistogram::min() const {
+    return total_ == 0 ? 0 : lowest_equivalent(min_value_);
+}
+
+std::int64_t HdrHistogram::max() const {
+    return total_ == 0 ? 0 : highest_equivalent(max_value_);
+}
+
+double HdrHistogram::mean() const {
+    if (total_ == 0) return 0.0;
+    double sum = 0.0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i] == 0) continue;
+        sum += static_cast<double>(median_equivalent(value_at_index(i))) *
+               static_cast<double>(counts_[i]);
+    }
+    return sum / static_cast<double>(total_);
+}
+
+double HdrHistogram::stddev() const {
+    if (total_ == 0) return 0.0;
+    double m = mean();
+    double sq = 0.0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i] == 0) continue;
+        double d = static_cast<double>(median_equivalent(value_at_index(i))) - m;
+        sq += d * d * static_cast<double>(counts_[i]);
+    }
+    return std::sqrt(sq / static_cast<double>(total_));
+}
+
+std::int64_t HdrHistogram::value_at_percentile(double p) const {
+    if (total_ == 0) return 0;
+    p = std::min(std::max(p, 0.0), 100.0);
+    std::int64_t target = static_cast<std::int64_t>((p / 100.0) * static_cast<double>(total_) + 0.5);
+    target = std::max<std::int64_t>(target, 1);
+
+    std::int64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::min(highest_equivalent(value_at_index(i)), max());
+        }
+    }
+    return max();
+}
+
+void HdrHistogram::write_percentiles(std::ostream& out, double unit_scale,
+                                     int ticks_per_half) const {
+    out << std::fixed;
+    out << std::setw(12) << "Value" << " "
+        << std::setw(14) << "Percentile" << " "
+        << std::setw(10) << "TotalCount" << " "
+        << std::setw(14) << "1/(1-Percentile)" << "\n\n";
+
+    auto row = [&](std::int64_t value, double pct, std::int64_t cum) {
+        out << std::setw(12) << std::setprecision(3) << static_cast<double>(value) / unit_scale << " "
+            << std::setw(14) << std::setprecision(12) << pct / 100.0 << " "
+            << std::setw(10) << cum;
+        if (pct < 100.0) {
+            out << " " << std::setw(14) << std::setprecision(2) << 1.0 / (1.0 - pct / 100.0);
+        }
+        out << "\n";
+    };
+
+    if (total_ > 0) {
+        // Percentile iteration: report points at 50%, 75%, 87.5%, ... with
+        // ticks_per_half steps in each halving of the remaining distance.
+        double pct = 0.0;
+        std::int64_t seen = 0;
+        std::size_t idx = 0;
+        while (pct < 100.0) {
+            std::int64_t target = std::max<std::int64_t>(
+                1, static_cast<std::int64_t>((pct / 100.0) * static_cast<double>(total_) + 0.5));
+            while (idx < counts_.size() && seen + counts_[idx] < target) {
+                seen += counts_[idx];
+                ++idx;
+            }
+            if (idx >= counts_.size()) break;
+            row(std::min(highest_equivalent(value_at_index(idx)), max()), pct, seen + counts_[idx]);
+
+            double remaining_halvings = std::floor(std::log2(100.0 / (100.0 - pct))) + 1.0;
+            double step = 100.0 / (std::pow(2.0, remaining_halvings) * ticks_per_half);
+            pct += step;
+            if (seen + counts_[idx] >= total_) break;
+        }
+        row(max(), 100.0, total_);
+    }
+
+    out << std::setprecision(3)
+        << "#[Mean    = " << std::setw(12) << mean() / unit_scale
+        << ", StdDeviation   = " << std::setw(12) << stddev() / unit_scale << "]\n"
+        << "#[Max     = " << std::setw(12) << static_cast<double>(max()) / unit_scale
+        << ", Total count    = " << std::setw(12) << total_ << "]\n"
+        << "#[Buckets = " << std::setw(12) << bucket_count_
+        << ", SubBuckets     = " << std::setw(12) << sub_bucket_count_ << "]\n";
+    out << std::defaultfloat;
+}
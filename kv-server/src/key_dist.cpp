@@ -0,0 +1,191 @@
+#include "key_dist.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// ---------- uniform ----------
+
+class UniformDist : public KeyDistribution {
+public:
+    explicit UniformDist(std::uint64_t n) : n_(n) {}
+    std::uint64_t next(std::mt19937_64& rng) const override {
+        std::uniform_int_distribution<std::uint64_t> d(0, n_ - 1);
+        return d(rng);
+    }
+private:
+    std::uint64_t n_;
+};
+
+// ---------- zipf ----------
+
+// Zipfian ranks in O(1) per sample after a one-off O(n) zeta computation and
+// no per-key memory (Gray et al., "Quickly Generating Billion-Record Synthetic
+// Databases", as used by YCSB's ZipfianGenerator). Rank 0 is the most popular.
+class ZipfRanks {
+public:
+    ZipfRanks(std::uint64_t n, double theta) : n_(n), theta_(theta) {
+        if (!(theta > 0.0 && theta < 1.0)) {
+            throw std::invalid_argument("zipf theta must be in (0, 1)");
+        }
+        zetan_ = zeta(n_, theta_);
+        double zeta2 = zeta(2, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_   = (1.0 - std::pow(2.0 / static_cast<double>(n_), 1.0 - theta_)) /
+                 (1.0 - zeta2 / zetan_);
+        half_pow_theta_ = 1.0 + std::pow(0.5, theta_);
+    }
+
+    std::uint64_t next(std::mt19937_64& rng) const {
+        std::uniform_real_distribution<double> u01(0.0, 1.0);
+        double u  = u01(rng);
+        double uz = u * zetan_;
+        if (uz < 1.0) return 0;
+        if (uz < half_pow_theta_) return n_ > 1 ? 1 : 0;
+        auto r = static_cast<std::uint64_t>(
+            static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return r < n_ ? r : n_ - 1;
+    }
+
+private:
+    static double zeta(std::uint64_t n, double theta) {
+        double sum = 0.0;
+        for (std::uint64_t i = 1; i <= n; ++i) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+
+    std::uint64_t n_;
+    double theta_;
+    double zetan_ = 0.0;
+    double alpha_ = 0.0;
+    double eta_   = 0.0;
+    double half_pow_theta_ = 0.0;
+};
+
+class ZipfDist : public KeyDistribution {
+public:
+    ZipfDist(std::uint64_t n, double theta, bool scramble)
+        : n_(n), ranks_(n, theta), scramble_(scramble) {}
+    std::uint64_t next(std::mt19937_64& rng) const override {
+        std::uint64_t r = ranks_.next(rng);
+        return scramble_ ? fnv1a64(r) % n_ : r;
+    }
+private:
+    std::uint64_t n_;
+    ZipfRanks ranks_;
+    bool scramble_;
+};
+
+// ---------- latest ----------
+
+// Skewed towards the end of the keyspace: the highest index is the most popular.
+class LatestDist : public KeyDistribution {
+public:
+    LatestDist(std::uint64_t n, double theta) : n_(n), ranks_(n, theta) {}
+    std::uint64_t next(std::mt19937_64& rng) const override {
+        return n_ - 1 - ranks_.next(rng);
+    }
+private:
+    std::uint64_t n_;
+    ZipfRanks ranks_;
+};
+
+// ---------- hotspot ----------
+
+// hot_prob of requests go uniformly to the first hot_keys indices, the rest
+// uniformly to the remaining (cold) keys.
+class HotspotDist : public KeyDistribution {
+public:
+    HotspotDist(std::uint64_t n, std::uint64_t hot, double prob, bool scramble)
+        : n_(n), hot_(hot == 0 ? 1 : (hot > n ? n : hot)), prob_(prob), scramble_(scramble) {}
+    std::uint64_t next(std::mt19937_64& rng) const override {
+        std::uint64_t idx;
+        if (n_ <= hot_) {
+            std::uniform_int_distribution<std::uint64_t> d(0, hot_ - 1);
+            idx = d(rng);
+        } else {
+            std::uniform_real_distribution<double> u01(0.0, 1.0);
+            if (u01(rng) < prob_) {
+                std::uniform_int_distribution<std::uint64_t> d(0, hot_ - 1);
+                idx = d(rng);
+            } else {
+                std::uniform_int_distribution<std::uint64_t> d(hot_, n_ - 1);
+                idx = d(rng);
+            }
+        }
+        return scramble_ ? fnv1a64(idx) % n_ : idx;
+    }
+private:
+    std::uint64_t n_;
+    std::uint64_t hot_;
+    double prob_;
+    bool scramble_;
+};
+
+// ---------- exponential ----------
+
+// exp_percentile % of requests land in the first exp_fraction of the keyspace
+// (YCSB ExponentialGenerator); out-of-range draws are resampled.
+class ExponentialDist : public KeyDistribution {
+public:
+    ExponentialDist(std::uint64_t n, double percentile, double fraction, bool scramble)
+        : n_(n), scramble_(scramble) {
+        if (!(percentile > 0.0 && percentile < 100.0) || !(fraction > 0.0 && fraction <= 1.0)) {
+            throw std::invalid_argument("exponential: percentile must be in (0,100), fraction in (0,1]");
+        }
+        gamma_ = -std::log(1.0 - percentile / 100.0) / (static_cast<double>(n_) * fraction);
+    }
+    std::uint64_t next(std::mt19937_64& rng) const override {
+        std::exponential_distribution<double> d(gamma_);
+        std::uint64_t idx;
+        do {
+            idx = static_cast<std::uint64_t>(d(rng));
+        } while (idx >= n_);
+        return scramble_ ? fnv1a64(idx) % n_ : idx;
+    }
+private:
+    std::uint64_t n_;
+    double gamma_ = 1.0;
+    bool scramble_;
+};
+
+} // namespace
+
+std::uint64_t fnv1a64(std::uint64_t v) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < 8; ++i) {
+        h ^= (v & 0xff);
+        h *= 0x100000001b3ULL;
+        v >>= 8;
+    }
+    return h;
+}
+
+std::unique_ptr<KeyDistribution> make_key_distribution(const KeyDistConfig& cfg,
+                                                       std::uint64_t keys) {
+    if (keys == 0) throw std::invalid_argument("key distribution needs keys > 0");
+
+    bool scramble_default = (cfg.name == "zipf" || cfg.name == "exponential");
+    bool scramble;
+    if (cfg.scramble == "auto")     scramble = scramble_default;
+    else if (cfg.scramble == "on")  scramble = true;
+    else if (cfg.scramble == "off") scramble = false;
+    else throw std::invalid_argument("scramble must be auto|on|off: " + cfg.scramble);
+
+    if (cfg.name == "uniform" || cfg.name.empty()) {
+        return std::make_unique<UniformDist>(keys);
+    } else if (cfg.name == "zipf") {
+        return std::make_unique<ZipfDist>(keys, cfg.zipf_theta, scramble);
+    } else if (cfg.name == "latest") {
+        return std::make_unique<LatestDist>(keys, cfg.zipf_theta);
+    } else if (cfg.name == "hotspot") {
+        if (!(cfg.hot_prob >= 0.0 && cfg.hot_prob <= 1.0)) {
+            throw std::invalid_argument("hotspot: hot_prob must be in [0, 1]");
+        }
+        return std::make_unique<HotspotDist>(keys, cfg.hot_keys, cfg.hot_prob, scramble);
+    } else if (cfg.name == "exponential") {
+        return std::make_unique<ExponentialDist>(keys, cfg.exp_percentile, cfg.exp_fraction, scramble);
+    }
+    throw std::invalid_argument("unknown key distribution: " + cfg.name);
+}
@@ -0,0 +1,37 @@
+#include "request_util.h"
+#include "utils.h"
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+std::string extract_key(const httplib::Request& req) {
+    // Handlers are registered with regex like "/get/(.+)" so key is matches[1]
+    if (req.matches.size() >= 2) {
+        return url_decode(req.matches[1].str());
+    }
+    return {};
+}
+
+std::string extract_value(const httplib::Request& req) {
+    // Tests and loadgen send value in ?value=..., fall back to body
+    try {
+        auto v = req.get_param_value("value");
+        if (!v.empty()) {
+            return url_decode(v);
+        }
+    } catch (...) {
+        // no param; ignore
+    }
+    return req.body;
+}
+
+std::string render_metrics(const MetricsSnapshot& m) {
+    json j;
+    j["requests_total"] = m.requests_total;
+    j["errors_total"]   = m.errors_total;
+    j["cache_hits"]     = m.cache_hits;
+    j["cache_misses"]   = m.cache_misses;
+    j["cache_capacity"] = m.cache_capacity;
+    return j.dump();
+}
@@ -2,47 +2,87 @@
 #include "cache.h"
 #include "config.h"
 #include "database.h"
+#include "request_util.h"
 #include "utils.h"
 
 #include <httplib.h>
-#include <nlohmann/json.hpp>
 
 #include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdio>
 #include <string>
 
-using json = nlohmann::json;
-
 namespace {
 
 // global request / error counters for /metrics
 std::atomic<std::size_t> g_requests{0};
 std::atomic<std::size_t> g_errors{0};
 
-std::string extract_key(const httplib::Request &req) {
-    // Handlers are registered with regex like "/get/(.+)" so key is matches[1]
-    if (req.matches.size() >= 2) {
-        return url_decode(req.matches[1].str());
-    }
-    return {};
+using SteadyClock = std::chrono::steady_clock;
+
+int64_t us_since(SteadyClock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - t0).count();
 }
 
-std::string extract_value(const httplib::Request &req) {
-    // Tests and loadgen send value in ?value=..., fall back to body
-    try {
-        auto v = req.get_param_value("value");
-        if (!v.empty()) {
-            return url_decode(v);
-        }
-    } catch (...) {
-        // no param; ignore
+// Phase durations of one KV request for --server-timing. The header is set
+// on the response when this goes out of scope, i.e. on every return path:
+//
+//   Server-Timing: pool_wait;dur=0.004, cache;dur=0.002;desc=miss, db;dur=0.811, total;dur=0.840
+//
+// pool_wait is the wait for a PostgreSQL pool connection, cache the LRU
+// lookup or update including its lock, db the query round trip; desc is
+// hit/miss on GETs. Durations are in ms, as the Server-Timing spec has
+// them. Time the connection spent waiting for an HTTP worker thread is
+// before the handler starts, so it is in none of these.
+class RequestTiming {
+public:
+    RequestTiming(bool enabled, httplib::Response& res)
+        : enabled_(enabled), res_(res), t0_(SteadyClock::now()) {}
+
+    ~RequestTiming() {
+        if (!enabled_) return;
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "pool_wait;dur=%.3f, cache;dur=%.3f%s, db;dur=%.3f, total;dur=%.3f",
+                      ms(db_.wait_us), ms(cache_us_),
+                      lookup_ == 0 ? "" : (lookup_ > 0 ? ";desc=hit" : ";desc=miss"),
+                      ms(db_.exec_us), ms(us_since(t0_)));
+        res_.set_header("Server-Timing", buf);
+    }
+
+    RequestTiming(const RequestTiming&) = delete;
+    RequestTiming& operator=(const RequestTiming&) = delete;
+
+    /** Pass to db_*(); null when timing is off. */
+    DbTiming* db() { return enabled_ ? &db_ : nullptr; }
+
+    /** Run a cache operation, adding its duration to the cache phase. */
+    template <typename F>
+    auto cache(F&& fn) -> decltype(fn()) {
+        struct Span {
+            int64_t* acc;
+            SteadyClock::time_point t0;
+            ~Span() { if (acc) *acc += us_since(t0); }
+        } span{enabled_ ? &cache_us_ : nullptr, SteadyClock::now()};
+        return fn();
     }
-    return req.body;
-}
+
+    void set_hit(bool hit) { lookup_ = hit ? 1 : -1; }
+
+private:
+    static double ms(int64_t us) { return static_cast<double>(us) / 1000.0; }
+
+    bool                    enabled_;
+    httplib::Response&      res_;
+    SteadyClock::time_point t0_;
+    int64_t                 cache_us_ = 0;
+    DbTiming                db_;
+    int                     lookup_   = 0;   // GETs: 1 hit, -1 miss
+};
 
 } // namespace
 
-void run_server(const Config& cfg) {
+void run_server(const Config& cfg, const ServerReadyFn& on_ready) {
     // logging level from config
     log_set_level(cfg.log_level);
 
@@ -82,20 +122,21 @@ void run_server(const Config& cfg) {
 
     // --- /metrics ----------------------------------------------------------
     svr.Get("/metrics", [&cache, &cfg](const httplib::Request&, httplib::Response& res) {
-        json j;
-        j["requests_total"] = g_requests.load(std::memory_order_relaxed);
-        j["errors_total"]   = g_errors.load(std::memory_order_relaxed);
-        j["cache_hits"]     = cache.hits();
-        j["cache_misses"]   = cache.misses();
-        j["cache_capacity"] = cfg.cache_size;
+        MetricsSnapshot m;
+        m.requests_total = g_requests.load(std::memory_order_relaxed);
+        m.errors_total   = g_errors.load(std::memory_order_relaxed);
+        m.cache_hits     = cache.hits();
+        m.cache_misses   = cache.misses();
+        m.cache_capacity = cfg.cache_size;
 
         res.status = 200;
-        res.set_content(j.dump(), "application/json");
+        res.set_content(render_metrics(m), "application/json");
     });
 
     // --- PUT /put/<key>?value=... -----------------------------------------
-    svr.Put(R"(/put/(.+))", [&cache](const httplib::Request& req, httplib::Response& res) {
+    svr.Put(R"(/put/(.+))", [&cache, &cfg](const httplib::Request& req, httplib::Response& res) {
         g_requests.fetch_add(1, std::memory_order_relaxed);
+        RequestTiming timing(cfg.server_timing, res);
 
         std::string key = extract_key(req);
         if (key.empty()) {
@@ -107,14 +148,14 @@ void run_server(const Config& cfg) {
 
         std::string value = extract_value(req);
 
-        if (!db_put(key, value)) {
+        if (!db_put(key, value, timing.db())) {
             g_errors.fetch_add(1, std::memory_order_relaxed);
             res.status = 500;
             res.set_content("DB error", "text/plain");
             return;
         }
 
-        cache.put(key, value);
+        timing.cache([&] { cache.put(key, value); });
 
         res.status = 200;
         // tests don’t look at PUT body, but returning value is convenient
@@ -122,8 +163,9 @@ void run_server(const Config& cfg) {
     });
 
     // --- GET /get/<key> ----------------------------------------------------
-    svr.Get(R"(/get/(.+))", [&cache](const httplib::Request& req, httplib::Response& res) {
+    svr.Get(R"(/get/(.+))", [&cache, &cfg](const httplib::Request& req, httplib::Response& res) {
         g_requests.fetch_add(1, std::memory_order_relaxed);
+        RequestTiming timing(cfg.server_timing, res);
 
         std::string key = extract_key(req);
         if (key.empty()) {
@@ -135,15 +177,19 @@ void run_server(const Config& cfg) {
 
         std::string value;
 
-        // 1) try cache
-        if (cache.get(key, value)) {
+        // 1) try cache (X-Cache tells kv-loadgen where the value came from)
+        bool hit = timing.cache([&] { return cache.get(key, value); });
+        timing.set_hit(hit);
+        if (hit) {
             res.status = 200;
+            res.set_header("X-Cache", "HIT");
             res.set_content(value, "text/plain");
             return;
         }
 
         // 2) fall back to DB
-        if (!db_get(key, value)) {
+        res.set_header("X-Cache", "MISS");
+        if (!db_get(key, value, timing.db())) {
             // For this project, false means "not found"
             res.status = 404;
             res.set_content("Not found", "text/plain");
@@ -151,15 +197,16 @@ void run_server(const Config& cfg) {
         }
 
         // populate cache on DB hit
-        cache.put(key, value);
+        timing.cache([&] { cache.put(key, value); });
 
         res.status = 200;
         res.set_content(value, "text/plain");
     });
 
     // --- DELETE /delete/<key> ----------------------------------------------
-    svr.Delete(R"(/delete/(.+))", [&cache](const httplib::Request& req, httplib::Response& res) {
+    svr.Delete(R"(/delete/(.+))", [&cache, &cfg](const httplib::Request& req, httplib::Response& res) {
         g_requests.fetch_add(1, std::memory_order_relaxed);
+        RequestTiming timing(cfg.server_timing, res);
 
         std::string key = extract_key(req);
         if (key.empty()) {
@@ -169,10 +216,10 @@ void run_server(const Config& cfg) {
             return;
         }
 
-        bool db_ok = db_delete(key);
+        bool db_ok = db_delete(key, timing.db());
 
         // best-effort cache invalidation
-        cache.erase(key);
+        timing.cache([&] { cache.erase(key); });
 
         // tests accept either 200 or 404, but we distinguish:
         if (!db_ok) {
@@ -186,9 +233,21 @@ void run_server(const Config& cfg) {
     });
 
     // --- Start server ------------------------------------------------------
-    log_info("HTTP server starting on port " + std::to_string(cfg.server_port));
+    int port = cfg.server_port;
+    if (port == 0) {
+        port = svr.bind_to_any_port(cfg.server_host);
+    } else if (!svr.bind_to_port(cfg.server_host, port)) {
+        port = -1;
+    }
+    if (port < 0) {
+        log_error("Server bind failed on " + cfg.server_host + ":" + std::to_string(cfg.server_port));
+        db_close();
+        return;
+    }
+    log_info("HTTP server starting on " + cfg.server_host + ":" + std::to_string(port));
+    if (on_ready) on_ready(port, [&svr] { svr.stop(); });
 
-    if (!svr.listen("0.0.0.0", cfg.server_port)) {
+    if (!svr.listen_after_bind()) {
         log_error("Server.listen failed");
     }
 
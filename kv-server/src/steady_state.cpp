@@ -0,0 +1,68 @@
+#include "steady_state.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+double mean_of(const double* v, std::size_t n) {
+    double s = 0.0;
+    for (std::size_t i = 0; i < n; ++i) s += v[i];
+    return s / static_cast<double>(n);
+}
+
+double stddev_of(const double* v, std::size_t n, double mean) {
+    double s = 0.0;
+    for (std::size_t i = 0; i < n; ++i) s += (v[i] - mean) * (v[i] - mean);
+    return std::sqrt(s / static_cast<double>(n));
+}
+
+// Least-squares slope per interval, times the window length: the change the
+// trend accounts for across the whole window.
+double trend_of(const double* v, std::size_t n, double mean) {
+    double xm = static_cast<double>(n - 1) / 2.0;
+    double num = 0.0, den = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        double dx = static_cast<double>(i) - xm;
+        num += dx * (v[i] - mean);
+        den += dx * dx;
+    }
+    return den > 0.0 ? num / den * static_cast<double>(n) : 0.0;
+}
+
+} // namespace
+
+SteadyStateDetector::SteadyStateDetector(SteadyStateConfig cfg)
+    : cfg_(cfg)
+{
+    cfg_.window = std::max<std::size_t>(cfg_.window, 2);
+}
+
+void SteadyStateDetector::reset() {
+    thr_.clear();
+    p99_.clear();
+    steady_ = false;
+}
+
+bool SteadyStateDetector::add(double throughput, double p99) {
+    thr_.push_back(throughput);
+    p99_.push_back(p99);
+
+    steady_ = false;
+    if (thr_.size() < cfg_.skip + cfg_.window) return false;
+
+    const std::size_t n = cfg_.window;
+    const double* t = thr_.data() + thr_.size() - n;
+    const double* p = p99_.data() + p99_.size() - n;
+
+    double tm = mean_of(t, n);
+    if (tm <= 0.0) return false;
+    if (stddev_of(t, n, tm) / tm > cfg_.max_cv) return false;
+    if (std::fabs(trend_of(t, n, tm)) / tm > cfg_.max_drift) return false;
+
+    double pm = mean_of(p, n);
+    if (pm > 0.0 && std::fabs(trend_of(p, n, pm)) / pm > cfg_.max_p99_drift) return false;
+
+    steady_ = true;
+    return true;
+}
@@ -0,0 +1,148 @@
+#include "value_gen.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Extra pool bytes beyond max_size so values start at varying offsets
+constexpr std::size_t kPoolSlack = 4096;
+
+// Pareto values are capped here unless the spec gives a max
+constexpr std::size_t kDefaultParetoMax = 1024 * 1024;
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::size_t start = 0;
+    for (;;) {
+        std::size_t pos = s.find(sep, start);
+        out.push_back(s.substr(start, pos == std::string::npos ? std::string::npos : pos - start));
+        if (pos == std::string::npos) break;
+        start = pos + 1;
+    }
+    return out;
+}
+
+} // namespace
+
+std::size_t parse_byte_size(const std::string& s) {
+    if (s.empty()) throw std::invalid_argument("empty size");
+    std::size_t mult = 1;
+    std::string num = s;
+    char last = static_cast<char>(std::tolower(static_cast<unsigned char>(s.back())));
+    if (last == 'k') { mult = 1024; num.pop_back(); }
+    else if (last == 'm') { mult = 1024 * 1024; num.pop_back(); }
+    // stoull would skip leading blanks and wrap a '-'
+    if (num.empty() || !std::isdigit(static_cast<unsigned char>(num[0]))) {
+        throw std::invalid_argument("bad size: " + s);
+    }
+    std::size_t pos = 0;
+    unsigned long long v = 0;
+    try {
+        v = std::stoull(num, &pos);
+    } catch (const std::out_of_range&) {
+        throw std::invalid_argument("size out of range: " + s);
+    }
+    if (pos != num.size()) throw std::invalid_argument("bad size: " + s);
+    return static_cast<std::size_t>(v) * mult;
+}
+
+ValueGenerator::ValueGenerator(const std::string& spec, std::uint64_t seed)
+    : spec_(spec)
+{
+    std::string kind = "fixed";
+    std::string args = spec;
+    std::size_t colon = spec.find(':');
+    if (colon != std::string::npos) {
+        kind = spec.substr(0, colon);
+        args = spec.substr(colon + 1);
+    }
+
+    if (kind == "fixed") {
+        kind_ = Kind::FIXED;
+        min_size_ = max_size_ = parse_byte_size(args);
+        mean_size_ = static_cast<double>(min_size_);
+    } else if (kind == "uniform") {
+        auto parts = split(args, '-');
+        if (parts.size() != 2) throw std::invalid_argument("uniform value size needs <min>-<max>");
+        kind_ = Kind::UNIFORM;
+        min_size_ = parse_byte_size(parts[0]);
+        max_size_ = parse_byte_size(parts[1]);
+        if (min_size_ > max_size_) std::swap(min_size_, max_size_);
+        mean_size_ = (static_cast<double>(min_size_) + static_cast<double>(max_size_)) / 2.0;
+    } else if (kind == "pareto") {
+        auto parts = split(args, ':');
+        if (parts.size() < 2 || parts.size() > 3) {
+            throw std::invalid_argument("pareto value size needs <min>:<alpha>[:<max>]");
+        }
+        kind_ = Kind::PARETO;
+        min_size_ = std::max<std::size_t>(1, parse_byte_size(parts[0]));
+        alpha_    = std::stod(parts[1]);
+        max_size_ = parts.size() == 3 ? parse_byte_size(parts[2]) : kDefaultParetoMax;
+        if (alpha_ <= 0.0) throw std::invalid_argument("pareto alpha must be > 0");
+        if (max_size_ < min_size_) throw std::invalid_argument("pareto max must be >= min");
+        // Mean of the untruncated distribution (alpha > 1); good enough for reporting
+        mean_size_ = alpha_ > 1.0 ? alpha_ * static_cast<double>(min_size_) / (alpha_ - 1.0)
+                                  : static_cast<double>(max_size_);
+        mean_size_ = std::min(mean_size_, static_cast<double>(max_size_));
+    } else if (kind == "trace") {
+        std::ifstream in(args);
+        if (!in) throw std::invalid_argument("cannot read value-size trace: " + args);
+        std::string line;
+        double sum = 0.0;
+        while (std::getline(in, line)) {
+            std::size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] == '#') continue;
+            std::size_t end = line.find_first_of(", \t\r", start);
+            std::size_t sz = parse_byte_size(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            trace_.push_back(static_cast<std::uint32_t>(sz));
+            max_size_ = std::max(max_size_, sz);
+            sum += static_cast<double>(sz);
+        }
+        if (trace_.empty()) throw std::invalid_argument("value-size trace is empty: " + args);
+        kind_ = Kind::TRACE;
+        min_size_ = *std::min_element(trace_.begin(), trace_.end());
+        mean_size_ = sum / static_cast<double>(trace_.size());
+    } else {
+        throw std::invalid_argument("unknown value size distribution: " + kind);
+    }
+
+    // Printable bytes so values are also safe in URLs and logs
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(sizeof(alphabet) - 2));
+    pool_.resize(max_size_ + kPoolSlack);
+    for (char& ch : pool_) ch = alphabet[pick(rng)];
+}
+
+std::size_t ValueGenerator::next_size(std::mt19937_64& rng) const {
+    switch (kind_) {
+        case Kind::FIXED:
+            return min_size_;
+        case Kind::UNIFORM: {
+            std::uniform_int_distribution<std::size_t> d(min_size_, max_size_);
+            return d(rng);
+        }
+        case Kind::PARETO: {
+            std::uniform_real_distribution<double> u01(0.0, 1.0);
+            double u = 1.0 - u01(rng); // (0, 1]
+            double v = static_cast<double>(min_size_) / std::pow(u, 1.0 / alpha_);
+            return v >= static_cast<double>(max_size_) ? max_size_ : static_cast<std::size_t>(v);
+        }
+        case Kind::TRACE: {
+            std::uniform_int_distribution<std::size_t> d(0, trace_.size() - 1);
+            return trace_[d(rng)];
+        }
+    }
+    return min_size_;
+}
+
+std::string_view ValueGenerator::next(std::mt19937_64& rng) const {
+    std::size_t size = next_size(rng);
+    std::uniform_int_distribution<std::size_t> off(0, kPoolSlack - 1);
+    return std::string_view(pool_.data() + off(rng), size);
+}
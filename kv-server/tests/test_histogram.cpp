@@ -0,0 +1,57 @@
+#include "hdr_histogram.h"
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+static bool within(double got, double want, double rel) {
+    return std::fabs(got - want) <= want * rel;
+}
+
+int main() {
+    HdrHistogram h(1, 60LL * 1000 * 1000, 3);
+
+    for (int v = 1; v <= 10000; ++v) h.record(v);
+    assert(h.count() == 10000);
+    assert(within(static_cast<double>(h.value_at_percentile(50.0)), 5000.0, 0.001));
+    assert(within(static_cast<double>(h.value_at_percentile(99.0)), 9900.0, 0.001));
+    assert(within(static_cast<double>(h.max()), 10000.0, 0.001));
+    assert(h.min() == 1);
+    assert(within(h.mean(), 5000.5, 0.001));
+
+    // Large values keep 3 significant digits
+    HdrHistogram big(1, 60LL * 1000 * 1000, 3);
+    big.record(12345678);
+    assert(within(static_cast<double>(big.value_at_percentile(100.0)), 12345678.0, 0.001));
+
+    // Merge adds counts; percentiles come from the combined distribution
+    HdrHistogram a(1, 60LL * 1000 * 1000, 3);
+    HdrHistogram b(1, 60LL * 1000 * 1000, 3);
+    for (int i = 0; i < 900; ++i) a.record(100);
+    for (int i = 0; i < 100; ++i) b.record(100000);
+    assert(a.merge(b));
+    assert(a.count() == 1000);
+    assert(within(static_cast<double>(a.value_at_percentile(90.0)), 100.0, 0.001));
+    assert(within(static_cast<double>(a.value_at_percentile(95.0)), 100000.0, 0.001));
+
+    // Layout mismatch is rejected
+    HdrHistogram other(1, 60LL * 1000 * 1000, 2);
+    assert(!a.merge(other));
+
+    // Round trip through raw counts
+    HdrHistogram c(1, 60LL * 1000 * 1000, 3);
+    assert(c.set_counts(a.counts()));
+    assert(c.count() == a.count());
+    assert(c.value_at_percentile(99.0) == a.value_at_percentile(99.0));
+
+    std::ostringstream log;
+    a.write_percentiles(log, 1000.0);
+    assert(log.str().find("Total count") != std::string::npos);
+
+    a.reset();
+    assert(a.count() == 0 && a.value_at_percentile(99.0) == 0);
+
+    std::cout << "test-histogram OK\n";
+    return 0;
+}
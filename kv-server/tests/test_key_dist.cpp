@@ -0,0 +1,74 @@
+#include "key_dist.h"
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static std::vector<int> sample(const KeyDistribution& d, std::uint64_t n, int draws) {
+    std::mt19937_64 rng(42);
+    std::vector<int> counts(n, 0);
+    for (int i = 0; i < draws; ++i) {
+        std::uint64_t k = d.next(rng);
+        assert(k < n);
+        ++counts[k];
+    }
+    return counts;
+}
+
+int main() {
+    const std::uint64_t n = 1000;
+    const int draws = 200000;
+
+    KeyDistConfig cfg;
+
+    // Uniform: every key seen, no key far above its fair share
+    cfg.name = "uniform";
+    auto uni = sample(*make_key_distribution(cfg, n), n, draws);
+    for (int c : uni) assert(c > 0 && c < 3 * draws / static_cast<int>(n));
+
+    // Zipf (unscrambled): rank 0 is the most popular key, heavily skewed
+    cfg.name = "zipf";
+    cfg.scramble = "off";
+    auto zipf = sample(*make_key_distribution(cfg, n), n, draws);
+    assert(zipf[0] > zipf[1] && zipf[1] > zipf[10] && zipf[10] > zipf[500]);
+    assert(zipf[0] > draws / 20);
+
+    // Scrambled zipf keeps the same skew but moves the hottest key off index 0
+    cfg.scramble = "on";
+    auto scr = sample(*make_key_distribution(cfg, n), n, draws);
+    int hottest = 0;
+    for (std::uint64_t i = 0; i < n; ++i) if (scr[i] > scr[hottest]) hottest = static_cast<int>(i);
+    assert(hottest != 0 && scr[hottest] > draws / 20);
+
+    // Hotspot: 90% of requests to the first 5 keys
+    cfg = KeyDistConfig{};
+    cfg.name = "hotspot";
+    auto hot = sample(*make_key_distribution(cfg, n), n, draws);
+    int hot_total = 0;
+    for (int i = 0; i < 5; ++i) hot_total += hot[i];
+    assert(hot_total > draws * 88 / 100 && hot_total < draws * 92 / 100);
+
+    // Latest: the end of the keyspace is hottest
+    cfg.name = "latest";
+    auto lat = sample(*make_key_distribution(cfg, n), n, draws);
+    assert(lat[n - 1] > lat[n - 2] && lat[n - 2] > lat[0]);
+
+    // Exponential: ~95% of requests within the first 10% of keys
+    cfg.name = "exponential";
+    cfg.scramble = "off";
+    auto ex = sample(*make_key_distribution(cfg, n), n, draws);
+    int low = 0;
+    for (std::uint64_t i = 0; i < n / 10; ++i) low += ex[i];
+    assert(low > draws * 93 / 100);
+
+    // Bad parameters are rejected
+    cfg.name = "zipf";
+    cfg.zipf_theta = 1.5;
+    bool threw = false;
+    try { make_key_distribution(cfg, n); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+
+    std::cout << "test-key-dist OK\n";
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "steady_state.h"
+
+#include <cassert>
+#include <iostream>
+
+int main() {
+    SteadyStateConfig cfg;
+    cfg.window = 5;
+    cfg.skip   = 1;
+
+    // Flat series with small noise: steady once skip + window intervals are in
+    {
+        SteadyStateDetector d(cfg);
+        const double thr[] = {100, 1000, 1010, 990, 1005, 995};
+        for (int i = 0; i < 5; ++i) assert(!d.add(thr[i], 2.0));
+        assert(d.add(thr[5], 2.0));
+        assert(d.window_start() == 1);
+    }
+
+    // Slow ramp: small CV over the window but a clear trend, never steady
+    {
+        SteadyStateDetector d(cfg);
+        for (int i = 0; i < 20; ++i) assert(!d.add(1000.0 + 30.0 * i, 2.0));
+    }
+
+    // Throughput flat but p99 climbing (backlog building up): not steady
+    {
+        SteadyStateDetector d(cfg);
+        for (int i = 0; i < 20; ++i) assert(!d.add(1000.0, 1.0 + 0.5 * i));
+    }
+
+    // Noisy series settles: steady once the noisy intervals leave the window
+    {
+        SteadyStateDetector d(cfg);
+        const double thr[] = {0, 500, 1500, 800, 1000, 1000, 1000, 1000, 1000};
+        bool seen = false;
+        for (double t : thr) seen = d.add(t, 2.0);
+        assert(seen && d.window_start() == 4);
+        d.reset();
+        assert(d.size() == 0 && !d.steady());
+    }
+
+    // No traffic is never steady
+    {
+        SteadyStateDetector d(cfg);
+        for (int i = 0; i < 10; ++i) assert(!d.add(0.0, 0.0));
+    }
+
+    std::cout << "test-steady-state OK\n";
+    return 0;
+}
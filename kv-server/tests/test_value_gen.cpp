@@ -0,0 +1,109 @@
+#include "value_gen.h"
+
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+template <typename Fn>
+static bool throws(Fn fn) {
+    try { fn(); } catch (const std::invalid_argument&) { return true; }
+    return false;
+}
+
+int main() {
+    // Sizes: plain bytes and k/m suffixes, either case; anything else is rejected
+    assert(parse_byte_size("4096") == 4096);
+    assert(parse_byte_size("4k") == 4 * 1024);
+    assert(parse_byte_size("2M") == 2 * 1024 * 1024);
+    assert(parse_byte_size("0") == 0);
+    for (const char* bad : {"", "k", "abc", "12x", "1.5k", "4kb", "-5", " 7", "99999999999999999999"}) {
+        assert(throws([&] { parse_byte_size(bad); }));
+    }
+
+    std::mt19937_64 rng(42);
+    const int draws = 100000;
+
+    // Fixed: every value the same size, from a printable pool
+    ValueGenerator fixed("fixed:100");
+    assert(fixed.max_size() == 100 && fixed.mean_size() == 100.0);
+    for (int i = 0; i < 1000; ++i) {
+        auto v = fixed.next(rng);
+        assert(v.size() == 100);
+        for (char ch : v) assert(std::isalnum(static_cast<unsigned char>(ch)));
+    }
+    assert(ValueGenerator("1k").next(rng).size() == 1024);
+
+    // Uniform: inside [min, max] (given either way round), both ends reached
+    ValueGenerator uni("uniform:64-10");
+    assert(uni.max_size() == 64 && uni.mean_size() == 37.0);
+    bool lo = false, hi = false;
+    for (int i = 0; i < draws; ++i) {
+        std::size_t n = uni.next(rng).size();
+        assert(n >= 10 && n <= 64);
+        lo = lo || n == 10;
+        hi = hi || n == 64;
+    }
+    assert(lo && hi);
+
+    // Pareto: clamped to [min, max], most values near min, the tail hits the cap
+    ValueGenerator par("pareto:100:1.2:4k");
+    assert(par.max_size() == 4096);
+    int at_cap = 0, near_min = 0;
+    for (int i = 0; i < draws; ++i) {
+        std::size_t n = par.next(rng).size();
+        assert(n >= 100 && n <= 4096);
+        if (n == 4096) ++at_cap;
+        if (n < 200) ++near_min;
+    }
+    assert(at_cap > 0 && near_min > draws / 2);
+    assert(ValueGenerator("pareto:10:2").max_size() == 1024 * 1024);
+
+    // Trace: only the listed sizes, with comments, blanks and extra columns skipped
+    const std::string trace = "test_value_gen.trace";
+    {
+        std::ofstream out(trace);
+        out << "# size,count\n\n  8\n2k, 5\n300\t1\n";
+    }
+    ValueGenerator tr("trace:" + trace);
+    assert(tr.max_size() == 2048);
+    bool seen[3] = {false, false, false};
+    for (int i = 0; i < 10000; ++i) {
+        std::size_t n = tr.next(rng).size();
+        assert(n == 8 || n == 2048 || n == 300);
+        seen[n == 8 ? 0 : (n == 2048 ? 1 : 2)] = true;
+    }
+    assert(seen[0] && seen[1] && seen[2]);
+    {
+        std::ofstream out(trace);
+        out << "# nothing but comments\n";
+    }
+    assert(throws([&] { ValueGenerator("trace:" + trace); }));
+    {
+        std::ofstream out(trace);
+        out << "100\nlots\n";
+    }
+    assert(throws([&] { ValueGenerator("trace:" + trace); }));
+    std::remove(trace.c_str());
+    assert(throws([&] { ValueGenerator("trace:" + trace); }));
+
+    // The largest value still fits the pool at the highest offset
+    ValueGenerator big("fixed:1m");
+    for (int i = 0; i < 1000; ++i) {
+        auto v = big.next(rng);
+        assert(v.size() == 1024 * 1024 && v.back() != '\0');
+    }
+
+    // Bad specs are rejected
+    for (const char* bad : {"zipf:10", "uniform:10", "uniform:a-b", "pareto:10", "pareto:10:0",
+                            "pareto:10:x", "pareto:100:1.5:10", "fixed:-1"}) {
+        assert(throws([&] { ValueGenerator v(bad); }));
+    }
+
+    std::cout << "test-value-gen OK\n";
+    return 0;
+}